@@ -100,14 +100,19 @@
 #define TX_EMPTY    4
 #define RX_FULL     1
 #define RX_EMPTY    0
+#define EN_DPL      2
+#define EN_ACK_PAY  1
+#define EN_DYN_ACK  0
 
 //Command Name Mnemonics (Instructions)
 #define R_REGISTER		0x00
 #define W_REGISTER		0x20
 #define REGISTER_MASK	0x1F
 #define R_RX_PAYLOAD	0x61
+#define R_RX_PL_WID		0x60
 #define W_TX_PAYLOAD	0xA0
 #define W_ACK_PAYLOAD   0xA8
+#define W_TX_PAYLOAD_NOACK	0xB0
 #define FLUSH_TX		0xE1
 #define FLUSH_RX		0xE2
 #define REUSE_TX_PL		0xE3
@@ -45,17 +45,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=spaceteam_main.c spaceteam_io.c spaceteam_display.c spaceteam_spi.c spaceteam_rfid.c spaceteam_wireless.c spaceteam_game.c spaceteam_msg.c
+SOURCEFILES_QUOTED_IF_SPACED=spaceteam_main.c spaceteam_io.c spaceteam_display.c spaceteam_spi.c spaceteam_rfid.c spaceteam_wireless.c spaceteam_game.c spaceteam_msg.c spaceteam_alloc.c spaceteam_pool.c spaceteam_event.c spaceteam_led.c spaceteam_power.c spaceteam_clock.c spaceteam_checkpoint.c spaceteam_startup.c spaceteam_script.c spaceteam_sched.c spaceteam_poll.c spaceteam_chan.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/spaceteam_main.o ${OBJECTDIR}/spaceteam_io.o ${OBJECTDIR}/spaceteam_display.o ${OBJECTDIR}/spaceteam_spi.o ${OBJECTDIR}/spaceteam_rfid.o ${OBJECTDIR}/spaceteam_wireless.o ${OBJECTDIR}/spaceteam_game.o ${OBJECTDIR}/spaceteam_msg.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/spaceteam_main.o.d ${OBJECTDIR}/spaceteam_io.o.d ${OBJECTDIR}/spaceteam_display.o.d ${OBJECTDIR}/spaceteam_spi.o.d ${OBJECTDIR}/spaceteam_rfid.o.d ${OBJECTDIR}/spaceteam_wireless.o.d ${OBJECTDIR}/spaceteam_game.o.d ${OBJECTDIR}/spaceteam_msg.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/spaceteam_main.o ${OBJECTDIR}/spaceteam_io.o ${OBJECTDIR}/spaceteam_display.o ${OBJECTDIR}/spaceteam_spi.o ${OBJECTDIR}/spaceteam_rfid.o ${OBJECTDIR}/spaceteam_wireless.o ${OBJECTDIR}/spaceteam_game.o ${OBJECTDIR}/spaceteam_msg.o ${OBJECTDIR}/spaceteam_alloc.o ${OBJECTDIR}/spaceteam_pool.o ${OBJECTDIR}/spaceteam_event.o ${OBJECTDIR}/spaceteam_led.o ${OBJECTDIR}/spaceteam_power.o ${OBJECTDIR}/spaceteam_clock.o ${OBJECTDIR}/spaceteam_checkpoint.o ${OBJECTDIR}/spaceteam_startup.o ${OBJECTDIR}/spaceteam_script.o ${OBJECTDIR}/spaceteam_sched.o ${OBJECTDIR}/spaceteam_poll.o ${OBJECTDIR}/spaceteam_chan.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/spaceteam_main.o.d ${OBJECTDIR}/spaceteam_io.o.d ${OBJECTDIR}/spaceteam_display.o.d ${OBJECTDIR}/spaceteam_spi.o.d ${OBJECTDIR}/spaceteam_rfid.o.d ${OBJECTDIR}/spaceteam_wireless.o.d ${OBJECTDIR}/spaceteam_game.o.d ${OBJECTDIR}/spaceteam_msg.o.d ${OBJECTDIR}/spaceteam_alloc.o.d ${OBJECTDIR}/spaceteam_pool.o.d ${OBJECTDIR}/spaceteam_event.o.d ${OBJECTDIR}/spaceteam_led.o.d ${OBJECTDIR}/spaceteam_power.o.d ${OBJECTDIR}/spaceteam_clock.o.d ${OBJECTDIR}/spaceteam_checkpoint.o.d ${OBJECTDIR}/spaceteam_startup.o.d ${OBJECTDIR}/spaceteam_script.o.d ${OBJECTDIR}/spaceteam_sched.o.d ${OBJECTDIR}/spaceteam_poll.o.d ${OBJECTDIR}/spaceteam_chan.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/spaceteam_main.o ${OBJECTDIR}/spaceteam_io.o ${OBJECTDIR}/spaceteam_display.o ${OBJECTDIR}/spaceteam_spi.o ${OBJECTDIR}/spaceteam_rfid.o ${OBJECTDIR}/spaceteam_wireless.o ${OBJECTDIR}/spaceteam_game.o ${OBJECTDIR}/spaceteam_msg.o
+OBJECTFILES=${OBJECTDIR}/spaceteam_main.o ${OBJECTDIR}/spaceteam_io.o ${OBJECTDIR}/spaceteam_display.o ${OBJECTDIR}/spaceteam_spi.o ${OBJECTDIR}/spaceteam_rfid.o ${OBJECTDIR}/spaceteam_wireless.o ${OBJECTDIR}/spaceteam_game.o ${OBJECTDIR}/spaceteam_msg.o ${OBJECTDIR}/spaceteam_alloc.o ${OBJECTDIR}/spaceteam_pool.o ${OBJECTDIR}/spaceteam_event.o ${OBJECTDIR}/spaceteam_led.o ${OBJECTDIR}/spaceteam_power.o ${OBJECTDIR}/spaceteam_clock.o ${OBJECTDIR}/spaceteam_checkpoint.o ${OBJECTDIR}/spaceteam_startup.o ${OBJECTDIR}/spaceteam_script.o ${OBJECTDIR}/spaceteam_sched.o ${OBJECTDIR}/spaceteam_poll.o ${OBJECTDIR}/spaceteam_chan.o
 
 # Source Files
-SOURCEFILES=spaceteam_main.c spaceteam_io.c spaceteam_display.c spaceteam_spi.c spaceteam_rfid.c spaceteam_wireless.c spaceteam_game.c spaceteam_msg.c
+SOURCEFILES=spaceteam_main.c spaceteam_io.c spaceteam_display.c spaceteam_spi.c spaceteam_rfid.c spaceteam_wireless.c spaceteam_game.c spaceteam_msg.c spaceteam_alloc.c spaceteam_pool.c spaceteam_event.c spaceteam_led.c spaceteam_power.c spaceteam_clock.c spaceteam_checkpoint.c spaceteam_startup.c spaceteam_script.c spaceteam_sched.c spaceteam_poll.c spaceteam_chan.c
 
 
 CFLAGS=
@@ -135,6 +135,90 @@ ${OBJECTDIR}/spaceteam_msg.o: spaceteam_msg.c  nbproject/Makefile-${CND_CONF}.mk
 	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_msg.c  -o ${OBJECTDIR}/spaceteam_msg.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_msg.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
 	@${FIXDEPS} "${OBJECTDIR}/spaceteam_msg.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
 	
+${OBJECTDIR}/spaceteam_chan.o: spaceteam_chan.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_chan.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_chan.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_chan.c  -o ${OBJECTDIR}/spaceteam_chan.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_chan.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_chan.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_poll.o: spaceteam_poll.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_poll.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_poll.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_poll.c  -o ${OBJECTDIR}/spaceteam_poll.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_poll.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_poll.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_sched.o: spaceteam_sched.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_sched.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_sched.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_sched.c  -o ${OBJECTDIR}/spaceteam_sched.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_sched.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_sched.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_script.o: spaceteam_script.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_script.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_script.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_script.c  -o ${OBJECTDIR}/spaceteam_script.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_script.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_script.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_startup.o: spaceteam_startup.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_startup.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_startup.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_startup.c  -o ${OBJECTDIR}/spaceteam_startup.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_startup.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_startup.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_checkpoint.o: spaceteam_checkpoint.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_checkpoint.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_checkpoint.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_checkpoint.c  -o ${OBJECTDIR}/spaceteam_checkpoint.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_checkpoint.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_checkpoint.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_clock.o: spaceteam_clock.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_clock.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_clock.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_clock.c  -o ${OBJECTDIR}/spaceteam_clock.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_clock.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_clock.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_power.o: spaceteam_power.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_power.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_power.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_power.c  -o ${OBJECTDIR}/spaceteam_power.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_power.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_power.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_led.o: spaceteam_led.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_led.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_led.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_led.c  -o ${OBJECTDIR}/spaceteam_led.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_led.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_led.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_event.o: spaceteam_event.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_event.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_event.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_event.c  -o ${OBJECTDIR}/spaceteam_event.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_event.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_event.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_pool.o: spaceteam_pool.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_pool.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_pool.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_pool.c  -o ${OBJECTDIR}/spaceteam_pool.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_pool.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_pool.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_alloc.o: spaceteam_alloc.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_alloc.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_alloc.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_alloc.c  -o ${OBJECTDIR}/spaceteam_alloc.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_alloc.o.d"      -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_alloc.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
 else
 ${OBJECTDIR}/spaceteam_main.o: spaceteam_main.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
@@ -192,6 +276,90 @@ ${OBJECTDIR}/spaceteam_msg.o: spaceteam_msg.c  nbproject/Makefile-${CND_CONF}.mk
 	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_msg.c  -o ${OBJECTDIR}/spaceteam_msg.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_msg.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
 	@${FIXDEPS} "${OBJECTDIR}/spaceteam_msg.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
 	
+${OBJECTDIR}/spaceteam_chan.o: spaceteam_chan.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_chan.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_chan.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_chan.c  -o ${OBJECTDIR}/spaceteam_chan.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_chan.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_chan.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_poll.o: spaceteam_poll.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_poll.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_poll.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_poll.c  -o ${OBJECTDIR}/spaceteam_poll.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_poll.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_poll.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_sched.o: spaceteam_sched.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_sched.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_sched.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_sched.c  -o ${OBJECTDIR}/spaceteam_sched.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_sched.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_sched.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_script.o: spaceteam_script.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_script.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_script.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_script.c  -o ${OBJECTDIR}/spaceteam_script.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_script.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_script.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_startup.o: spaceteam_startup.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_startup.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_startup.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_startup.c  -o ${OBJECTDIR}/spaceteam_startup.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_startup.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_startup.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_checkpoint.o: spaceteam_checkpoint.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_checkpoint.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_checkpoint.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_checkpoint.c  -o ${OBJECTDIR}/spaceteam_checkpoint.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_checkpoint.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_checkpoint.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_clock.o: spaceteam_clock.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_clock.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_clock.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_clock.c  -o ${OBJECTDIR}/spaceteam_clock.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_clock.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_clock.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_power.o: spaceteam_power.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_power.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_power.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_power.c  -o ${OBJECTDIR}/spaceteam_power.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_power.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_power.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_led.o: spaceteam_led.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_led.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_led.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_led.c  -o ${OBJECTDIR}/spaceteam_led.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_led.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_led.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_event.o: spaceteam_event.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_event.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_event.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_event.c  -o ${OBJECTDIR}/spaceteam_event.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_event.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_event.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_pool.o: spaceteam_pool.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_pool.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_pool.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_pool.c  -o ${OBJECTDIR}/spaceteam_pool.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_pool.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_pool.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
+${OBJECTDIR}/spaceteam_alloc.o: spaceteam_alloc.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/spaceteam_alloc.o.d 
+	@${RM} ${OBJECTDIR}/spaceteam_alloc.o 
+	${MP_CC} $(MP_EXTRA_CC_PRE)  spaceteam_alloc.c  -o ${OBJECTDIR}/spaceteam_alloc.o  -c -mcpu=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/spaceteam_alloc.o.d"      -g -omf=elf -O0 -msmart-io=1 -Wall -msfr-warn=off
+	@${FIXDEPS} "${OBJECTDIR}/spaceteam_alloc.o.d" $(SILENT)  -rsi ${MP_CC_DIR}../ 
+	
 endif
 
 # ------------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#!/bin/sh
+#
+# This script checks the data memory use of the last build against the
+#  RAM budget. It adds up the data sections that each object file puts
+#  into RAM from the linker map, prints them per module, and fails the
+#  build if the total is over budget.
+#
+#  Usage: ram_budget.sh [map file]
+#
+#  The budget is in bytes, and can be changed with RAM_BUDGET. The
+#  PIC24F16KL402 has 1024 bytes of RAM, and the rest is left for the
+#  stack and the debugger.
+#
+
+RAM_BUDGET=${RAM_BUDGET:-768}
+
+# Use the passed map, or else the newest one from the build
+MAP=$1
+if [ -z "$MAP" ]; then
+    MAP=`ls -t dist/*/*/*.map 2>/dev/null | head -1`
+fi
+
+if [ -z "$MAP" ] || [ ! -f "$MAP" ]; then
+    echo "ram_budget: no linker map found, skipping the RAM check"
+    exit 0
+fi
+
+awk -v budget="$RAM_BUDGET" '
+    # Input sections look like " .nbss  0x0850  0x8 build/.../spaceteam_game.o",
+    #  though a long section name pushes the rest onto the next line
+    function hex(s,    i, n)
+    {
+        n = 0
+        s = tolower(substr(s, 3))
+        for (i = 1; i <= length(s); i++)
+        {
+            n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+        }
+        return n
+    }
+
+    function add(size, obj)
+    {
+        sub(/.*\//, "", obj)
+        sub(/\)$/, "", obj)
+        used[obj] += hex(size)
+    }
+
+    pending != "" {
+        if ($1 ~ /^0x/ && $2 ~ /^0x/ && NF >= 3)
+        {
+            add($2, $3)
+        }
+        pending = ""
+    }
+
+    /^ \.(n?bss|n?data|pbss|ndconst)/ {
+        if (NF >= 4 && $2 ~ /^0x/ && $3 ~ /^0x/)
+        {
+            add($3, $4)
+        }
+        else if (NF == 1)
+        {
+            pending = $1
+        }
+    }
+
+    END {
+        total = 0
+        for (obj in used)
+        {
+            if (used[obj] > 0)
+            {
+                printf("ram_budget: %-28s %5d bytes\n", obj, used[obj])
+                total += used[obj]
+            }
+        }
+        printf("ram_budget: %-28s %5d of %d bytes\n", "total", total, budget)
+
+        if (total > budget)
+        {
+            print "ram_budget: over the RAM budget!"
+            exit 1
+        }
+    }
+' "$MAP"
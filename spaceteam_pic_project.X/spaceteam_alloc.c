@@ -0,0 +1,445 @@
+//
+// This file implements the request allocator. The master keeps a table
+//	of every input on every board which has a request on it, and hands
+//	out request slots (board and input) which aren't already taken.
+//	Slaves keep a few of these slots on hand so they never have to wait
+//	on the master to issue a request.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_alloc.h"
+#include "spaceteam_crit.h"
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// The request table. There is a word per board with a bit per request
+//	type. A slot is reserved from when it's handed out until the request
+//	on it is completed or fails, and it's outstanding once the request
+//	has actually been issued.
+unsigned req_reserved[NUM_PLAYERS];
+unsigned req_outstanding[NUM_PLAYERS];
+
+// The input ownership index. There is a word per board with a bit for
+//	each input the board has, so requests are only ever routed to a
+//	board which can actually complete them.
+unsigned board_inputs[NUM_PLAYERS];
+
+// The slots each slave is holding which it hasn't used yet, as
+//	GRANT_SLOT()s, or NO_GRANT. Our own row is the requests we've made
+//	ahead of time and not issued yet.
+unsigned char grant_slots[NUM_PLAYERS][REQ_GRANT_BATCH];
+
+// Number of requests issued on a slot which already had one
+unsigned alloc_conflicts;
+
+// Initialize the request table
+void init_alloc(void)
+{
+	int i, j;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		req_reserved[i] = 0;
+		req_outstanding[i] = 0;
+		board_inputs[i] = 0;
+
+		for (j = 0; j < REQ_GRANT_BATCH; j++)
+		{
+			grant_slots[i][j] = NO_GRANT;
+		}
+	}
+
+	// We know what inputs we have
+	board_inputs[THIS_PLAYER] = THIS_BOARD_INPUTS;
+
+	alloc_conflicts = 0;
+}
+
+// Note which inputs a board has when it joins the game
+void alloc_register_board(unsigned char player, unsigned inputs)
+{
+	board_inputs[player] = inputs;
+}
+
+// This function picks the board that a request from the passed board will
+//	be for. It's a random board other than the issuer, so that someone
+//	else has to do it, unless the issuer is playing alone.
+unsigned char alloc_pick_board(unsigned char issuer)
+{
+	unsigned char players;
+	unsigned char count = 0;
+	unsigned pick;
+	int i;
+
+	players = get_active_players();
+
+	// Count up the other boards
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if ( (i != issuer) && (players & PLAYER_BIT(i)) )
+		{
+			count++;
+		}
+	}
+
+	if (count == 0)
+	{
+		return issuer;
+	}
+
+	// And pick one of them
+	pick = random_in_range(count);
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if ( (i != issuer) && (players & PLAYER_BIT(i)) )
+		{
+			if (pick == 0)
+			{
+				break;
+			}
+			pick--;
+		}
+	}
+
+	return i;
+}
+
+// This function finds a free request slot for the passed board to issue,
+//	marks it reserved and writes it into the request. It returns
+//	FAILURE if it couldn't find one. It's called from the main loop and
+//	from timer 2, so the table is held while it's looked through.
+int alloc_request_slot(unsigned char issuer, spaceteam_request_t * req)
+{
+	spaceteam_req_t type;
+	unsigned char board;
+	unsigned taken;
+	int tries = 0;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	board = alloc_pick_board(issuer);
+
+	// The inputs we can't use are the ones with requests on them and
+	//	the ones which the board doesn't have
+	taken = req_reserved[board] | ~board_inputs[board];
+
+	do
+	{
+		type = random_request_type();
+		tries++;
+	} while ( (taken & (1 << type)) && (tries < REQ_GEN_MAX_TRIES) );
+
+	if (taken & (1 << type))
+	{
+		CRIT_EXIT(ipl);
+		return FAILURE;
+	}
+
+	req_reserved[board] |= (1 << type);
+
+	CRIT_EXIT(ipl);
+
+	req->type = type;
+	req->board = board;
+
+	return SUCCESS;
+}
+
+// The master sees every message about requests starting and ending,
+//	whether it's the one sending it or not. This function keeps the
+//	request table up to date with them.
+void alloc_note_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	switch(msg)
+	{
+		// A new request is for the recipient's board
+		case MSG_NEW_REQ:
+			if (req_outstanding[recipient] & (1 << req))
+			{
+				alloc_conflicts++;
+			}
+			req_reserved[recipient] |= (1 << req);
+			req_outstanding[recipient] |= (1 << req);
+
+			// If a slave issued it on a slot we gave it, it's used that
+			//	one up. One it picked itself doesn't use any.
+			alloc_use_grant(sender, GRANT_SLOT(recipient, req));
+			break;
+		// Completions come from the board the request was on
+		case MSG_REQ_COMPLETED:
+			alloc_end_request(sender, req);
+			break;
+		// Failures are sent to the board the request was on
+		case MSG_REQ_FAILED:
+			alloc_end_request(recipient, req);
+			break;
+		// A slave had no room for a slot we gave it. The value is the
+		//	board the slot is on.
+		case MSG_GRANT_RETURN:
+			alloc_release_grant(sender, req, val);
+			break;
+		default:
+			break;
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function takes the request on the passed input out of the table.
+//	A slave doesn't know which slots we've handed out, so the request may
+//	have been one it picked on its own board, on a slot someone is still
+//	holding. That slot stays reserved, so it isn't handed out twice.
+void alloc_end_request(unsigned char board, spaceteam_req_t type)
+{
+	req_outstanding[board] &= ~(1 << type);
+
+	if (!alloc_is_held(GRANT_SLOT(board, type)))
+	{
+		req_reserved[board] &= ~(1 << type);
+	}
+}
+
+// This function returns 1 if anyone is holding the passed GRANT_SLOT()
+int alloc_is_held(unsigned char slot)
+{
+	int i, j;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		for (j = 0; j < REQ_GRANT_BATCH; j++)
+		{
+			if (grant_slots[i][j] == slot)
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// This function notes that the passed board is holding the passed
+//	GRANT_SLOT(), if it has room. It's the slaves' grants, and the
+//	requests we've made ahead of time ourselves.
+void alloc_hold_grant(unsigned char player, unsigned char slot)
+{
+	unsigned ipl;
+	int i;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grant_slots[player][i] == NO_GRANT)
+		{
+			grant_slots[player][i] = slot;
+			break;
+		}
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns the number of slots the passed slave is holding
+unsigned char alloc_grants_held(unsigned char player)
+{
+	unsigned char count = 0;
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grant_slots[player][i] != NO_GRANT)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// This function notes that the passed slave has issued a request on
+//	the passed GRANT_SLOT(), if it's one we gave it
+void alloc_use_grant(unsigned char player, unsigned char slot)
+{
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grant_slots[player][i] == slot)
+		{
+			grant_slots[player][i] = NO_GRANT;
+			return;
+		}
+	}
+}
+
+// This function takes back a slot the passed slave will never use, so
+//	it's free for someone else
+void alloc_release_grant(unsigned char player, spaceteam_req_t type, unsigned char board)
+{
+	unsigned char slot = GRANT_SLOT(board, type);
+	unsigned ipl;
+	int i;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grant_slots[player][i] == slot)
+		{
+			grant_slots[player][i] = NO_GRANT;
+
+			// Nobody has issued a request on it yet, or we'd have
+			//	taken it out of the grants
+			if (!(req_outstanding[board] & (1 << type)))
+			{
+				req_reserved[board] &= ~(1 << type);
+			}
+			break;
+		}
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function takes back every slot the passed slave is holding. It's
+//	called when the slave was reset, since it lost them.
+void alloc_release_grants(unsigned char player)
+{
+	unsigned char slot;
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		slot = grant_slots[player][i];
+		if (slot != NO_GRANT)
+		{
+			alloc_release_grant(player, slot & 0x0F, slot >> 4);
+		}
+	}
+}
+
+// This function is called at 1KHz while the game is running. Every so
+//	often, it tops up the next slave which is short on request slots. A
+//	slot which doesn't make it into the radio's queue is freed again.
+void alloc_service(void)
+{
+	static unsigned char countdown = REQ_GRANT_PERIOD;
+	static unsigned char player = MASTER_PLAYER;
+	unsigned char players;
+	spaceteam_request_t grant;
+	unsigned ipl;
+	int i;
+
+	countdown -= 1;
+	if (countdown != 0)
+	{
+		return;
+	}
+	countdown = REQ_GRANT_PERIOD;
+
+	players = get_active_players();
+
+	// Look through the slaves, starting after the last one we topped up
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		player = player + 1;
+		if (player >= NUM_PLAYERS)
+		{
+			player = 0;
+		}
+
+		if ( (player != MASTER_PLAYER) && (players & PLAYER_BIT(player)) && (alloc_grants_held(player) < REQ_GRANT_BATCH) )
+		{
+			// The main loop reserves slots too, so it's held off until
+			//	this one is either out or back
+			CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+			if (alloc_request_slot(player, &grant) == SUCCESS)
+			{
+				if (send_message(MSG_REQ_GRANT, grant.type, THIS_PLAYER, player, grant.board) == SUCCESS)
+				{
+					alloc_hold_grant(player, GRANT_SLOT(grant.board, grant.type));
+				}
+				else
+				{
+					req_reserved[grant.board] &= ~(1 << grant.type);
+				}
+			}
+
+			CRIT_EXIT(ipl);
+			break;
+		}
+	}
+}
+
+// This function returns the number of conflicting requests seen
+unsigned alloc_get_conflicts(void)
+{
+	return alloc_conflicts;
+}
+
+#else
+
+// The request slots which the master has given us
+spaceteam_grant_t grants[REQ_GRANT_BATCH];
+
+// Initialize our request slots
+void init_alloc(void)
+{
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		grants[i].type = NO_GRANT;
+	}
+}
+
+// Store a request slot which the master has given us. If we've no room
+//	for it, it goes back so that the master can give it to someone else.
+void alloc_store_grant(spaceteam_req_t type, unsigned char board)
+{
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grants[i].type == NO_GRANT)
+		{
+			grants[i].type = type;
+			grants[i].board = board;
+			return;
+		}
+	}
+
+	send_message(MSG_GRANT_RETURN, type, THIS_PLAYER, MASTER_PLAYER, board);
+}
+
+// This function writes one of our request slots into the passed request.
+//	It returns FAILURE if we don't have any.
+int alloc_take_grant(spaceteam_request_t * req)
+{
+	int i;
+
+	for (i = 0; i < REQ_GRANT_BATCH; i++)
+	{
+		if (grants[i].type != NO_GRANT)
+		{
+			req->type = grants[i].type;
+			req->board = grants[i].board;
+			grants[i].type = NO_GRANT;
+			return SUCCESS;
+		}
+	}
+
+	return FAILURE;
+}
+
+#endif
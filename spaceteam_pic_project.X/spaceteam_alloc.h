@@ -0,0 +1,56 @@
+//
+// This is the include file for the request allocator. The master board
+//	owns a table of which inputs on which boards have requests on them,
+//	and hands out request slots so that no two boards ever ask for the
+//	same input at the same time.
+//
+
+#ifndef SPACETEAM_ALLOC_H_
+#define SPACETEAM_ALLOC_H_
+
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+
+// The number of granted request slots a slave keeps on hand, so that
+//	issuing a request never has to wait on the radio
+#define REQ_GRANT_BATCH			3
+
+// Number of 1KHz ticks between grants sent by the master, so that a
+//	grant is out of the air before the next one is sent
+#define REQ_GRANT_PERIOD		5
+
+// Slot value marking an empty grant
+#define NO_GRANT				0xFF
+
+// The master remembers each grant it has out as the board in the high
+//	nibble and the request type in the low one
+#define GRANT_SLOT(board, type)	(((board) << 4) | (type))
+
+// A request slot which has been handed out by the master
+typedef struct _spaceteam_grant_t
+{
+	unsigned char type;
+	unsigned char board;
+} spaceteam_grant_t;
+
+//
+// Function declarations
+//
+void init_alloc(void);
+int alloc_request_slot(unsigned char issuer, spaceteam_request_t * req);
+void alloc_note_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val);
+void alloc_register_board(unsigned char player, unsigned inputs);
+unsigned char alloc_pick_board(unsigned char issuer);
+void alloc_service(void);
+void alloc_end_request(unsigned char board, spaceteam_req_t type);
+int alloc_is_held(unsigned char slot);
+void alloc_hold_grant(unsigned char player, unsigned char slot);
+unsigned char alloc_grants_held(unsigned char player);
+void alloc_use_grant(unsigned char player, unsigned char slot);
+void alloc_release_grant(unsigned char player, spaceteam_req_t type, unsigned char board);
+void alloc_release_grants(unsigned char player);
+unsigned alloc_get_conflicts(void);
+void alloc_store_grant(spaceteam_req_t type, unsigned char board);
+int alloc_take_grant(spaceteam_request_t * req);
+
+#endif /* SPACETEAM_ALLOC_H_ */
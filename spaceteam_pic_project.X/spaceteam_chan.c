@@ -0,0 +1,321 @@
+//
+// This file implements the channel manager. The master scores each
+//	candidate channel by how many times the radio heard something on it,
+//	and the lowest score wins. A channel it has to move off of gets the
+//	highest score, so that moving again goes somewhere else.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_wireless.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_event.h"
+#include "spaceteam_chan.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// The channels we'll play on
+const unsigned char chan_candidates[CHAN_NUM_CANDIDATES] = {25, 50, 74, 78, 80, 82};
+
+// The candidate we're on, or were told to go to when the game begins
+unsigned char chan_idx;
+
+// Set once we've left the waiting room's channel
+unsigned char chan_moved;
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+	// How many times each candidate was busy when we listened to it
+	unsigned char chan_scores[CHAN_NUM_CANDIDATES];
+#else
+	// Whether we were told where to go when the game begins
+	unsigned char chan_pending;
+
+	// When we last heard from the master
+	unsigned chan_heard_at;
+#endif
+
+// This function starts us out with no channel picked
+void init_chan(void)
+{
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		int i;
+	#endif
+
+	chan_idx = 0;
+	chan_moved = 0;
+
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		for (i = 0; i < CHAN_NUM_CANDIDATES; i++)
+		{
+			chan_scores[i] = 0;
+		}
+	#else
+		chan_pending = 0;
+	#endif
+}
+
+// This function moves us to the passed candidate channel
+void chan_move(unsigned char idx)
+{
+	chan_idx = idx;
+	chan_moved = 1;
+	wl_module_set_channel(chan_candidates[idx]);
+}
+
+// This function goes back to the waiting room's channel once a game is
+//	over. It doesn't touch the radio if we never left, so it's safe to
+//	call before the radio is up.
+void chan_reset(void)
+{
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		chan_pending = 0;
+	#endif
+
+	if (chan_moved)
+	{
+		wl_module_set_channel(wl_module_CH);
+		chan_moved = 0;
+	}
+
+	// The waiting room is at the base rate too
+	wl_module_rate_reset();
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This function returns the quietest candidate, other than the one
+//	we're on if the game's begun
+unsigned char chan_pick(void)
+{
+	unsigned char i;
+	unsigned char best = CHAN_NUM_CANDIDATES;
+
+	for (i = 0; i < CHAN_NUM_CANDIDATES; i++)
+	{
+		if ( (i == chan_idx) && chan_moved )
+		{
+			continue;
+		}
+
+		if ( (best == CHAN_NUM_CANDIDATES) || (chan_scores[i] < chan_scores[best]) )
+		{
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+// This thread listens to each candidate channel in turn, a channel per
+//	pass of the scheduler, and picks the quietest. It's run by the
+//	master before the waiting room, while the radio has nothing to send.
+char chan_scan_thread(pt_t * pt)
+{
+	static unsigned char i;
+
+	PT_BEGIN(pt);
+
+	PT_WAIT_WHILE(pt, wl_module_tx_busy());
+
+	for (i = 0; i < CHAN_NUM_CANDIDATES; i++)
+	{
+		chan_scores[i] = wl_module_carrier_count(chan_candidates[i], CHAN_SCAN_SAMPLES);
+		PT_YIELD(pt);
+	}
+
+	chan_idx = chan_pick();
+
+	PT_END(pt);
+}
+
+// This function returns 1 if most of the links to slaves which we could
+//	judge lost too many payloads since the last check
+int chan_links_bad(void)
+{
+	unsigned char players;
+	unsigned char judged = 0;
+	unsigned char bad = 0;
+	unsigned delivered;
+	unsigned lost;
+	unsigned char i;
+
+	players = get_active_players();
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if ( (i == MASTER_PLAYER) || !(players & PLAYER_BIT(i)) )
+		{
+			continue;
+		}
+
+		wl_module_tx_take_link_stats(i, &delivered, &lost);
+
+		if ( (delivered == 0) || ((delivered + lost) < CHAN_MIN_SENT) )
+		{
+			continue;
+		}
+
+		judged++;
+		if ((lost * 100UL) >= ((unsigned long)CHAN_HOP_LOSS_PCT * (delivered + lost)))
+		{
+			bad++;
+		}
+	}
+
+	return ( (judged != 0) && ((2 * bad) > judged) );
+}
+
+// This thread keeps an eye on how the payloads are doing during a game,
+//	and moves everyone to another channel if too many are being lost on
+//	most of the links. The slaves are told first, and we follow once the
+//	news is out.
+char chan_thread(pt_t * pt)
+{
+	static unsigned char next;
+
+	PT_BEGIN(pt);
+
+	while (1)
+	{
+		PT_WAIT_UNTIL(pt, get_game_state() == GAME_STARTED);
+
+		// Start counting from here
+		chan_links_bad();
+
+		while (get_game_state() == GAME_STARTED)
+		{
+			PT_WAIT_MS(pt, CHAN_CHECK_MS);
+
+			if (!chan_links_bad())
+			{
+				continue;
+			}
+
+			// Don't come back here if we can help it
+			chan_scores[chan_idx] = 0xFF;
+			next = chan_pick();
+
+			// Send it now rather than waiting for more to go with it, and
+			//	don't move until it's out
+			send_message(MSG_CHANNEL, 0, THIS_PLAYER, ALL_PLAYERS, chan_candidates[next]);
+			msg_flush();
+			PT_WAIT_WHILE(pt, msg_pending() || wl_module_tx_busy());
+			chan_move(next);
+
+			// A reset from here on has to come back to the new one
+			event_post(EVENT_CHECKPOINT, 0);
+		}
+	}
+
+	PT_END(pt);
+}
+
+#else
+
+// This thread looks for the master if we haven't heard from it in a
+//	while during a game, by trying each candidate channel in turn
+char chan_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	while (1)
+	{
+		PT_WAIT_UNTIL(pt, (get_game_state() == GAME_STARTED) &&
+						  sched_ms_passed(chan_heard_at + CHAN_LOST_MS));
+
+		// The master drops back to the base rate when it loses us, so
+		//	try that before another channel
+		if (wl_module_get_rate() != WL_RATE_BASE)
+		{
+			wl_module_set_rate(WL_RATE_BASE);
+		}
+		else
+		{
+			chan_move((chan_idx + 1 < CHAN_NUM_CANDIDATES) ? (chan_idx + 1) : 0);
+		}
+		chan_heard_at = sched_get_ms();
+	}
+
+	PT_END(pt);
+}
+
+// This function notes where the master says to go. Before the game, we
+//	go there when it begins, and during it we go right away.
+void chan_set_pending(unsigned char channel)
+{
+	unsigned char i;
+
+	for (i = 0; i < CHAN_NUM_CANDIDATES; i++)
+	{
+		if (chan_candidates[i] == channel)
+		{
+			if (get_game_state() == GAME_STARTED)
+			{
+				chan_move(i);
+				chan_heard_at = sched_get_ms();
+				event_post(EVENT_CHECKPOINT, 0);
+			}
+			else
+			{
+				chan_idx = i;
+				chan_pending = 1;
+			}
+			return;
+		}
+	}
+}
+
+// This function notes that we've heard from the master
+void chan_note_heard(void)
+{
+	chan_heard_at = sched_get_ms();
+}
+
+#endif
+
+// This function returns the channel the game is to be played on
+unsigned char chan_get_chosen(void)
+{
+	return chan_candidates[chan_idx];
+}
+
+// This function returns the candidate the game is on, for the checkpoint
+unsigned char chan_get_idx(void)
+{
+	return chan_idx;
+}
+
+// This function picks the game's channel back up from a checkpoint, so
+//	that chan_begin() goes back to it. Slaves which lost us while we were
+//	out will have gone hunting, and come back round to it.
+void chan_restore(unsigned char idx)
+{
+	if (idx >= CHAN_NUM_CANDIDATES)
+	{
+		return;
+	}
+
+	chan_idx = idx;
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		chan_pending = 1;
+	#endif
+}
+
+// This function moves to the game's channel once the game begins. The
+//	master waits for the begin message to get out first.
+void chan_begin(void)
+{
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		chan_move(chan_idx);
+	#else
+		if (chan_pending)
+		{
+			chan_move(chan_idx);
+			chan_pending = 0;
+		}
+		chan_heard_at = sched_get_ms();
+	#endif
+}
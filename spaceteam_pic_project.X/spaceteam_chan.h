@@ -0,0 +1,54 @@
+//
+// This is the include file for the channel manager. Every board starts
+//	out on wl_module_CH, where the waiting room is held. Before it, the
+//	master listens to each of a few candidate channels with the radio's
+//	received power detector and picks the quietest. It tells each slave
+//	which one in the join handshake, and everyone moves there when the
+//	game begins. If too many payloads go missing on most of the links
+//	during the game, the master moves everyone to the next quietest.
+//
+
+#ifndef SPACETEAM_CHAN_H_
+#define SPACETEAM_CHAN_H_
+
+#include "spaceteam_pt.h"
+
+// The channels we'll play on. They're in the gaps between Wi-Fi
+//	channels 1, 6 and 11, apart from the waiting room's.
+#define CHAN_NUM_CANDIDATES		6
+
+// How many times each channel is sampled while scanning
+#define CHAN_SCAN_SAMPLES		16
+
+// The master checks how the payloads to each slave are doing every
+//	CHAN_CHECK_MS. A link is bad if at least CHAN_HOP_LOSS_PCT of them
+//	needed our retries or failed, out of at least CHAN_MIN_SENT, and we
+//	move if more than half of the links are bad. A slave which nothing
+//	got through to at all is off or lost rather than on a bad channel,
+//	so it doesn't count either way.
+#define CHAN_CHECK_MS			1000
+#define CHAN_HOP_LOSS_PCT		25
+#define CHAN_MIN_SENT			16
+
+// A slave which hasn't heard from the master for CHAN_LOST_MS during a
+//	game missed a move, and goes looking on the next candidate channel
+#define CHAN_LOST_MS			300
+
+//
+// Function declarations
+//
+void init_chan(void);
+void chan_reset(void);
+char chan_scan_thread(pt_t * pt);
+char chan_thread(pt_t * pt);
+void chan_move(unsigned char idx);
+unsigned char chan_pick(void);
+int chan_links_bad(void);
+unsigned char chan_get_chosen(void);
+void chan_set_pending(unsigned char channel);
+void chan_begin(void);
+unsigned char chan_get_idx(void);
+void chan_restore(unsigned char idx);
+void chan_note_heard(void);
+
+#endif /* SPACETEAM_CHAN_H_ */
@@ -0,0 +1,277 @@
+//
+// This file implements the game checkpoints. The data EEPROM holds a ring
+//	of checkpoint slots, and each save goes into the slot after the
+//	newest one with the next sequence number, so that every slot wears
+//	evenly. A save is written a word at a time from the main loop, with
+//	the NVM interrupt waking us when the EEPROM is ready for the next
+//	one, so the game never waits on it.
+//
+// The checksum word of a slot is erased first and written last, so a
+//	save which is cut off by a brownout leaves a slot which fails its
+//	checksum, and the save before it is still the newest good one.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_chan.h"
+#include "spaceteam_sched.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// Make sure the checkpoint is the size we write
+typedef char checkpoint_fits[(sizeof(spaceteam_checkpoint_t) == (CHECKPOINT_WORDS * 2)) ? 1 : -1];
+
+// And that every candidate channel fits in its field
+typedef char checkpoint_chan_fits[(CHAN_NUM_CANDIDATES <= (1 << CHECKPOINT_CHAN_BITS)) ? 1 : -1];
+
+// The checkpoint slots in the data EEPROM
+unsigned __attribute__((space(eedata))) checkpoint_ee[CHECKPOINT_SLOTS * CHECKPOINT_WORDS];
+
+// The save being written
+spaceteam_checkpoint_t checkpoint_buf;
+// The newest slot, and its sequence number
+unsigned char checkpoint_slot;
+unsigned checkpoint_seq;
+// Whether the newest slot holds a good checkpoint
+unsigned char checkpoint_valid;
+// Whether we came up from a reset the game can survive
+unsigned char checkpoint_warm;
+// How far along the save is, or CHECKPOINT_IDLE
+unsigned char checkpoint_step;
+// Set if a save was asked for while one was being written, or too soon
+//	after the last one
+unsigned char checkpoint_pending;
+// When the last save was started, in scheduler ms
+unsigned checkpoint_saved_at;
+
+// This function returns the EEPROM address of a word in a slot
+_prog_addressT checkpoint_addr(unsigned char slot, unsigned char word)
+{
+	_prog_addressT addr;
+
+	_init_prog_address(addr, checkpoint_ee);
+
+	return addr + (2 * ((slot * CHECKPOINT_WORDS) + word));
+}
+
+// This function reads the checkpoint in a slot, and returns SUCCESS if
+//	it's a good one
+int checkpoint_read(unsigned char slot, spaceteam_checkpoint_t * ckpt)
+{
+	_memcpy_p2d16((char *)ckpt, checkpoint_addr(slot, 0), sizeof(spaceteam_checkpoint_t));
+
+	if ( (ckpt->magic != CHECKPOINT_MAGIC) || (ckpt->check != checkpoint_sum(ckpt)) )
+	{
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+// Find the newest checkpoint, and note whether this reset is one that a
+//	game can be picked back up from. A power-on reset means the board
+//	was switched off, so the game it was in is long gone, but anything
+//	else (a brownout, the reset button or a trap) is just a blip.
+void init_checkpoint(void)
+{
+	spaceteam_checkpoint_t ckpt;
+	unsigned char slot;
+
+	checkpoint_warm = !RCONbits.POR;
+	RCONbits.POR = 0;
+	RCONbits.BOR = 0;
+
+	checkpoint_valid = 0;
+	checkpoint_slot = CHECKPOINT_SLOTS - 1;
+	checkpoint_seq = 0;
+	checkpoint_step = CHECKPOINT_IDLE;
+	checkpoint_pending = 0;
+	checkpoint_saved_at = sched_get_ms() - CHECKPOINT_MIN_GAP_MS;
+
+	// The newest slot is the good one with the highest sequence number.
+	//	The sequence number wraps, so compare them by their difference.
+	for (slot = 0; slot < CHECKPOINT_SLOTS; slot++)
+	{
+		if (checkpoint_read(slot, &ckpt) != SUCCESS)
+		{
+			continue;
+		}
+
+		if ( !checkpoint_valid || ((int)(ckpt.seq - checkpoint_seq) > 0) )
+		{
+			checkpoint_valid = 1;
+			checkpoint_slot = slot;
+			checkpoint_seq = ckpt.seq;
+		}
+	}
+
+	// Wake the main loop when the EEPROM finishes a word
+	CHECKPOINT_PRIORITY = 1;
+	CHECKPOINT_INT_FLAG = 0;
+	CHECKPOINT_INT_ENABLE = 1;
+}
+
+// This function reads the newest checkpoint into the passed one. It
+//	returns SUCCESS if there is a game in it we can resume, which is
+//	only after a warm reset.
+int checkpoint_load(spaceteam_checkpoint_t * ckpt)
+{
+	if ( !checkpoint_warm || !checkpoint_valid )
+	{
+		return FAILURE;
+	}
+
+	if (checkpoint_read(checkpoint_slot, ckpt) != SUCCESS)
+	{
+		return FAILURE;
+	}
+
+	if (ckpt->game_state != GAME_STARTED)
+	{
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+// This function saves the game. The state is copied out right away,
+//	and written in the background by checkpoint_service. If a save is
+//	already being written, or the last one was too recent, this one is
+//	started by checkpoint_service later on.
+void checkpoint_save(void)
+{
+	unsigned ipl;
+
+	if ( (checkpoint_step != CHECKPOINT_IDLE) ||
+		 !sched_ms_passed(checkpoint_saved_at + CHECKPOINT_MIN_GAP_MS) )
+	{
+		checkpoint_pending = 1;
+		return;
+	}
+	checkpoint_pending = 0;
+	checkpoint_saved_at = sched_get_ms();
+
+	// Hold off the interrupts so we get the game all in one piece
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+	game_get_checkpoint(&checkpoint_buf);
+	CRIT_EXIT(ipl);
+
+	checkpoint_buf.magic = CHECKPOINT_MAGIC;
+	checkpoint_buf.seq = checkpoint_seq + 1;
+	checkpoint_buf.check = checkpoint_sum(&checkpoint_buf);
+
+	// It goes in the slot after the newest one
+	checkpoint_slot = checkpoint_slot + 1;
+	if (checkpoint_slot >= CHECKPOINT_SLOTS)
+	{
+		checkpoint_slot = 0;
+	}
+	checkpoint_seq = checkpoint_buf.seq;
+	checkpoint_valid = 1;
+
+	checkpoint_step = 0;
+	checkpoint_service();
+}
+
+// This function is called from the main loop. If a save is being
+//	written and the EEPROM isn't busy, it starts on the next step. The
+//	checksum is erased first, then each of the other words is erased and
+//	written, and the checksum is written last. If a save was held back,
+//	it's started once it's allowed.
+void checkpoint_service(void)
+{
+	unsigned char word;
+	unsigned char erase;
+	unsigned ipl;
+
+	if (checkpoint_step == CHECKPOINT_IDLE)
+	{
+		if (checkpoint_pending)
+		{
+			checkpoint_save();
+		}
+		return;
+	}
+
+	if (NVMCONbits.WR)
+	{
+		return;
+	}
+
+	// All the steps are done
+	if (checkpoint_step == (2 * CHECKPOINT_WORDS))
+	{
+		checkpoint_step = CHECKPOINT_IDLE;
+		if (checkpoint_pending)
+		{
+			checkpoint_save();
+		}
+		return;
+	}
+
+	// Work out which word this step is for, and whether it's an erase
+	if (checkpoint_step == 0)
+	{
+		word = CHECKPOINT_WORDS - 1;
+		erase = 1;
+	}
+	else if (checkpoint_step == (2 * CHECKPOINT_WORDS) - 1)
+	{
+		word = CHECKPOINT_WORDS - 1;
+		erase = 0;
+	}
+	else
+	{
+		word = (checkpoint_step - 1) / 2;
+		erase = checkpoint_step & 1;
+	}
+
+	// The unlock sequence can't be broken up by anything, not even the
+	//	LED scan
+	CRIT_ENTER(ipl, 7);
+	if (erase)
+	{
+		_erase_eedata(checkpoint_addr(checkpoint_slot, word), _EE_WORD);
+	}
+	else
+	{
+		_write_eedata_word(checkpoint_addr(checkpoint_slot, word), ((unsigned *)&checkpoint_buf)[word]);
+	}
+	CRIT_EXIT(ipl);
+
+	checkpoint_step++;
+}
+
+// This function returns 1 while a save is being written, or is being
+//	held back until it's allowed
+int checkpoint_busy(void)
+{
+	return ( (checkpoint_step != CHECKPOINT_IDLE) || checkpoint_pending );
+}
+
+// This function returns the checksum of a checkpoint. The sum is rotated
+//	a bit every word, so that words which are swapped around are caught.
+unsigned checkpoint_sum(const spaceteam_checkpoint_t * ckpt)
+{
+	const unsigned * words = (const unsigned *)ckpt;
+	unsigned sum = 0;
+	int i;
+
+	for (i = 0; i < CHECKPOINT_WORDS - 1; i++)
+	{
+		sum = ((sum << 1) | (sum >> 15)) + words[i];
+	}
+
+	return ~sum;
+}
+
+// This is the NVM interrupt. The EEPROM is done with a word, so there's
+//	nothing to do except let the main loop run and start the next one.
+void _ISR _NVMInterrupt(void)
+{
+	CHECKPOINT_INT_FLAG = 0;
+}
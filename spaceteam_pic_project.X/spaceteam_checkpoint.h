@@ -0,0 +1,77 @@
+//
+// This is the include file for the game checkpoints. While a game is
+//	running, its state is saved to the data EEPROM whenever it changes,
+//	so that a board which browns out or is reset can pick the game back
+//	up where it left off instead of going back to the waiting room.
+//
+
+#ifndef SPACETEAM_CHECKPOINT_H_
+#define SPACETEAM_CHECKPOINT_H_
+
+#include "spaceteam_game.h"
+#include <libpic30.h>
+
+// Width of the saved channel
+#define CHECKPOINT_CHAN_BITS	4
+
+// A saved game. This is written to the EEPROM word for word, so its
+//	size has to stay CHECKPOINT_WORDS words.
+typedef struct _spaceteam_checkpoint_t
+{
+	unsigned 		magic;							// CHECKPOINT_MAGIC
+	unsigned 		seq;							// Goes up by one every save
+	unsigned 		game_state 	: 4;				// A game_state_t
+	unsigned 		chan_idx 	: CHECKPOINT_CHAN_BITS;	// The candidate channel the game is on
+	unsigned 		players 	: 8;				// The players in the game, a bit per player
+	unsigned char 	health;
+	unsigned char 	issue_limit;
+	unsigned char 	reqs_completed;
+	unsigned char 	shown_req;
+	unsigned 		lfsr;							// The random number generator
+	issued_req_t 	reqs[MAX_ISSUED_REQS];			// The requests we had out
+	unsigned 		check;							// Checksum of everything above
+} spaceteam_checkpoint_t;
+
+// Size of a checkpoint, in EEPROM words
+#define CHECKPOINT_WORDS		16
+
+// Marks a slot as holding a checkpoint. The low byte is the version of
+//	the layout above, which has to change whenever the layout does.
+#define CHECKPOINT_MAGIC		0x5C02
+
+// The data EEPROM is split into slots, and each save goes into the slot
+//	after the last one so that the wear is spread over all of them. The
+//	PIC24F16KL402 has 512 bytes of data EEPROM.
+#define CHECKPOINT_EE_WORDS		256
+#define CHECKPOINT_SLOTS		(CHECKPOINT_EE_WORDS / CHECKPOINT_WORDS)
+
+// The least time between the start of two saves, in ms. A save asked
+//	for sooner is held until then, which keeps a burst of changes from
+//	cycling through the slots. At worst every slot is rewritten once per
+//	CHECKPOINT_SLOTS saves, so each word is erased every 80s or so, and
+//	the EEPROM's 100,000 erases last a good couple of thousand hours.
+#define CHECKPOINT_MIN_GAP_MS	5000
+
+// Value for no save in progress
+#define CHECKPOINT_IDLE			0xFF
+
+// The NVM interrupt, which tells us when the EEPROM is ready for the next
+//	word. It only has to wake the main loop, so it's the lowest priority.
+#define CHECKPOINT_INT_ENABLE	IEC0bits.NVMIE
+#define CHECKPOINT_INT_FLAG		IFS0bits.NVMIF
+#define CHECKPOINT_PRIORITY		IPC3bits.NVMIP
+
+//
+// Function declarations
+//
+void init_checkpoint(void);
+_prog_addressT checkpoint_addr(unsigned char slot, unsigned char word);
+int checkpoint_read(unsigned char slot, spaceteam_checkpoint_t * ckpt);
+int checkpoint_load(spaceteam_checkpoint_t * ckpt);
+void checkpoint_save(void);
+void checkpoint_service(void);
+int checkpoint_busy(void);
+unsigned checkpoint_sum(const spaceteam_checkpoint_t * ckpt);
+void _ISR _NVMInterrupt(void);
+
+#endif /* SPACETEAM_CHECKPOINT_H_ */
@@ -0,0 +1,114 @@
+//
+// This file implements the clock governor. The main loop tells it when
+//	it has run out of work, and from then on the CPU dozes. Anything
+//	which needs to be fast (radio handling, SPI bursts and display
+//	refreshes) boosts back to full speed for as long as it runs. Boosts
+//	nest, since they can come from interrupts at any priority.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_clock.h"
+#include "spaceteam_crit.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// Set when the main loop has no work
+volatile unsigned char clock_idle;
+// Number of boosts which haven't been released
+volatile unsigned char clock_boosts;
+// How much the CPU clock is divided down right now, as a shift
+volatile unsigned char clock_shift;
+
+// This function dozes the CPU if nobody needs it fast, and wakes it
+//	up otherwise. It has to be called with interrupts held off.
+void clock_apply(void)
+{
+	if ( (clock_idle != 0) && (clock_boosts == 0) )
+	{
+		CLKDIVbits.DOZEN = 1;
+		clock_shift = CLOCK_DOZE_SHIFT;
+	}
+	else
+	{
+		CLKDIVbits.DOZEN = 0;
+		clock_shift = 0;
+	}
+}
+
+// Start out at full speed. Interrupts don't end Doze mode on their own,
+//	since most of them are short enough to be fine dozing.
+void init_clock(void)
+{
+	clock_idle = 0;
+	clock_boosts = 0;
+	clock_shift = 0;
+
+	CLKDIVbits.DOZEN = 0;
+	CLKDIVbits.ROI = 0;
+	CLKDIVbits.DOZE = CLOCK_DOZE_SHIFT;
+}
+
+// This function is called by the main loop to say whether it has
+//	any work left
+void clock_set_idle(unsigned char idle)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+	clock_idle = idle;
+	clock_apply();
+	CRIT_EXIT(ipl);
+}
+
+// This function runs the CPU at full speed until the matching
+//	clock_release
+void clock_boost(void)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+	clock_boosts++;
+	clock_apply();
+	CRIT_EXIT(ipl);
+}
+
+// This function ends a boost
+void clock_release(void)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+	if (clock_boosts != 0)
+	{
+		clock_boosts--;
+	}
+	clock_apply();
+	CRIT_EXIT(ipl);
+}
+
+// This function waits for the passed number of microseconds at
+//	whatever speed the CPU is running
+void clock_delay_us(unsigned us)
+{
+	unsigned long cycles;
+
+	cycles = ((unsigned long)us * CLOCK_CYCLES_PER_US) >> clock_shift;
+
+	if (cycles > CLOCK_MIN_DELAY)
+	{
+		__delay32(cycles);
+	}
+}
+
+// This function waits for the passed number of milliseconds at
+//	whatever speed the CPU is running
+void clock_delay_ms(unsigned ms)
+{
+	while (ms != 0)
+	{
+		clock_delay_us(1000);
+		ms--;
+	}
+}
@@ -0,0 +1,34 @@
+//
+// This is the include file for the clock governor. Most of what the
+//	boards do is a few comparisons on a timer tick, so when there's no
+//	real work the CPU is slowed down with Doze mode. The peripherals keep
+//	running off the full clock, so timer periods and the SPI rate don't
+//	change, but CPU delays have to account for it.
+//
+
+#ifndef SPACETEAM_CLOCK_H_
+#define SPACETEAM_CLOCK_H_
+
+// The instruction clock at full speed, which the peripherals always
+//	run from
+#define CLOCK_FCY				8000000UL
+#define CLOCK_CYCLES_PER_US		(CLOCK_FCY / 1000000UL)
+
+// How much Doze mode slows the CPU. The DOZE bits divide the CPU clock
+//	by 2 to the power of their value, so 2 is a quarter of full speed.
+#define CLOCK_DOZE_SHIFT		2
+
+// __delay32 can't wait for less than this many cycles
+#define CLOCK_MIN_DELAY			12
+
+//
+// Function declarations
+//
+void init_clock(void);
+void clock_set_idle(unsigned char idle);
+void clock_boost(void);
+void clock_release(void);
+void clock_delay_us(unsigned us);
+void clock_delay_ms(unsigned ms);
+
+#endif /* SPACETEAM_CLOCK_H_ */
@@ -0,0 +1,34 @@
+//
+// This is the include file for critical sections. Rather than turning
+//	off interrupts with DISI (which doesn't hold off priority 7 anyway),
+//	a critical section raises the CPU priority to the highest priority
+//	of the interrupts which share what it touches. Interrupts above that
+//	keep running, so the LED scan never has to wait on the SPI.
+//
+
+#ifndef SPACETEAM_CRIT_H_
+#define SPACETEAM_CRIT_H_
+
+// The radio interrupt is the highest priority which uses the SPI, the
+//	pools, the event queue or the clock governor. Only the LED scan runs
+//	above it, and it shares nothing but its framebuffer.
+#define RADIO_INT_PRIORITY		6
+
+// Priority which code runs at while it touches anything the radio
+//	interrupt could also be touching
+#define CRIT_SHARED_IPL			RADIO_INT_PRIORITY
+
+// Priority which code runs at while it talks to a chip over the SPI. A
+//	whole chip select frame is done at this priority, and nothing longer,
+//	so the longest any interrupt waits on the SPI is one frame.
+#define CRIT_SPI_IPL			CRIT_SHARED_IPL
+
+// Raises the CPU priority to level, saving the old one. If we're already
+//	above level (say we're in a higher priority interrupt) it's left
+//	alone, so these can be nested and called from anywhere.
+#define CRIT_ENTER(saved, level)	do { (saved) = SRbits.IPL; if ((saved) < (level)) { SRbits.IPL = (level); } } while (0)
+
+// Puts the CPU priority back to what it was at the matching CRIT_ENTER
+#define CRIT_EXIT(saved)			do { SRbits.IPL = (saved); } while (0)
+
+#endif /* SPACETEAM_CRIT_H_ */
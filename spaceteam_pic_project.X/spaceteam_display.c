@@ -3,12 +3,15 @@
 //
 
 #include "xc.h"
+#include "spaceteam_clock.h"
 #include <stddef.h>
 #include "spaceteam_spi.h"
 #include "spaceteam_io.h"
 #include "spaceteam_game.h"
 #include "spaceteam_display.h"
 #include "spaceteam_req.h"
+#include "spaceteam_script.h"
+#include "spaceteam_crit.h"
 
 #define FCY 8000000UL
 #include <libpic30.h>
@@ -27,6 +30,36 @@ unsigned char line_2_new;
 unsigned char line_1_len;
 unsigned char line_2_len;
 
+// How the init scripts talk to the display. Its busy flag and memory
+//	can't be read back through the shift register.
+const script_bus_t display_bus =
+	{
+		display_write_commands,
+		NULL
+	};
+
+// The steps of a display reset. Each command already waits out the
+//	37us the display takes with it, and the long waits between the
+//	steps are left to whoever runs them.
+const script_op_t display_start_script[] =
+	{
+		{ DISPLAY_COMMAND, DISPLAY_FUNCTION_SET_DATA, 0, 0 }
+	};
+
+const script_op_t display_wake_script[] =
+	{
+		{ DISPLAY_COMMAND, DISPLAY_FUNCTION_SET_DATA, 0, 0 }
+	};
+
+const script_op_t display_config_script[] =
+	{
+		{ DISPLAY_COMMAND, DISPLAY_FUNCTION_SET_DATA, 0, 0 },
+		{ DISPLAY_COMMAND, DISPLAY_FUNCTION_SET_DATA, 0, 0 },
+		{ DISPLAY_COMMAND, DISPLAY_ON_DATA, 0, 0 },
+		{ DISPLAY_COMMAND, DISPLAY_ENTRY_MODE_DATA, 0, 0 },
+		{ DISPLAY_COMMAND, DISPLAY_CLEAR_DATA, 0, 0 }
+	};
+
 // This function initializes the display
 void init_display(void)
 {
@@ -62,12 +95,11 @@ void init_display(void)
 	line_1_len = 0;
 	line_2_len = 0;
 
-	// Set up the timer 4 interrupt for scrolling
+	// Set up the timer 4 interrupt for scrolling. There's nothing for it
+	//	to write until the display has been reset, which the startup
+	//	sequencer does.
 	init_timer_4();
 
-	// Now, reset the display and we are done
-	display_reset();
-
 }
 
 // This function initializes the timer 4 interrupt which
@@ -100,20 +132,25 @@ void init_timer_4(void)
 void _ISR _T4Interrupt(void)
 {
 	static unsigned char int_counter = 0;
+	unsigned ipl;
 
 	// If we have a new line to write , or if it's time to scroll 
 	if ( (line_1_new == NEW_LINE) || ( (int_counter == (TIMER_4_INT_SCROLL - 1) ) && (line_1_scroll_on == SCROLL_ON) ) )
 	{
-		// Rewrite the line
+		// Rewrite the line, at full speed
+		clock_boost();
 		display_line_buf(DISPLAY_LINE_1);
+		clock_release();
 		// Note that we don't have a new line
 		line_1_new = NO_NEW_LINE;
 	}
 
 	if ( (line_2_new == NEW_LINE) || ( (int_counter == (TIMER_4_INT_SCROLL - 1) ) && (line_2_scroll_on == SCROLL_ON) ) )
 	{
-		// Rewrite the line
+		// Rewrite the line, at full speed
+		clock_boost();
 		display_line_buf(DISPLAY_LINE_2);
+		clock_release();
 		// Note that we don't have a new line
 		line_2_new = NO_NEW_LINE;
 	}
@@ -122,6 +159,17 @@ void _ISR _T4Interrupt(void)
 	//	to only scroll the display when int_counter = T4_INT_SCROLL
 	int_counter = (int_counter + 1) % TIMER_4_INT_SCROLL;
 
+	// If there's nothing left to write or scroll, stop interrupting
+	//	until there is, so that we don't keep the CPU awake. Hold off
+	//	the other interrupts while we decide, so that a line written
+	//	in between doesn't get stuck.
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+	if (!display_needs_tick())
+	{
+		TIMER_4_INT_ENABLE = 0;
+	}
+	CRIT_EXIT(ipl);
+
 	// Need to clear the interrupt Flag
 	TIMER_4_INT_FLAG = 0;
 }
@@ -195,25 +243,22 @@ void display_line_buf(unsigned char line)
 // This function sets the display control signals 
 void display_set_control_sigs(unsigned data)
 {
-	unsigned new_portb_val;
-
-	// Get the previous value of PORTB
-	new_portb_val = PORTB;
-	// Clear the display bits of the old value of portB, AND away all but the display bits 
-	//	of the data input, and or the data input into the portB value
-	new_portb_val = ((new_portb_val & DISPLAY_CONTROL_MASK) | (data & (~DISPLAY_CONTROL_MASK)));
-	// Write the new value to portb;
-	LATB = new_portb_val;
+	// Only the display bits are written, so the LED scan, the radio's
+	//	CE and the RFID chip select are left as they are
+	set_latb_bits(~DISPLAY_CONTROL_MASK, data);
 }
 
 // This function writes a control command to the display
 void display_write_command(unsigned char data)
 {
+	unsigned ipl;
 
 	// Write the data to the shift register over the SPI connection. 
 	//	NOTE: The SPI clock is running at 1/2 of the system clock, 
 	//	so it will take 2*8 system clocks for the data to be valid, 
-	//	which should work out
+	//	which should work out. The control lines are on the same port
+	//	as the RFID chip select, so they're part of the frame too.
+	ipl = spi_begin();
 	spi_write(data);
 
 	// Need to set up the control signals to begin the write
@@ -234,8 +279,10 @@ void display_write_command(unsigned char data)
 	//	so we can drop E and call it a day
 	display_set_control_sigs(RS_LOW | RW_LOW | E_LOW);
 
+	spi_end(ipl);
+
 	// Display writes take up to 37 us to complete
-	__delay_us(37);
+	clock_delay_us(37);
 
 	return;
 }
@@ -245,6 +292,8 @@ void display_write_command(unsigned char data)
 //	for this kind of thing
 void display_write_char(unsigned char data)
 {
+	unsigned ipl;
+
 	// Write the data to the shift register over the SPI connection. 
 	//	NOTE: The SPI clock is running at 1/2 of the system clock, 
 	//	so it will take 2*8 system clocks for the data to be valid, 
@@ -252,6 +301,7 @@ void display_write_char(unsigned char data)
 
 	// Write the data passed if the data is non-NULL, else
 	//	write a space
+	ipl = spi_begin();
 	if (data != 0)
 	{
 		spi_write(data);
@@ -271,8 +321,10 @@ void display_write_char(unsigned char data)
 	//	so we can drop E and call it a day
 	display_set_control_sigs(RS_HIGH | RW_LOW | E_LOW);
 
+	spi_end(ipl);
+
 	// Display writes take up to 37 us to complete
-	__delay_us(37);
+	clock_delay_us(37);
 
 	return;
 }
@@ -324,38 +376,53 @@ void display_write_hex(unsigned data, unsigned char line)
 }
 
 // This function performs a display reset. Use it if the power-on-reset
-//	for the display doesn't work
+//	for the display doesn't work. The display's busy flag can't be read
+//	back through the shift register, so each step waits out the time
+//	the datasheet gives it. The startup sequencer runs the steps itself
+//	so that it can do other things while the display is busy.
 void display_reset(void)
 {
-	// Do a function set
-	display_write_command(DISPLAY_FUNCTION_SET_DATA);
-
-	// Wait for > 4.1ms
-	__delay_ms(5);
+	display_reset_start();
+	clock_delay_us(DISPLAY_RESET_START_US);
 
-	// Do another function set
-	display_write_command(DISPLAY_FUNCTION_SET_DATA);
+	display_reset_wake();
+	clock_delay_us(DISPLAY_RESET_WAKE_US);
 
-	// Wait for > 100 us
-	__delay_ms(1);
+	display_reset_config();
+	clock_delay_us(DISPLAY_CLEAR_US);
+}
 
-	// Do another function set
-	display_write_command(DISPLAY_FUNCTION_SET_DATA);
+// This function starts a display reset with the first function set. The
+//	display needs DISPLAY_RESET_START_US before the next step.
+int display_reset_start(void)
+{
+	return script_run(&display_bus, display_start_script, SCRIPT_LEN(display_start_script));
+}
 
-	//
-	// Now fire off a bunch of commands in sequence to 
-	//	configure the thing
-	//
-	display_write_command(DISPLAY_FUNCTION_SET_DATA);
-	display_write_command(DISPLAY_ON_DATA);
-	display_write_command(DISPLAY_ENTRY_MODE_DATA);
-	display_write_command(DISPLAY_CLEAR_DATA);
+// This function does the second function set of a reset. The display
+//	needs DISPLAY_RESET_WAKE_US before the next step.
+int display_reset_wake(void)
+{
+	return script_run(&display_bus, display_wake_script, SCRIPT_LEN(display_wake_script));
+}
 
-	__delay_ms(2);
+// This function finishes a reset by configuring the display and
+//	clearing it. The clear takes DISPLAY_CLEAR_US.
+int display_reset_config(void)
+{
+	return script_run(&display_bus, display_config_script, SCRIPT_LEN(display_config_script));
+}
 
+// This function writes a list of commands to the display. The display
+//	has no registers, so the register is ignored.
+void display_write_commands(unsigned char reg, const unsigned char * cmds, unsigned char len)
+{
+	unsigned char i;
 
-	// Should be all done, so just return
-	return;
+	for (i = 0; i < len; i++)
+	{
+		display_write_command(cmds[i]);
+	}
 }
 
 // This function sets the display RAM address to the passed
@@ -365,7 +432,7 @@ void display_set_address(unsigned char address)
 {
 	display_write_command(DISPLAY_ADDRESS_DATA | address);
 
-	__delay_us(50);
+	clock_delay_us(50);
 }
 
 // This function just copies the line passed into the appropriate 
@@ -403,8 +470,9 @@ void display_write_line(unsigned char line, char * str)
 	// Next, copy the string into the buffer
 	*len_ptr = display_copy_string(str, buffer);
 	// Finally, note that we have a new line to the 
-	//	display interrupt
+	//	display interrupt, and make sure that it's running
 	*new_line_ptr = NEW_LINE;
+	TIMER_4_INT_ENABLE = 1;
 
 }
 
@@ -413,7 +481,7 @@ void display_clear(void)
 {
 	// Send the clear and wait a bit
 	display_write_command(DISPLAY_CLEAR_DATA);
-	__delay_ms(2);
+	clock_delay_us(DISPLAY_CLEAR_US);
 }
 
 // This function converts a decimal value to its ASCII string equivalent
@@ -440,15 +508,13 @@ void dec_to_string(unsigned val, char * buf)
 	buf[count] = 0;
 }
 
-// This function takes a request type, board and value and prints out
-//	the appropriate string on the display. 
-//
-// 
-void display_write_request(spaceteam_req_t req, unsigned char board, unsigned val)
+// This function takes a request type, board and value and renders the
+//	request string into the passed buffer, which must be DISP_MAX_STR_LEN
+//	long. It returns the length of the string.
+unsigned char display_render_request(spaceteam_req_t req, unsigned char board, unsigned val, char * request)
 {
 	char * req_verb;
 	char * req_name;
-	char request[DISP_MAX_STR_LEN];
 	unsigned char len = 0;
 	char val_str[5];
 
@@ -489,6 +555,19 @@ void display_write_request(spaceteam_req_t req, unsigned char board, unsigned va
 		len += display_copy_string(val_str, &request[len]);
 	}
 
+	return len;
+}
+
+// This function takes a request type, board and value and prints out
+//	the appropriate string on the display. 
+//
+// 
+void display_write_request(spaceteam_req_t req, unsigned char board, unsigned val)
+{
+	char request[DISP_MAX_STR_LEN];
+
+	display_render_request(req, board, val, request);
+
 	// When all done, write the request to the display
 	display_write_line(DISPLAY_LINE_1, request);
 
@@ -552,6 +631,31 @@ void display_scroll_set(unsigned char line, unsigned char setting)
 		line_2_scroll_on = setting;
 		line_2_scroll_idx = 0;
 	}
+
+	// The display interrupt may need to start scrolling
+	TIMER_4_INT_ENABLE = 1;
+}
+
+// This function returns 1 if the display interrupt has something to do,
+//	either a new line to write or a line long enough to scroll
+int display_needs_tick(void)
+{
+	if ( (line_1_new == NEW_LINE) || (line_2_new == NEW_LINE) )
+	{
+		return 1;
+	}
+
+	if ( (line_1_scroll_on == SCROLL_ON) && (line_1_len > DISP_CHARS_PER_LINE) )
+	{
+		return 1;
+	}
+
+	if ( (line_2_scroll_on == SCROLL_ON) && (line_2_len > DISP_CHARS_PER_LINE) )
+	{
+		return 1;
+	}
+
+	return 0;
 }
 
 // This function takes a key buffer and displays it on the second line 
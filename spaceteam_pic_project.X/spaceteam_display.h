@@ -13,6 +13,7 @@ extern "C" {
 #endif
 
 #include "spaceteam_game.h"
+#include "spaceteam_clock.h"
 
 // Map the chip registers to easier names
 #define DISPLAY_RS LATB.LATB0
@@ -31,6 +32,15 @@ extern "C" {
 #define DISPLAY_ON_DATA 			0b00001100
 #define DISPLAY_ADDRESS_DATA		0b10000000
 
+// How long the display takes with each step of a reset, in us. These are
+//	the datasheet times, with a bit of margin.
+#define DISPLAY_RESET_START_US		4500	// More than 4.1ms
+#define DISPLAY_RESET_WAKE_US		150		// More than 100us
+#define DISPLAY_CLEAR_US			2000	// More than 1.52ms
+
+// Stands in for the register in the display's init scripts
+#define DISPLAY_COMMAND				0
+
 // Beginning of lines of the display
 #define DISPLAY_LINE_1_START		0x00
 #define DISPLAY_LINE_2_START		0x40
@@ -55,7 +65,8 @@ extern "C" {
 #define TIMER_4_ON 				0x0004
 #define TIMER_4_POSTSCALE_16	0x0078
 #define TIMER_4_PRESCALE_16		0x0003
-#define TIMER_4_122Hz			0xFF
+#define TIMER_4_COUNT_HZ		(CLOCK_FCY / (16 * 16))		// Full clock over the pre/postscalers
+#define TIMER_4_122Hz			((TIMER_4_COUNT_HZ / 122) - 1)
 #define TIMER_4_INT_ENABLE 		IEC1bits.T4IE
 #define TIMER_4_PRIORITY		IPC6bits.T4IP
 #define TIMER_4_INT_FLAG		IFS1bits.T4IF
@@ -81,6 +92,10 @@ void display_set_control_sigs(unsigned data);
 void display_write_command(unsigned char data);
 void display_write_char(unsigned char data);
 void display_reset(void);
+int display_reset_start(void);
+int display_reset_wake(void);
+int display_reset_config(void);
+void display_write_commands(unsigned char reg, const unsigned char * cmds, unsigned char len);
 void display_set_address(unsigned char address);
 void display_write_line(unsigned char line, char * str);
 void display_clear(void);
@@ -91,10 +106,13 @@ void init_timer_4(void);
 void display_set_buffer(char * buf, unsigned char len, unsigned char val);
 unsigned char display_copy_string(char * str, char * buf);
 void display_scroll_set(unsigned char line, unsigned char setting);
+int display_needs_tick(void);
+unsigned char display_render_request(spaceteam_req_t req, unsigned char board, unsigned val, char * request);
 void display_write_request(spaceteam_req_t req, unsigned char board, unsigned val);
 void display_clear_line(unsigned char line);
 void display_key_buf(char * buf);
 void display_rfid_token(char * data);
+void dec_to_string(unsigned val, char * buf);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,94 @@
+//
+// This file implements the event queue. It's a linked list of events
+//	from the event pool, posted onto the tail and taken off the head.
+//
+
+#include "xc.h"
+#include <stddef.h>
+#include "spaceteam_general.h"
+#include "spaceteam_event.h"
+#include "spaceteam_pool.h"
+
+// The head and tail of the queue
+spaceteam_event_t * volatile event_head;
+spaceteam_event_t * volatile event_tail;
+
+// Empty out the event queue
+void init_events(void)
+{
+	pool_reset(&event_pool);
+
+	event_head = NULL;
+	event_tail = NULL;
+}
+
+// This function puts an event on the end of the queue. It can be called
+//	from any interrupt. It returns FAILURE if the event pool is empty,
+//	in which case the event is dropped.
+int event_post(spaceteam_evt_t type, unsigned arg)
+{
+	spaceteam_event_t * evt;
+	unsigned ipl;
+
+	evt = (spaceteam_event_t *)pool_alloc(&event_pool);
+	if (evt == NULL)
+	{
+		return FAILURE;
+	}
+
+	evt->type = type;
+	evt->arg = arg;
+	evt->next = NULL;
+
+	CRIT_ENTER(ipl, POOL_CRITICAL_IPL);
+
+	if (event_tail == NULL)
+	{
+		event_head = evt;
+	}
+	else
+	{
+		event_tail->next = evt;
+	}
+	event_tail = evt;
+
+	CRIT_EXIT(ipl);
+
+	return SUCCESS;
+}
+
+// This function returns 1 if there are events waiting to be handled
+int event_pending(void)
+{
+	return (event_head != NULL);
+}
+
+// This function takes the event off the front of the queue, or returns
+//	NULL if there aren't any. The caller needs to free it when done.
+spaceteam_event_t * event_get(void)
+{
+	spaceteam_event_t * evt;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, POOL_CRITICAL_IPL);
+
+	evt = event_head;
+	if (evt != NULL)
+	{
+		event_head = evt->next;
+		if (event_head == NULL)
+		{
+			event_tail = NULL;
+		}
+	}
+
+	CRIT_EXIT(ipl);
+
+	return evt;
+}
+
+// This function gives a handled event back to the event pool
+void event_free(spaceteam_event_t * evt)
+{
+	pool_free(&event_pool, evt);
+}
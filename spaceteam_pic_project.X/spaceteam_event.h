@@ -0,0 +1,37 @@
+//
+// This is the include file for the event queue. Interrupts post events
+//	for work which is too slow to do in the interrupt, and the main
+//	loop takes them off the queue and handles them in order.
+//
+
+#ifndef SPACETEAM_EVENT_H_
+#define SPACETEAM_EVENT_H_
+
+// Different events which can be queued
+typedef enum _spaceteam_evt_t
+{
+	EVENT_ROTATE_DISPLAY,		// Time to show the next issued request
+	EVENT_CHECKPOINT,			// The game changed, so save it
+	EVENT_RADIO_RX,				// Payloads have come in to be parsed
+	EVENT_TX_FAILED,			// A payload was never ACKed. The arg is who it was for.
+	NUM_EVENTS
+} spaceteam_evt_t;
+
+// A queued event. Events are allocated from the event pool
+typedef struct _spaceteam_event_t
+{
+	spaceteam_evt_t type;					// The type of event this is
+	unsigned 		arg;					// Whatever the event needs
+	struct _spaceteam_event_t * next;		// The next event in the queue
+} spaceteam_event_t;
+
+//
+// Function declarations
+//
+void init_events(void);
+int event_post(spaceteam_evt_t type, unsigned arg);
+int event_pending(void);
+spaceteam_event_t * event_get(void);
+void event_free(spaceteam_event_t * evt);
+
+#endif /* SPACETEAM_EVENT_H_ */
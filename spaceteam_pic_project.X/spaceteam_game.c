@@ -8,7 +8,19 @@
 #include "spaceteam_msg.h"
 #include "spaceteam_display.h"
 #include "spaceteam_general.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_wireless.h"
+#include "spaceteam_alloc.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_led.h"
+#include "spaceteam_power.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_startup.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_chan.h"
+#include <stddef.h>
 
 //
 // Define the clock frequency
@@ -22,24 +34,30 @@ unsigned lfsr;
 unsigned num_players;
 // State that the game is in
 game_state_t game_state;
-// Time left on a given request
-unsigned char req_time;
-// LED which is currently being multiplexed
-unsigned char curr_LED;
 // The game health
 unsigned char game_health;
-
-// Active requests array
-spaceteam_request_t active_requests[NUM_PLAYERS];
-// Our request
-spaceteam_request_t my_req;
+// Set if we picked the game back up from a checkpoint after a reset
+unsigned char game_resumed;
+#if (THIS_PLAYER == MASTER_PLAYER)
+	// The slaves which haven't answered since we picked the game back up
+	unsigned char resume_waiting;
+#endif
+
+// The requests which we have issued
+issued_req_t my_reqs[MAX_ISSUED_REQS];
+// The number of requests we can have out right now
+unsigned char issue_limit;
+// Completed requests since we last raised the issue limit
+unsigned char reqs_completed;
+// The issued request that is on the display and the LEDs
+unsigned char shown_req;
 
 // Buffer which holds keypresses
 unsigned char key_buf[MAX_KEYPRESSES];
 
 // Table of LSEL values based off of request type. This is only applicable for
 //	switch type requests
-unsigned char isel_vals[NO_REQ] = 
+const unsigned char isel_vals[NO_REQ] = 
 	{
 		0xFF, // Keypad doesn't need a LSEL value
 		0xFF, // Knob doesn't need a LSEL value
@@ -56,7 +74,58 @@ unsigned char isel_vals[NO_REQ] =
 		1 	  // Reed = S7
 	};
 
-unsigned char active_players[NUM_PLAYERS];
+// The players in the game, as a bit per player
+unsigned char active_players;
+
+// Make sure that everything fits in the packed request fields
+typedef char req_type_fits[(NO_REQ < (1 << REQ_TYPE_BITS)) ? 1 : -1];
+typedef char player_fits[(NUM_PLAYERS < ALL_PLAYERS) ? 1 : -1];
+typedef char debounce_fits[(IO_DEBOUNCE_COUNT < (1 << DEBOUNCE_BITS)) ? 1 : -1];
+
+// Relative weights for how often each request type is picked. The
+//	keypad and knob have more than one value, so they get picked
+//	a bit more often than the individual switches.
+const unsigned char req_type_weights[NO_REQ] =
+	{
+		2,    // Keypad
+		2,    // Knob
+		1,    // PB1
+		1,    // PB2
+		1,    // PB3
+		1,    // PB4
+		1,    // Toggle1
+		1,    // Toggle2
+		1,    // Toggle3
+		1,    // Toggle4
+		1,    // Tilt
+		1,    // IR
+		1     // Reed
+	};
+
+// The sum of all of the request weights
+unsigned req_weight_total;
+
+// A request which has been made ahead of time, along with its display
+//	line and the packet which announces it, so that issuing it is
+//	just a copy and a send
+typedef struct _prepared_req_t
+{
+	spaceteam_request_t req;
+	spaceteam_packet_t 	packet;
+	char 				line[DISP_MAX_STR_LEN];
+} prepared_req_t;
+
+// The next request, made in the main loop, and whether it's ready
+prepared_req_t next_req;
+volatile unsigned char next_req_ready;
+// Slot for making a request on the spot if the next one isn't ready
+prepared_req_t fallback_req;
+
+#if (PROFILE_REQ_SWAP == 1)
+	// Timer 3 cycles spent issuing the last request, and the worst seen
+	unsigned req_swap_cycles;
+	unsigned req_swap_max_cycles;
+#endif
 
 // Initialize the game-related variables
 void init_game_vars(void)
@@ -66,16 +135,17 @@ void init_game_vars(void)
 	// Just set the game state to waiting
 	game_state = GAME_WAITING;
 
-	// Loop through the active requests array and initialize them all to NO_REQ
-	//	Also set the active players array to invalid numbers
-	for (i = 0; i < NUM_PLAYERS; i++)
-	{
-		active_requests[i].type = NO_REQ;
-		active_players[i] = PLAYER_ABSENT;
-	}
+	// Give back every request we had been given
+	pool_reset(&request_pool);
 
-	// Need to register ourself in the active players list though
-	active_players[THIS_PLAYER] = PLAYER_PLAYING;
+	// Nobody is playing yet except for ourself
+	active_players = PLAYER_BIT(THIS_PLAYER);
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		resume_waiting = 0;
+	#endif
+
+	// The waiting room is on its own channel
+	chan_reset();
 
 	// Clear out the keypress buffer
 	for (i = 0; i < MAX_KEYPRESSES; i++)
@@ -83,14 +153,64 @@ void init_game_vars(void)
 		key_buf[i] = 0;
 	}
 
-	curr_LED = 0;
+	// Sum up the request weights for the request generator
+	req_weight_total = 0;
+	for (i = 0; i < NO_REQ; i++)
+	{
+		req_weight_total += req_type_weights[i];
+	}
+
+	// Free up all of our issued requests, and make sure our old 
+	//	requests don't block anything
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		my_reqs[i].req.type = NO_REQ;
+		my_reqs[i].time = 0;
+	}
+
+	// We start out with one request out at a time
+	issue_limit = 1;
+	reqs_completed = 0;
+	shown_req = 0;
+
+	// We haven't made the next request yet
+	next_req_ready = 0;
+
+	// And nobody holds any request slots
+	init_alloc();
+
+	// And redraw the LEDs for the new game state
+	update_leds();
+
+	// Slow down the input scanning while we wait
+	power_enter_phase(POWER_PHASE_WAITING);
 
 }
 
 // Initialize the game. 
 void init_game(void)
 {
-	int i;
+	spaceteam_checkpoint_t ckpt;
+	#if (PROFILE_BOOT == 1)
+		char boot_line[] = "Boot ms: 0000";
+	#endif
+
+	// Start timer 1 first, since the startup sequencer times the devices
+	//	with it, and so that it measures the whole boot
+	init_clock();
+	init_timer_1();
+
+	// Set up the object pools and the event queue. These come next
+	//	since the game variables live in them.
+	init_pools();
+	init_events();
+	init_sched();
+	init_chan();
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		init_poll();
+	#endif
+	init_power();
+	init_checkpoint();
 
 	// Initialize the game variables
 	init_game_vars();
@@ -100,64 +220,97 @@ void init_game(void)
 
 	// Initialize the display
 	init_display();
+
+	// Bring up the display and the wireless side by side
+	run_startup();
+
 	display_scroll_set(DISPLAY_LINE_1, SCROLL_ON);
 	display_scroll_set(DISPLAY_LINE_2, SCROLL_ON);
 
-	// Write some welcome lines to the display
-	display_write_line(DISPLAY_LINE_1, "Welcome to Spaceteam!");
-	display_write_line(DISPLAY_LINE_2, "Waiting for other players...");
-
-	// Initialize the wireless
-	init_wireless();
+	// Write some welcome lines to the display. They fit on a line, so
+	//	that the display doesn't have to scroll them and we can Sleep
+	//	in the waiting room.
+	#if (PROFILE_BOOT == 1)
+		// Along with how long it took to get here, in ms
+		dec_to_string(startup_get_ms(), &boot_line[BOOT_LINE_MS_IDX]);
+		display_write_line(DISPLAY_LINE_1, boot_line);
+	#else
+		display_write_line(DISPLAY_LINE_1, "Spaceteam");
+	#endif
+
+	// If a device didn't come up, show which, since the game isn't going
+	//	to work without it
+	if (startup_get_failed() != 0)
+	{
+		display_write_hex(startup_get_failed(), DISPLAY_LINE_2);
+	}
+	else
+	{
+		display_write_line(DISPLAY_LINE_2, "Waiting for crew");
+	}
 
-	// Initialize the timers
-	init_timer_1();
+	// Initialize the polling timer
 	init_timer_2();
 
+	// And start scanning the LEDs
+	init_leds();
+	update_leds();
+
+	// If we were reset in the middle of a game, carry on with it
+	game_resumed = 0;
+	if (checkpoint_load(&ckpt) == SUCCESS)
+	{
+		game_resume(&ckpt);
+	}
+
 }
 
-// This function essentially implements the waiting room for the game, 
-//	allowing other players to network
-void network_with_other_players()
+// This thread is the waiting room for the game. The master keeps going
+//	round the other players with its networking message until the game
+//	begins, and then tells the ones who answered to begin too. A slave
+//	only has to answer the master once.
+char network_thread(pt_t * pt)
 {
-	int i;
-	char network_sent = 0;
-	char * players;
-	unsigned count = 0;
+	static unsigned char player;
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		static pt_t scan_pt;
+	#endif
 
-	while( game_state != GAME_STARTED)
-	{
+	PT_BEGIN(pt);
 
-		// There are two cases for this function, one if we are the master, one if we are not
-		#if (THIS_PLAYER == MASTER_PLAYER)
+	#if (THIS_PLAYER == MASTER_PLAYER)
+
+		// Find a quiet channel to play on first
+		PT_SPAWN(pt, &scan_pt, chan_scan_thread(&scan_pt));
 
-			// If we are the master, we need to send our networking message to all other players
-			for (i = 0; i < NUM_PLAYERS; i++)
+		while (game_state != GAME_STARTED)
+		{
+			for (player = 0; (player < NUM_PLAYERS) && (game_state != GAME_STARTED); player++)
 			{
-				if (i != MASTER_PLAYER)
+				if (player != MASTER_PLAYER)
 				{
-					// Send a networking message to the player, if they exist
-					send_message(MSG_NETWORKING, 0, MASTER_PLAYER, i, 0);
-					count = 0;
-					while(count < 5000)
-					{
-						count++;
-					}
+					// Tell them where the game will be along with it
+					send_message(MSG_CHANNEL, 0, MASTER_PLAYER, player, chan_get_chosen());
+					send_message(MSG_NETWORKING, 0, MASTER_PLAYER, player, THIS_BOARD_INPUTS);
+					PT_WAIT_MS(pt, NETWORK_SEND_GAP_MS);
 				}
 			}
+		}
 
-		// If we are not the master player, we only want to send the ack once, 
-		#else
-			if (network_sent == 0)
-			{
-				send_message(MSG_NETWORKING, 0, THIS_PLAYER, MASTER_PLAYER, 0);
-			}
+		// The game has begun, so tell everyone at once. The players
+		//	who are in the game go along with it, so that a board which
+		//	never made it into the waiting room stays out.
+		send_message(MSG_BEGIN, 0, THIS_PLAYER, ALL_PLAYERS, get_active_players());
 
-			network_sent = 1;
-		#endif
+		// And follow them to the game's channel once it's out
+		PT_WAIT_WHILE(pt, wl_module_tx_busy());
+		chan_begin();
 
-	}
+	#else
+		send_message(MSG_NETWORKING, 0, THIS_PLAYER, MASTER_PLAYER, THIS_BOARD_INPUTS);
+	#endif
 
+	PT_END(pt);
 }
 
 // Begin the game
@@ -167,13 +320,8 @@ void begin_game(void)
 	//	the current sample from the ADC knob
 	lfsr = (TMR1 ^ get_knob_sample());
 
-	// Figure out how many players we have, by counting how
-	//	many valid entries we have in the active players array
-	num_players = 0;
-	while(active_players[num_players] != NUM_PLAYERS)
-	{
-		num_players++;
-	}
+	// Figure out how many players we have
+	num_players = count_active_players();
 
 	// Start the game state
 	game_state = GAME_STARTED;
@@ -184,148 +332,601 @@ void begin_game(void)
 	// Need to clear the second line of the display
 	display_clear_line(DISPLAY_LINE_2);
 
-	// And generate our new request
-	generate_request();
+	// Scan the inputs at full speed
+	power_enter_phase(POWER_PHASE_PLAYING);
+
+	// Move to the game's channel. The master does once it's told everyone.
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		chan_begin();
+	#endif
+
+	// And generate our new requests
+	fill_requests();
+	update_leds();
+
+	// Save the new game, so that a reset from here on can pick it up
+	event_post(EVENT_CHECKPOINT, 0);
+}
+
+// This function picks a game back up from a checkpoint after a reset.
+//	The requests we had out carry on with the time they had left. The
+//	ones other boards had given us are gone, and will time out on them.
+void game_resume(const spaceteam_checkpoint_t * ckpt)
+{
+	int i;
+
+	active_players = ckpt->players;
+	num_players = count_active_players();
+	game_health = ckpt->health;
+	issue_limit = ckpt->issue_limit;
+	reqs_completed = ckpt->reqs_completed;
+	shown_req = ckpt->shown_req;
+	lfsr = ckpt->lfsr;
+
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		my_reqs[i] = ckpt->reqs[i];
+	}
+
+	game_state = GAME_STARTED;
+	game_resumed = 1;
+	power_enter_phase(POWER_PHASE_PLAYING);
+
+	// Go back to the game's channel. If the master moved it while we were
+	//	out, a slave goes looking for it.
+	chan_restore(ckpt->chan_idx);
+	chan_begin();
+
+	// Put the request we were showing back up
+	display_clear_line(DISPLAY_LINE_2);
+	if (my_reqs[shown_req].time != 0)
+	{
+		display_write_request(my_reqs[shown_req].req.type, my_reqs[shown_req].req.board, my_reqs[shown_req].req.val);
+	}
+
+	// Top up our requests, and start the request timer again
+	fill_requests();
+	if (count_issued_requests() != 0)
+	{
+		TIMER_1_INT_ENABLE = 1;
+	}
+	update_leds();
+
+	// Let the others know that we're back. The master keeps the inputs
+	//	each board has, so it needs to hear them again if it was the one
+	//	which was reset. Its broadcast isn't ACKed, so resume_thread
+	//	keeps sending it until they've all answered.
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		resume_waiting = active_players & ~PLAYER_BIT(MASTER_PLAYER);
+	#else
+		send_message(MSG_RESUME, 0, THIS_PLAYER, MASTER_PLAYER, THIS_BOARD_INPUTS);
+	#endif
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This thread tells the slaves that the master is back after a reset,
+//	every RESUME_SEND_GAP_MS until each of them has answered with its
+//	inputs
+char resume_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	while ( (game_state == GAME_STARTED) && (resume_waiting != 0) )
+	{
+		send_message(MSG_RESUME, 0, THIS_PLAYER, ALL_PLAYERS, THIS_BOARD_INPUTS);
+		PT_WAIT_MS(pt, RESUME_SEND_GAP_MS);
+	}
+
+	PT_END(pt);
 }
 
-// The LFSR which will act as a pseudo-random number generator. This will
-//	generate a pseudo-random 16-bit number, which should be sufficient 
-//	to get resolution of about 20 random values of it.
+#endif
+
+// This function fills out the passed checkpoint with the state of the game
+void game_get_checkpoint(spaceteam_checkpoint_t * ckpt)
+{
+	int i;
+
+	ckpt->game_state = game_state;
+	ckpt->chan_idx = chan_get_idx();
+	ckpt->players = active_players;
+	ckpt->health = game_health;
+	ckpt->issue_limit = issue_limit;
+	ckpt->reqs_completed = reqs_completed;
+	ckpt->shown_req = shown_req;
+	ckpt->lfsr = lfsr;
+
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		ckpt->reqs[i] = my_reqs[i];
+	}
+}
+
+// This function returns 1 if we picked the game back up after a reset
+int game_was_resumed(void)
+{
+	return game_resumed;
+}
+
+// The random number generator. This is a 16-bit xorshift with the (7, 9, 8)
+//	shift triple, which is maximal length: it walks through every non-zero
+//	16-bit value before repeating. It costs three shifts and three XORs,
+//	with no branches.
 unsigned lfsr_get_random(void)
 {
-	// The value to OR into the LFSR
-	unsigned bit;
+	// A zero state would lock the generator at zero forever,
+	//	so kick it out of there if the seed happened to be zero
+	if (lfsr == 0)
+	{
+		lfsr = RNG_ZERO_SEED;
+	}
 
-	// Calculate the feedback bit
-	bit = ((lfsr >> 0) ^ (lfsr >> 2) ^ (lfsr >> 3) ^ (lfsr >> 5) ) & 1;
-	// And update the LFSR
-	lfsr =  (lfsr >> 1) | (bit << 15);
+	lfsr ^= (lfsr << 7);
+	lfsr ^= (lfsr >> 9);
+	lfsr ^= (lfsr << 8);
 
 	return lfsr;
 }
 
-// Generate a random game request
-void generate_request(void)
+// This function returns a random number in the range [0, range). Rather
+//	than using a %, which is an 18 cycle hardware divide on the PIC24,
+//	scale the random number by the range with a single 16x16 multiply
+//	and keep the upper 16 bits of the product.
+unsigned random_in_range(unsigned range)
+{
+	return (unsigned)(__builtin_muluu(lfsr_get_random(), range) >> 16);
+}
+
+// This function picks a random request type using the request weight
+//	table. The random number is mapped into the sum of the weights, and
+//	the type whose slice of the sum it lands in is the one chosen.
+spaceteam_req_t random_request_type(void)
+{
+	unsigned pick;
+	spaceteam_req_t type = KEYPAD_REQ;
+
+	pick = random_in_range(req_weight_total);
+
+	// Walk the table until we find the slice we landed in
+	while (pick >= req_type_weights[type])
+	{
+		pick -= req_type_weights[type];
+		type++;
+	}
+
+	return type;
+}
+
+// This function returns 1 if a request of the passed type on the passed
+//	board would collide with one which is already pending. Two requests
+//	for the same input on the same board can't both be met, so they
+//	collide regardless of their values. Our own issued requests are
+//	checked too, including the ones which just finished so that we 
+//	don't issue the same thing twice in a row. We only know what's
+//	pending on other boards through the master, so the active requests
+//	are only checked for our own board.
+int is_request_pending(spaceteam_req_t type, unsigned char board)
+{
+	spaceteam_request_t * req;
+	int i;
+
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		if ( (my_reqs[i].req.type == type) && (my_reqs[i].req.board == board) )
+		{
+			return 1;
+		}
+	}
+
+	if (board != THIS_PLAYER)
+	{
+		return 0;
+	}
+
+	// Everything in the request pool is on our board
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		req = (spaceteam_request_t *)pool_get(&request_pool, i);
+		if ( (req != NULL) && (req->type == type) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Pick a random game request and write it into the passed request
+void pick_request(spaceteam_request_t * req)
 {
-	unsigned rand_val;
-	unsigned num_players;
-	unsigned short player_idx;
+	spaceteam_req_t type;
+	int tries = 0;
+	int status;
+
+	// Get a request slot which nobody else is using. The master hands
+	//	them out from its table, and slaves use the ones the master
+	//	has already given them.
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		status = alloc_request_slot(THIS_PLAYER, req);
+
+		// Hold on to it like a slave would until it's issued, since
+		//	it may sit here a while
+		if (status == SUCCESS)
+		{
+			alloc_hold_grant(THIS_PLAYER, GRANT_SLOT(req->board, req->type));
+		}
+	#else
+		status = alloc_take_grant(req);
+	#endif
 
-	// Generate the random board number, request type and request value 
-	//	for the request
-	rand_val = lfsr_get_random();
-	player_idx = rand_val % NUM_PLAYERS;
-	// my_req.board = active_players[player_idx];
-	my_req.board = THIS_PLAYER;
+	// If we couldn't get a slot, just pick one ourselves. We only know
+	//	for sure what's pending on our own board, so use that.
+	if (status != SUCCESS)
+	{
+		req->board = THIS_PLAYER;
+
+		// Pick the request type, rerolling if it collides with a request
+		//	that is already pending. Give up after a few tries so that a
+		//	full pending set can never hang us in here.
+		do
+		{
+			type = random_request_type();
+			tries++;
+		} while ( is_request_pending(type, req->board) && (tries < REQ_GEN_MAX_TRIES) );
+
+		req->type = type;
+	}
 
-	// Generate the request type
-	rand_val = lfsr_get_random();
-	my_req.type = rand_val % NO_REQ;
+	req->debounce_count = 0;
 
-	// Generate the request value
-	rand_val = lfsr_get_random();
 	// Need to get the value based off of the request type
-	switch(my_req.type)
+	switch(req->type)
 	{
 		case KEYPAD_REQ:
-			my_req.val = rand_val % NUM_KEYPAD_VALS;
+			req->val = random_in_range(NUM_KEYPAD_VALS);
 			break;
 		case KNOB_REQ:
-			my_req.val = rand_val % NUM_KNOB_VALS;
+			req->val = random_in_range(NUM_KNOB_VALS);
 			break;
 		default:
 			// For switches, it's always a toggle
 			//	from the current state
-			my_req.val = 0;
+			req->val = 0;
 			break;
 	}
+}
 
-	// Send a message issuing the request
-	send_message(MSG_NEW_REQ, my_req.type, THIS_PLAYER, my_req.board, my_req.val);
+// This function does all of the slow work of making a new request ahead
+//	of time: it picks the request, renders the display line for it
+//	and builds the packet which announces it.
+void prepare_request(prepared_req_t * prep)
+{
+	pick_request(&prep->req);
 
-	// And write the request
-	display_write_request(my_req.type, my_req.board, my_req.val);
+	// Render the display line
+	display_render_request(prep->req.type, prep->req.board, prep->req.val, prep->line);
 
-	// Reset the request time
-	req_time = REQ_TIME_MAX;
+	// And build the packet
+	prep->packet.type 		= MSG_NEW_REQ;
+	prep->packet.sender 	= THIS_PLAYER;
+	prep->packet.recipient 	= prep->req.board;
+	prep->packet.request 	= prep->req.type;
+	prep->packet.val 		= prep->req.val;
+}
 
-	// Reset the timer counter
-	TMR1 = 0;
+// This function is called from the main loop whenever we have nothing
+//	better to do. If the game is running and the next request hasn't
+//	been made yet, make it now so that it's ready to go the moment
+//	the current request finishes.
+void prepare_next_request(void)
+{
+	if ( (game_state == GAME_STARTED) && (next_req_ready == 0) )
+	{
+		prepare_request(&next_req);
+		next_req_ready = 1;
+	}
+}
+
+// Generate a game request. If the next request has already been
+//	prepared in the main loop, this is just a copy and a send. If it
+//	wasn't ready in time, or the pending requests have changed so that it
+//	now collides, make one on the spot. A prepared request which collides
+//	is kept for next time rather than thrown away, since it's holding
+//	a request slot.
+void generate_request(void)
+{
+	prepared_req_t * prep;
+	unsigned char used_next = 0;
+	int slot;
+
+	#if (PROFILE_REQ_SWAP == 1)
+		unsigned start_cycles = led_get_cycles();
+	#endif
+
+	// Find a free slot for the request
+	for (slot = 0; slot < MAX_ISSUED_REQS; slot++)
+	{
+		if (my_reqs[slot].time == 0)
+		{
+			break;
+		}
+	}
+
+	// If we're all full up, there's nothing to do
+	if (slot == MAX_ISSUED_REQS)
+	{
+		return;
+	}
+
+	if ( (next_req_ready == 1) && !is_request_pending(next_req.req.type, next_req.req.board) )
+	{
+		prep = &next_req;
+		used_next = 1;
+	}
+	else
+	{
+		// The main loop may be in the middle of filling out the next
+		//	request, so use our own slot to not step on it
+		prepare_request(&fallback_req);
+		prep = &fallback_req;
+	}
+
+	// If this is the only request out, reset the timer counter so
+	//	it gets a full first tick. Otherwise leave it alone so that
+	//	the other requests don't get extra time.
+	if (count_issued_requests() == 0)
+	{
+		TMR1 = 0;
+	}
+
+	// Swap in the new request, and reset its time
+	my_reqs[slot].req = prep->req;
+	my_reqs[slot].time = REQ_TIME_MAX;
+
+	// Send the message issuing the request
+	send_packet(&prep->packet);
+
+	// And write the request. The newest request is always the one shown.
+	display_write_line(DISPLAY_LINE_1, prep->line);
+	shown_req = slot;
+	update_leds();
+
+	// Note that the next request needs to be made. This comes after
+	//	we're all done with the prepared request so that the main loop
+	//	won't start overwriting it under us.
+	if (used_next)
+	{
+		next_req_ready = 0;
+	}
 
 	// And turn on the request timer interrupts
 	TIMER_1_INT_ENABLE = 1;
 
+	#if (PROFILE_REQ_SWAP == 1)
+		// Record how long the swap took, and the worst we've seen
+		req_swap_cycles = led_get_cycles() - start_cycles;
+		if (req_swap_cycles > req_swap_max_cycles)
+		{
+			req_swap_max_cycles = req_swap_cycles;
+		}
+	#endif
+
 }
 
-// Register a new request which we receive
-void register_request(spaceteam_req_t type, unsigned char board, unsigned val)
+// This function returns the number of requests we have out
+unsigned char count_issued_requests(void)
 {
+	unsigned char count = 0;
 	int i;
-	unsigned char switch_val;
 
-	// Copy the request into our active requests array at the 
-	//	first available index
-	for (i = 0; i < NUM_PLAYERS; i++)
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
 	{
-		if(active_requests[i].type == NO_REQ)
+		if (my_reqs[i].time != 0)
 		{
-			active_requests[i].type 	= type;
-			active_requests[i].board 	= board;
-			active_requests[i].debounce_count = IO_DEBOUNCE_COUNT;
-
-			// If this is a switch request, we need to figure out what the
-			//	current state of the switch is so that we can set the 
-			//	request value as a toggle
-			if (type > KNOB_REQ)
-			{
-				switch_val = get_switch_val(isel_vals[type]);
-				if (switch_val == 0)
-				{
-					active_requests[i].val = 1;
-				}
-				else
-				{
-					active_requests[i].val = 0;
-				}
-			}
-			else
-			{
-				active_requests[i].val = val;
-			}
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// This function issues new requests until we have as many out
+//	as we're allowed
+void fill_requests(void)
+{
+	while (count_issued_requests() < issue_limit)
+	{
+		generate_request();
+	}
+}
 
+// This function is called from the main loop when it's time to move
+//	the display and LEDs on to the next request we have out, so that
+//	the player sees all of them in turn.
+void update_request_display(void)
+{
+	spaceteam_request_t req;
+	int i;
+
+	// Find the next request that's out
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		shown_req = shown_req + 1;
+		if (shown_req >= MAX_ISSUED_REQS)
+		{
+			shown_req = 0;
+		}
+
+		if (my_reqs[shown_req].time != 0)
+		{
 			break;
 		}
 	}
+
+	// Take a copy in case it gets completed while we're drawing it
+	req = my_reqs[shown_req].req;
+	display_write_request(req.type, req.board, req.val);
+	update_leds();
+}
+
+// This function is called from the main loop. It handles all of the
+//	events which the interrupts have queued up since the last call.
+void process_events(void)
+{
+	spaceteam_event_t * evt;
+
+	// Run at full speed while we have work. The power manager puts us
+	//	back to dozing once we run out.
+	if (event_pending())
+	{
+		clock_set_idle(0);
+	}
+
+	while ((evt = event_get()) != NULL)
+	{
+		switch(evt->type)
+		{
+			case EVENT_ROTATE_DISPLAY:
+				update_request_display();
+				break;
+			case EVENT_CHECKPOINT:
+				checkpoint_save();
+				break;
+			case EVENT_RADIO_RX:
+				wl_module_rx_service();
+				break;
+			// Only the master sends anything which has to be ACKed
+			case EVENT_TX_FAILED:
+				#if (THIS_PLAYER == MASTER_PLAYER)
+					msg_note_lost(evt->arg);
+				#endif
+				break;
+			default:
+				break;
+		}
+
+		// Let any threads waiting on it know
+		sched_post_event(evt->type);
+
+		event_free(evt);
+	}
+
+	// If the radio couldn't post its event because the pool was empty,
+	//	its payloads are still waiting
+	if (wl_module_rx_pending())
+	{
+		wl_module_rx_service();
+	}
+}
+
+// Register a new request which we receive
+void register_request(spaceteam_req_t type, unsigned char board, unsigned val)
+{
+	spaceteam_request_t * req;
+	unsigned char switch_val;
+
+	// Get a request from the pool to hold it. If the pool is
+	//	empty, we can't take the request, and it will time out.
+	req = (spaceteam_request_t *)pool_alloc(&request_pool);
+	if (req == NULL)
+	{
+		return;
+	}
+
+	req->type 	= type;
+	req->board 	= board;
+	req->debounce_count = IO_DEBOUNCE_COUNT;
+
+	// If this is a switch request, we need to figure out what the
+	//	current state of the switch is so that we can set the 
+	//	request value as a toggle
+	if (type > KNOB_REQ)
+	{
+		switch_val = get_switch_val(isel_vals[type]);
+		if (switch_val == 0)
+		{
+			req->val = 1;
+		}
+		else
+		{
+			req->val = 0;
+		}
+	}
+	else
+	{
+		req->val = val;
+	}
 }
 
-// Deregister a request that we had gotten
+// Deregister a request that we had gotten. It's matched on the board
+//	and type alone, since a switch request's value was changed into a
+//	toggle when it was registered, so the value the issuer sends back
+//	won't always be the one we have. A board never has two requests out
+//	on the same input at once, so that's enough to find it.
 void deregister_request(spaceteam_req_t type, unsigned char board, unsigned val)
 {
+	spaceteam_request_t * req;
 	int i;
 
-	// Look through our array of active requests, and 
+	// Look through the requests we've been given, and 
 	//	take out this one since we no longer need it
-	for (i = 0; i < NUM_PLAYERS; i++)
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
 	{
-		// Match on all categories for good measure
-		if ( (active_requests[i].board == board) && (active_requests[i].type == type) && (active_requests[i].val == val) )
+		req = (spaceteam_request_t *)pool_get(&request_pool, i);
+
+		if ( (req != NULL) && (req->board == board) && (req->type == type) )
 		{
-			// 'Free' up the slot by changing the type 
-			//	to no request
-			active_requests[i].type = NO_REQ;
+			// Give it back to the pool
+			pool_free(&request_pool, req);
 		}
 	}
 }
 
 // This function gets called if we get a message that our request was 
-//	completed
-void request_done(void)
+//	completed. The message has to be for a request we have out now,
+//	since a completion can cross paths with a timeout.
+void request_done(spaceteam_req_t type, unsigned char board)
 {
-	// Turn off timer interrupts
-	TIMER_1_INT_ENABLE = 0;
+	int i;
+
+	if (game_state != GAME_STARTED)
+	{
+		return;
+	}
+
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		if ( (my_reqs[i].time != 0) && (my_reqs[i].req.type == type) && (my_reqs[i].req.board == board) )
+		{
+			break;
+		}
+	}
+
+	if (i == MAX_ISSUED_REQS)
+	{
+		return;
+	}
+
+	// Free up the slot
+	my_reqs[i].time = 0;
+
+	// Every so often, let us have another request out at once
+	reqs_completed++;
+	if (reqs_completed == REQS_PER_LEVEL)
+	{
+		reqs_completed = 0;
+		if (issue_limit < MAX_ISSUED_REQS)
+		{
+			issue_limit++;
+		}
+	}
 
-	// And generate a new request
-	generate_request();
+	// And generate new requests
+	fill_requests();
+
+	// The requests we have out changed, so save them
+	event_post(EVENT_CHECKPOINT, 0);
 }
 
 // Set up timer 1 to count at 1/256 of the system clock and interrupt
@@ -338,7 +939,7 @@ void init_timer_1(void)
 	// Clear the timer count
 	TMR1 = 0;
 
-	// Set interrupt priority lower than that of wireless which is 7
+	// Set interrupt priority to that of the wireless, below the LED scan
 	TIMER_1_PRIORITY = 6;
 
 	// Turn off the timer 1 interrupt flag
@@ -355,63 +956,101 @@ void init_timer_1(void)
 }
 
 // This is the timer 1 interrupt. If the game state is IDLE or OVER then
-//	do nothing. If we are in the game, we want to decrease the request time
-//	value by 1
+//	do nothing. If we are in the game, we want to decrease the time of
+//	each of our requests by 1
 void _ISR _T1Interrupt(void)
 {
-
-	// Need to set the chip selects
-	int_set_chip_selects();
+	int i;
+	unsigned char changed;
 
 	if (game_state == GAME_STARTED)
 	{
-		// Decrease the request time by 1
-		req_time -= 1;
+		changed = 0;
 
-		// If we timed out
-		if (req_time == 0)
+		for (i = 0; i < MAX_ISSUED_REQS; i++)
 		{
-			// Turn off timer interrupts until we generate a new request
-			TIMER_1_INT_ENABLE = 0;
+			// Skip the free slots
+			if (my_reqs[i].time == 0)
+			{
+				continue;
+			}
 
-			// Send a message that our request failed
-			send_message(MSG_REQ_FAILED, my_req.type, THIS_PLAYER, my_req.board, my_req.val);
+			// Decrease the request time by 1
+			my_reqs[i].time -= 1;
 
-			// Decrement the game health, and if we have lost, restart the game 
-			if (dec_game_health())
+			// If we timed out
+			if (my_reqs[i].time == 0)
 			{
-				generate_request();
+				changed = 1;
+
+				// Send a message that our request failed
+				send_message(MSG_REQ_FAILED, my_reqs[i].req.type, THIS_PLAYER, my_reqs[i].req.board, my_reqs[i].req.val);
+
+				// Decrement the game health, and if we have lost, restart the game 
+				if (!dec_game_health())
+				{
+					// Turn off timer interrupts
+					TIMER_1_INT_ENABLE = 0;
+					// Restart the game
+					init_game_vars();
+					// And print a game-over statement
+					display_clear();
+					display_write_line(DISPLAY_LINE_1, "GAME OVER!");
+
+					#if (PROFILE_POWER == 1)
+						// Report how much of the game the CPU was awake for
+						display_write_hex(power_get_duty(POWER_PHASE_PLAYING), DISPLAY_LINE_2);
+					#elif (PROFILE_REQ_SWAP == 1)
+						// Report the worst request swap time, in cycles
+						display_write_hex(req_swap_max_cycles, DISPLAY_LINE_2);
+					#endif
+
+					break;
+				}
 			}
-			else
+		}
+
+		// Replace any requests which failed
+		if (game_state == GAME_STARTED)
+		{
+			fill_requests();
+
+			// And move the display on to the next request, if there's
+			//	more than one
+			if (count_issued_requests() > 1)
 			{
-				// Restart the game
-				init_game_vars();
-				// And print a game-over statement
-				display_clear();
-				display_write_line(DISPLAY_LINE_1, "GAME OVER!");
+				event_post(EVENT_ROTATE_DISPLAY, 0);
 			}
 		}
+
+		// The time, the health or the whole game changed
+		update_leds();
+
+		// If a request failed, the health and the requests we have out
+		//	changed, so save them. If the game just ended, this marks the
+		//	checkpoint as not being in a game, so that a reset won't bring
+		//	it back. A tick which only counted the time down doesn't save,
+		//	since that would wear out the EEPROM, so a resumed game gets
+		//	back the time its requests had at the last change.
+		if (changed)
+		{
+			event_post(EVENT_CHECKPOINT, 0);
+		}
 	}
 
 	// Need to clear the interrupt flag
 	TIMER_1_INT_FLAG = 0;
-
-	// Needs to reset chip selects
-	int_reset_chip_selects();
-
 }
 
-// Set up timer 2 as a 1KHz interrupt which will do all of our polling and will
-//	multiplex the LEDs
+// Set up timer 2 as a 1KHz interrupt which will do all of our polling
 void init_timer_2(void)
 {
-	// Set the counter value to the required val for 1KHz
-	PR2 = TIMER_2_1KHz;
-
-	// Clear the timer's count register
+	// The counter value is set by the power manager, since how fast we
+	//	need to poll depends on the phase of the game. Just clear the
+	//	timer's count register.
 	TMR2 = 0;
 
-	// Set interrupt priority lower than that of wireless (7) and the 
+	// Set interrupt priority lower than that of the wireless and the
 	//	game health timer (6)
 	TIMER_2_PRIORITY = 5;
 
@@ -438,14 +1077,14 @@ int is_begin_debounced(void)
 	}
 	else
 	{
-		db_val = IO_DEBOUNCE_COUNT;
+		db_val = BEGIN_DEBOUNCE_COUNT;
 	}
 
 	// If db_val has reached zero, then we return 1 and reset it
 	if (db_val == 0)
 	{
 		ret_val = 1;
-		db_val = IO_DEBOUNCE_COUNT;
+		db_val = BEGIN_DEBOUNCE_COUNT;
 	}
 
 	return ret_val;
@@ -456,34 +1095,54 @@ int is_begin_debounced(void)
 //	If the request has been fulfilled, send off a message saying so.
 void _ISR _T2Interrupt(void)
 {
+	spaceteam_request_t * req;
 	int i;
 
-	// Need to set the chip selects
-	int_set_chip_selects();
+	// Note whether the CPU was busy for this tick, and move the
+	//	threads' clock on
+	power_sample();
+	sched_tick(power_get_tick_ms());
+
+	// Send out any messages which have waited long enough for others
+	//	to join them
+	msg_service();
+
+	// And send again anything which has waited out its backoff
+	wl_module_tx_service();
+
+	// And go back to the old rate if the master didn't follow us
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		wl_module_rate_service();
+	#endif
 
 	// If we are playing the game, we need to see if we have
 	//	completed any of our pending requests
 	if (game_state == GAME_STARTED)
 	{
+		// Hand out request slots to the slaves
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			alloc_service();
+		#endif
+
 		//
 		// Check all of our active requests
 		//
-		for (i = 0; i < NUM_PLAYERS; i++)
+		for (i = 0; i < REQUEST_POOL_SIZE; i++)
 		{
-			// See if there is a request pending in the slot
-			if(active_requests[i].type != NO_REQ)
+			// See if there is a request in the slot
+			req = (spaceteam_request_t *)pool_get(&request_pool, i);
+			if(req != NULL)
 			{
 				// Call the function which gets the current value for the request
-				if (check_request_completed(i))
+				if (check_request_completed(req))
 				{
-					// Send a message saying that the resuest has been completed
-					send_message(MSG_REQ_COMPLETED, active_requests[i].type, THIS_PLAYER, active_requests[i].board, active_requests[i].val);
+					// Send a message to the board which issued the request saying 
+					//	that it has been completed. That board makes its own
+					//	new request when it gets it.
+					send_message(MSG_REQ_COMPLETED, req->type, THIS_PLAYER, req->board, req->val);
 
-					// Reallocate the message
-					active_requests[i].type = NO_REQ; 
-
-					// And generate a new request
-					generate_request();
+					// And give the request back to the pool
+					pool_free(&request_pool, req);
 				}
 			}
 		}
@@ -505,37 +1164,30 @@ void _ISR _T2Interrupt(void)
 		}
 	}
 
-	// Always multiplex the LEDs
-	multiplex_leds();
-
 	// Need to clear the interrupt Flag
 	TIMER_2_INT_FLAG = 0;
-
-	// And need to reset chip selects
-	int_reset_chip_selects();
-
 }
 
-// This function is passed the index of a request in the active requests array. 
+// This function is passed one of the requests we've been given. 
 //	It will check to see if the request is completed by determining the 
 //	type of request and then monitoring the I/O for the request if necessary. 
 //	It will also perform debouncing 
-int check_request_completed(int req_no)
+int check_request_completed(spaceteam_request_t * req)
 {
 	int ret_val = 0;
 
 	// Need to do this check differently based on the 
 	//	value of the request type
-	switch(active_requests[req_no].type)
+	switch(req->type)
 	{
 		case KEYPAD_REQ:
-			ret_val = check_keypad_completed(active_requests[req_no].val);
+			ret_val = check_keypad_completed(req->val);
 			break;
 		case KNOB_REQ:
-			ret_val = check_knob_completed(active_requests[req_no].val);
+			ret_val = check_knob_completed(req->val);
 			break;
 		default:
-			ret_val = check_switch_completed(req_no);
+			ret_val = check_switch_completed(req);
 			break;
 	}
 
@@ -616,16 +1268,16 @@ int check_keypad_completed(unsigned val)
 
 
 // This function will check to see if a switch request has been completed
-int check_switch_completed(int req_no)
+int check_switch_completed(spaceteam_request_t * req)
 {
 	int ret_val = 0;
 
 	// If the switch is pressed, then decrement the debounce counter
-	if(get_switch_val(isel_vals[active_requests[req_no].type]) == active_requests[req_no].val)
+	if(get_switch_val(isel_vals[req->type]) == req->val)
 	{
-		active_requests[req_no].debounce_count -= 1;
+		req->debounce_count -= 1;
 		// If the switch has been debounced
-		if (active_requests[req_no].debounce_count == 0)
+		if (req->debounce_count == 0)
 		{
 			ret_val = 1;
 		}
@@ -633,7 +1285,7 @@ int check_switch_completed(int req_no)
 	// Otherwise, reset the debounce counter
 	else
 	{
-		active_requests[req_no].debounce_count = IO_DEBOUNCE_COUNT;
+		req->debounce_count = IO_DEBOUNCE_COUNT;
 	}
 
 	return ret_val;
@@ -658,41 +1310,52 @@ int check_knob_completed(unsigned val)
 	return ret_val;
 }
 
-// During the game, the LEDs are used for two purposes: 
-//	to show time remaining on a request and to 
-//	show game health. Basiclaly, the multiplexer
-//	increments one LED every call, and if the 
-//  LED should be on, it changes the select line to turn it 
-//	on. Else, it doesn't moce the LSEL.
-void multiplex_leds(void)
+// This function draws the game state into the LED framebuffer. It
+//	needs to be called whenever something that the LEDs show changes.
+//	While we play, the timer LEDs show the time left on whichever of our
+//	requests is on the display, with the next one to go out dimmed, and
+//	the health LEDs are dimmer so that they stand apart. In the waiting
+//	room, there is an LED for each player who has joined.
+void update_leds(void)
 {
-	// If we are playing the game
+	unsigned char frame[NUM_LEDS];
+	unsigned char time;
+	int i;
+
+	for (i = 0; i < NUM_LEDS; i++)
+	{
+		frame[i] = LED_OFF;
+	}
+
 	if (game_state == GAME_STARTED)
 	{
-		// If our LED should be on 
-		if ( (curr_LED < req_time) || ( (curr_LED >= MIN_HEALTH_LED) && (curr_LED < (game_health + MIN_HEALTH_LED)) ) )
+		time = my_reqs[shown_req].time;
+		for (i = 0; i < time; i++)
+		{
+			frame[i] = LED_FULL;
+		}
+		if (time != 0)
 		{
-			// Then turn it on
-			set_lsel(curr_LED);
+			frame[time - 1] = LED_HALF;
 		}
 
-		// Increment by 1 and wrap around 15
-		curr_LED = (curr_LED + 1) & 0xF;
+		for (i = 0; i < game_health; i++)
+		{
+			frame[MIN_HEALTH_LED + i] = LED_DIM;
+		}
 	}
-	// If we are in the waiting state
 	else if (game_state == GAME_WAITING)
 	{
-		// If we have the current player as an active player
-		if (active_players[curr_LED] == PLAYER_PLAYING)
+		for (i = 0; i < NUM_PLAYERS; i++)
 		{
-			// Then turn the LED on. 
-			set_lsel(curr_LED);
+			if (active_players & PLAYER_BIT(i))
+			{
+				frame[i] = LED_FULL;
+			}
 		}
-
-		// Mod the LED counter by the maximum number of players
-		curr_LED = (curr_LED + 1) % NUM_PLAYERS;
 	}
 
+	led_show(frame);
 }
 
 // this function decrements the game health by some amount. It returns 1 if the game is still
@@ -716,18 +1379,42 @@ int dec_game_health(void)
 	return ret_val;
 }
 
-// This function registers a player in the game
-void register_player(unsigned char player)
+// This function registers a player in the game, along with the inputs
+//	which their board has
+void register_player(unsigned char player, unsigned inputs)
 {
-	active_players[player] = PLAYER_PLAYING;
+	active_players |= PLAYER_BIT(player);
+	update_leds();
+
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		alloc_register_board(player, inputs);
+		resume_waiting &= ~PLAYER_BIT(player);
+	#endif
 }
 
-// This function returns a pointer to the array of active players
-unsigned char * get_active_players(void)
+// This function returns the set of active players, as a bit per player
+unsigned char get_active_players(void)
 {
 	return active_players;
 }
 
+// This function returns the number of players in the game
+unsigned count_active_players(void)
+{
+	unsigned count = 0;
+	int i;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if (active_players & PLAYER_BIT(i))
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
 // This function returns the game state
 unsigned char get_game_state(void)
 {
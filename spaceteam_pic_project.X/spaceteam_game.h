@@ -5,6 +5,9 @@
 #ifndef SPACETEAM_GAME_H_
 #define SPACETEAM_GAME_H_
 
+#include "spaceteam_clock.h"
+#include "spaceteam_pt.h"
+
 // The maximum number of keys which can be entered
 #define MAX_KEYPRESSES  4
 
@@ -34,23 +37,52 @@ typedef enum _spaceteam_req_t
 	NO_REQ		// This should always be last
 } spaceteam_req_t;
 
+// The inputs this board has, as a bit per request type. Boards which are
+//	missing an input clear its bit so no requests get routed to them for it.
+#define THIS_BOARD_INPUTS		((1 << NO_REQ) - 1)
+
 // Modulos for different request types
 #define NUM_KEYPAD_VALS 10000
 #define NUM_KNOB_VALS   11			// Valid values are 0 - 10
 #define NUM_SWITCH_VALS	2
 
+// Widths of the packed fields. Enums are 16 bits on XC16, so requests
+//	and packets keep them in bitfields instead, which lets a request fit
+//	in two words rather than four.
+#define REQ_TYPE_BITS			4		// Holds every request type and NO_REQ
+#define PLAYER_BITS				3		// Holds every player number
+#define DEBOUNCE_BITS			5		// Holds IO_DEBOUNCE_COUNT
+
 typedef struct _spaceteam_request
 {
-	spaceteam_req_t		type;
-	unsigned char 		board;
+	unsigned 			type 			: REQ_TYPE_BITS;	// A spaceteam_req_t
+	unsigned 			board 			: PLAYER_BITS;
+	unsigned			debounce_count 	: DEBOUNCE_BITS;
 	unsigned 			val;
-	unsigned char		debounce_count;
 
 } spaceteam_request_t;
 
+// The most requests a board can have out at once
+#define MAX_ISSUED_REQS			3
+// Number of our requests which need to be completed before we can 
+//	have another one out at the same time
+#define REQS_PER_LEVEL			8
+// The most requests which can be registered on one board at once. These
+//	are held in the request pool.
+#define MAX_ACTIVE_REQS			8
+
+// A request which we have issued, along with the time it has left. A
+//	time of zero means that the slot is free.
+typedef struct _issued_req_t
+{
+	spaceteam_request_t	req;
+	unsigned char 		time;
+} issued_req_t;
+
 // Timer values
 #define TIMER_1_ON 				0x8000
 #define TIMER_1_PRESCALE_256 	0x0030
+#define TIMER_1_TICK_US			((256 * 1000000UL) / CLOCK_FCY)	// 32us at full speed
 #define TIMER_1_INT_ENABLE 		IEC0bits.T1IE
 #define TIMER_1_PRIORITY		IPC0bits.T1IP
 #define TIMER_1_INT_FLAG		IFS0bits.T1IF
@@ -58,16 +90,32 @@ typedef struct _spaceteam_request
 #define TIMER_2_ON 				0x0004
 #define TIMER_2_POSTSCALE_16	0x0078
 #define TIMER_2_PRESCALE_16		0x0003
-#define TIMER_2_1KHz			32
+// Timer 2 counts at the full instruction clock over the prescaler and
+//	postscaler. It isn't affected by Doze mode.
+#define TIMER_2_COUNT_HZ		(CLOCK_FCY / (16 * 16))
+#define TIMER_2_1KHz			((TIMER_2_COUNT_HZ / 1000) - 1)
+#define TIMER_2_WAITING			((TIMER_2_COUNT_HZ / 122) - 1)	// About 122Hz, the slowest it goes
 #define TIMER_2_INT_ENABLE 		IEC0bits.T2IE
 #define TIMER_2_PRIORITY		IPC1bits.T2IP
 #define TIMER_2_INT_FLAG		IFS0bits.T2IF
 
+// Set to 1 to time how long issuing a new request takes, using the
+//	cycle count kept by the LED scan timer.
+//	The worst case is shown in cycles on the game over screen.
+#define PROFILE_REQ_SWAP		0
+
+// Random number generator values
+#define RNG_ZERO_SEED			0xACE1	// Any non-zero value works
+#define REQ_GEN_MAX_TRIES		4		// Rerolls before accepting a duplicate request
+
 // Request time value
 #define REQ_TIME_MAX			8
 
 // Number of timer interruprs (1KHz to wait before debouncing)
 #define IO_DEBOUNCE_COUNT 		25
+// The begin button is checked while we wait, when timer 2 runs at about
+//	122Hz, so it needs fewer ticks for the same debounce time
+#define BEGIN_DEBOUNCE_COUNT	3
 
 // Values for multiplexing the LEDs
 #define MIN_HEALTH_LED			8
@@ -76,8 +124,19 @@ typedef struct _spaceteam_request
 // LSEL value for the begin button
 #define BEGIN_ISEL_VAL			8
 
-#define PLAYER_PLAYING 1
-#define PLAYER_ABSENT 0
+// Sets of players are kept as a bitmask, with a bit per player
+#define PLAYER_BIT(player)		(1 << (player))
+
+// A recipient which means every board. Only the master sends to it.
+#define ALL_PLAYERS				((1 << PLAYER_BITS) - 1)
+
+// Time between the master's networking messages in the waiting room,
+//	which is one timer 2 tick while we wait
+#define NETWORK_SEND_GAP_MS		8
+
+// Time between the master's resume broadcasts after it was reset, which
+//	go out until every slave in the game has answered
+#define RESUME_SEND_GAP_MS		50
 
 // Different states that the game can be in
 typedef enum _game_state_t
@@ -88,34 +147,51 @@ typedef enum _game_state_t
 	GAME_OVER
 } game_state_t;;
 
+// A saved game, from spaceteam_checkpoint.h
+struct _spaceteam_checkpoint_t;
+
 //
 // Function declarations
 //
 void init_game(void);
 void begin_game(void);
+void game_resume(const struct _spaceteam_checkpoint_t * ckpt);
+void game_get_checkpoint(struct _spaceteam_checkpoint_t * ckpt);
+int game_was_resumed(void);
 unsigned lfsr_get_random(void);
+unsigned random_in_range(unsigned range);
+spaceteam_req_t random_request_type(void);
+int is_request_pending(spaceteam_req_t type, unsigned char board);
+void pick_request(spaceteam_request_t * req);
+void prepare_next_request(void);
 void generate_request(void);
+unsigned char count_issued_requests(void);
+void fill_requests(void);
+void update_request_display(void);
+void process_events(void);
 void register_request(spaceteam_req_t type, unsigned char board, unsigned val);
 void deregister_request(spaceteam_req_t type, unsigned char board, unsigned val);
-void request_done(void);
+void request_done(spaceteam_req_t type, unsigned char board);
 void init_timer_1(void);
 void _ISR _T1Interrupt(void);
 void init_timer_2(void);
 void _ISR _T2Interrupt(void);
-int check_request_completed(int req_no);
+int check_request_completed(spaceteam_request_t * req);
 int check_keypad_completed(unsigned val);
 int check_rfid_completed(unsigned val);
-int check_switch_completed(int req_no);
+int check_switch_completed(spaceteam_request_t * req);
 int check_knob_completed(unsigned val);
-void multiplex_leds(void);
+void update_leds(void);
 void update_key_buf(void);
 int is_begin_debounced(void);
 int scan_for_rfid(void);
 void set_game_rfid(unsigned char * data);
 int dec_game_health(void);
-void register_player(unsigned char player);
-unsigned char * get_active_players(void);
+void register_player(unsigned char player, unsigned inputs);
+unsigned char get_active_players(void);
+unsigned count_active_players(void);
 unsigned char get_game_state(void);
-void network_with_other_players(void);
+char network_thread(pt_t * pt);
+char resume_thread(pt_t * pt);
 
 #endif /* SPACETEAM_GAME_H_ */
\ No newline at end of file
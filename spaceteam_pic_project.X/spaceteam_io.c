@@ -3,7 +3,10 @@
 //
 
 #include "spaceteam_general.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_io.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_led.h"
 #include "xc.h"
 
 #define FCY 8000000UL
@@ -25,11 +28,6 @@ const unsigned char key_map[] = {
                                     CLR_CODE, 9, 6, 3  // COlumn 3
                                  };
 
-// Chip select values for remembering in interrupt context
-unsigned char wireless_cs_val;
-unsigned char rfid_cs_val;
-
-
 
 //
 // This function initializes the spaceteam program by 
@@ -73,28 +71,44 @@ int is_io_initialized(void)
     return init_done;
 }
 
+// This function writes the bits of port A which are set in mask to val,
+//  leaving the rest alone. The radio's chip select is on port A too, so
+//  the latch is read and written back with the interrupts which touch it
+//  held off, and never the pins, which could still be settling.
+void set_lata_bits(unsigned mask, unsigned val)
+{
+    unsigned ipl;
+
+    CRIT_ENTER(ipl, LED_INT_PRIORITY);
+    LATA = (LATA & ~mask) | (val & mask);
+    CRIT_EXIT(ipl);
+}
+
+// This function writes the bits of port B which are set in mask to val,
+//  leaving the rest alone. The LED scan rewrites the LED mux select at
+//  any moment, so it's held off for the couple of instructions this
+//  takes; a copy of the port written back any later would undo it.
+void set_latb_bits(unsigned mask, unsigned val)
+{
+    unsigned ipl;
+
+    CRIT_ENTER(ipl, LED_INT_PRIORITY);
+    LATB = (LATB & ~mask) | (val & mask);
+    CRIT_EXIT(ipl);
+}
+
 // Use this function to set the select lines of the
 //  IO mux to the passed value. Argument should
 //  be range [0,15].
 void set_isel(unsigned char val)
 {
-    unsigned char temp_val;
-    
-    // Read the previous value of port A
-    temp_val = PORTA;
-    // OR in the new value
-    temp_val = ((temp_val & ISEL_MASK) | (val & (~ISEL_MASK)));
-    // Write the new value back
-    LATA = temp_val;
-
-    // Success, so return 0
-    return;
+    set_lata_bits((unsigned char)~ISEL_MASK, val);
 }
 
 unsigned char get_switch_val(unsigned char sw_req)
 {
     set_isel(sw_req);
-    __delay_us(LSEL_PROP_DELAY);
+    clock_delay_us(LSEL_PROP_DELAY);
     return get_iomux();
 }
 
@@ -106,8 +120,11 @@ void set_lsel(unsigned val)
 {
     unsigned temp_val;
     
-    // Read the previous value of port B
-    temp_val = PORTB;
+    // Read the previous value of the port B latch. This is called from
+    //  the LED scan interrupt, which nothing else can interrupt, so the
+    //  latch can't change between the read and the write. Everyone else
+    //  goes through set_latb_bits().
+    temp_val = LATB;
     // OR in the new value
     temp_val = ((temp_val & LSEL_MASK) | ((val << 3) & (~LSEL_MASK)));
     // Write the new value back
@@ -129,13 +146,10 @@ unsigned char get_iomux(void)
 
 void init_keypad(void)
 {
-    unsigned curr_portb;
     int i;
 
     // Set all of the column drivers high
-    curr_portb = PORTB;
-    curr_portb = (curr_portb | KEYPAD_MASK);
-    LATB = curr_portb;
+    set_latb_bits(KEYPAD_MASK, KEYPAD_MASK);
 
     //Initialize the current column to 0
     curr_col = 0;
@@ -158,7 +172,7 @@ void init_keypad(void)
 //  quite difficult.
 unsigned char scan_and_debounce_keypad(void)
 {
-    unsigned curr_portb;
+    unsigned col_bit = (COL_DRIVE_MASK << curr_col);
     int i, idx;
 
     // keycodes to return are 0 - 11, NO_KEY indicates
@@ -166,9 +180,7 @@ unsigned char scan_and_debounce_keypad(void)
     unsigned char ret_val = NO_KEY;
 
     // First, we need to drive the keypad's column low
-    curr_portb = PORTB;
-    curr_portb = curr_portb & (~(COL_DRIVE_MASK << curr_col));
-    LATB = curr_portb;
+    set_latb_bits(col_bit, 0);
 
     // Now, we want to look at the various rows and see if they are low
     for (i = 0; i < 4; i++)
@@ -180,7 +192,7 @@ unsigned char scan_and_debounce_keypad(void)
         set_isel(4 + i);
 
         // give it a few clocks to propogate 
-        __delay_us(LSEL_PROP_DELAY);
+        clock_delay_us(LSEL_PROP_DELAY);
 
         // If the key has been pressed
         if(get_iomux() == 0)
@@ -206,8 +218,7 @@ unsigned char scan_and_debounce_keypad(void)
     }
 
     // Need to send the column driver line high again
-    curr_portb = curr_portb | (COL_DRIVE_MASK << curr_col);
-    LATB = curr_portb;
+    set_latb_bits(col_bit, col_bit);
 
     // Wrap around the three rows
     curr_col = (curr_col + 1) % 3;
@@ -223,7 +234,7 @@ unsigned get_knob_sample(void)
     AD1CON1bits.SAMP = 1;
 
     // Give it a few microseconds to complete
-    __delay_us(2);
+    clock_delay_us(2);
 
     // Now clear the sample bit to begin conversion
     AD1CON1bits.SAMP = 0;
@@ -234,30 +245,3 @@ unsigned get_knob_sample(void)
     return ADC1BUF0;
 
 }
-
-//
-// These functions MUST BE CALLED in the intro/outro of interrupts
-//  in order to not mess up SPI
-//
-
-// This one sets the chip selects high
-void int_set_chip_selects(void)
-{   
-    // Read the old values of the chip selects
-    wireless_cs_val = PORTAbits.RA7;
-    rfid_cs_val     = PORTBbits.RB12;
-
-    // Set them both high
-    LATAbits.LATA7 = 1;
-    LATBbits.LATB12 = 1;
-
-
-
-}
-
-// And this one resets them
-void int_reset_chip_selects(void)
-{
-    LATAbits.LATA7 = wireless_cs_val;
-    LATBbits.LATB12 = rfid_cs_val;
-}
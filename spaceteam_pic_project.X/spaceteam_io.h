@@ -99,6 +99,8 @@ extern "C" {
 
 void init_io(void);
 int is_io_initialized(void);
+void set_lata_bits(unsigned mask, unsigned val);
+void set_latb_bits(unsigned mask, unsigned val);
 void set_isel(unsigned char val);
 void set_lsel(unsigned val);
 unsigned char get_iomux(void);
@@ -108,11 +110,6 @@ unsigned char scan_and_debounce_keypad(void);
 unsigned get_knob_sample(void);
 unsigned char get_switch_val(unsigned char sw_req);
 
-// Functions for setting high and then resetting chip selects
-//	in interrupt context
-void int_set_chip_selects(void);
-void int_reset_chip_selects(void);
-
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,136 @@
+//
+// This file drives the LEDs. The LED mux always has exactly one LED
+//	selected and lit, so there is no way to turn them all off, and an
+//	LED which is left selected while it should be dark shows up as a
+//	ghost. Instead, timer 3 only ever selects LEDs which are lit. Each
+//	LED's brightness is a binary code, with each bit worth twice as long
+//	as the one below it, and since an LED's bits are shown back to back
+//	they add up to a single slot of (brightness) base periods. With no
+//	dark slots, brightness is relative to the other lit LEDs; see
+//	spaceteam_led.h. The game draws into the framebuffer only when
+//	something changes, so the scan interrupt just reads the next slot
+//	from it.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_io.h"
+#include "spaceteam_led.h"
+#include "spaceteam_crit.h"
+
+// The framebuffer. It's a list of the LEDs which are lit, each entry
+//	holding the LED in the low nibble and its brightness in the high one.
+unsigned char led_list[NUM_LEDS];
+unsigned char led_list_len;
+
+// The entry in the list being scanned
+unsigned char led_pos;
+
+// Cycles counted by timer 3 in all of its finished periods, so that it
+//	can still be used to time things
+volatile unsigned led_elapsed;
+
+// Set up the framebuffer and start scanning
+void init_leds(void)
+{
+	led_list_len = 0;
+	led_pos = 0;
+	led_elapsed = 0;
+
+	// Timer 3 runs at the instruction clock, with the period
+	//	changed on every interrupt
+	TMR3 = 0;
+	PR3 = LED_BASE_PERIOD - 1;
+
+	TIMER_3_PRIORITY = LED_INT_PRIORITY;
+	TIMER_3_INT_FLAG = 0;
+	TIMER_3_INT_ENABLE = 1;
+
+	T3CON = TIMER_3_ON;
+}
+
+// This function draws the passed frame, which has a brightness for every
+//	LED, into the framebuffer. The scan interrupt is held off while the
+//	list is rewritten so that it never scans half of a frame.
+void led_show(unsigned char * frame)
+{
+	unsigned char len = 0;
+	unsigned ipl;
+	int i;
+
+	CRIT_ENTER(ipl, LED_INT_PRIORITY);
+
+	for (i = 0; i < NUM_LEDS; i++)
+	{
+		if (frame[i] != LED_OFF)
+		{
+			led_list[len] = (frame[i] << LED_LEVEL_SHIFT) | i;
+			len++;
+		}
+	}
+	led_list_len = len;
+	led_pos = 0;
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns the number of LEDs which are lit
+unsigned char led_get_lit_count(void)
+{
+	return led_list_len;
+}
+
+// This function returns a free-running count of instruction cycles,
+//	for timing how long things take
+unsigned led_get_cycles(void)
+{
+	unsigned cycles;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, LED_INT_PRIORITY);
+
+	cycles = TMR3;
+
+	// If the timer has rolled over but the interrupt hasn't run
+	//	yet, that period isn't in the count yet
+	if (TIMER_3_INT_FLAG)
+	{
+		cycles = led_elapsed + PR3 + 1 + TMR3;
+	}
+	else
+	{
+		cycles = led_elapsed + cycles;
+	}
+
+	CRIT_EXIT(ipl);
+
+	return cycles;
+}
+
+// This is the timer 3 interrupt. It selects the next lit LED and sets
+//	how long it stays up.
+void _ISR _T3Interrupt(void)
+{
+	unsigned char entry;
+
+	// Count the period which just finished
+	led_elapsed += PR3 + 1;
+
+	// If nothing is lit, there's nothing better to do than leave the
+	//	mux where it is
+	if (led_list_len != 0)
+	{
+		entry = led_list[led_pos];
+
+		set_lsel(entry & LED_SEL_MASK);
+		PR3 = (LED_BASE_PERIOD * (entry >> LED_LEVEL_SHIFT)) - 1;
+
+		led_pos++;
+		if (led_pos >= led_list_len)
+		{
+			led_pos = 0;
+		}
+	}
+
+	TIMER_3_INT_FLAG = 0;
+}
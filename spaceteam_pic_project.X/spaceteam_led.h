@@ -0,0 +1,63 @@
+//
+// This is the include file for the LEDs. The LEDs are drawn from a
+//	framebuffer with a brightness for each LED, which is scanned out
+//	by timer 3.
+//
+// It isn't true binary code modulation, where each bit of an LED's
+//	brightness has a slot of fixed length in every frame and the LED is
+//	dark for the bits which are clear. The LED mux always has one LED
+//	lit, so there's no way to show a dark slot. Instead each lit LED is
+//	shown for as many base periods as its brightness, one after another,
+//	and the frame is only as long as they add up to. So a lit LED's
+//	brightness is its share of the total, not a fixed part of a frame:
+//	a lone LED at LED_DIM is as bright as one at LED_FULL, and an LED
+//	gets dimmer as others light up. Only the ratios between the LEDs
+//	which are lit come out as drawn.
+//
+
+#ifndef SPACETEAM_LED_H_
+#define SPACETEAM_LED_H_
+
+// Number of LEDs on the LED mux
+#define NUM_LEDS				16
+
+// Number of bits of brightness. Each bit is worth twice as many base
+//	periods as the one below it.
+#define LED_PLANES				3
+
+// Brightness levels
+#define LED_OFF					0
+#define LED_DIM					2
+#define LED_HALF				4
+#define LED_FULL				((1 << LED_PLANES) - 1)
+
+// Length of the lowest bit, in instruction cycles. With every LED at
+//	full brightness, a frame is NUM_LEDS * LED_FULL of these, which comes
+//	out to about 120Hz. With fewer or dimmer LEDs lit it's shorter.
+#define LED_BASE_PERIOD			600
+
+// Framebuffer entries hold the LED in the low nibble and its
+//	brightness in the high one
+#define LED_SEL_MASK			0x0F
+#define LED_LEVEL_SHIFT			4
+
+// Timer 3 values
+#define TIMER_3_ON 				0x8000
+#define TIMER_3_INT_ENABLE 		IEC0bits.T3IE
+#define TIMER_3_PRIORITY		IPC2bits.T3IP
+#define TIMER_3_INT_FLAG		IFS0bits.T3IF
+
+// The scan interrupt is very short, so it runs above the wireless (see
+//	RADIO_INT_PRIORITY in spaceteam_crit.h) so that long interrupts don't
+//	make the LEDs flicker. The radio can be late by the length of it.
+#define LED_INT_PRIORITY		7
+
+//
+// Function declarations
+//
+void init_leds(void);
+void led_show(unsigned char * frame);
+unsigned led_get_cycles(void);
+unsigned char led_get_lit_count(void);
+
+#endif /* SPACETEAM_LED_H_ */
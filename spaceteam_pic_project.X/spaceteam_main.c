@@ -11,8 +11,14 @@
 #include "spaceteam_io.h"
 #include "spaceteam_rfid.h"
 #include "spaceteam_general.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_msg.h"
 #include "spaceteam_wireless.h"
+#include "spaceteam_power.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_chan.h"
 
 //
 // Define the clock frequency
@@ -47,9 +53,9 @@
 #pragma config FCKSM = CSDCMD           // Clock Switching and Monitor Selection (Clock Switching and Fail-safe Clock Monitor Disabled)
 
 // FWDT
-#pragma config WDTPS = PS32768          // Watchdog Timer Postscale Select bits (1:32768)
-#pragma config FWPSA = PR128            // WDT Prescaler bit (WDT prescaler ratio of 1:128)
-#pragma config FWDTEN = OFF             // Watchdog Timer Enable bits (WDT disabled in hardware; SWDTEN bit disabled)
+#pragma config WDTPS = PS16             // Watchdog Timer Postscale Select bits (1:16)
+#pragma config FWPSA = PR32             // WDT Prescaler bit (WDT prescaler ratio of 1:32)
+#pragma config FWDTEN = SWON            // Watchdog Timer Enable bits (WDT controlled with the SWDTEN bit setting)
 #pragma config WINDIS = OFF             // Windowed Watchdog Timer Disable bit (Standard WDT selected (windowed WDT disabled))
 
 // FPOR
@@ -63,39 +69,50 @@
 #pragma config ICS = PGx3               // ICD Pin Placement Select (EMUC/EMUD share PGC3/PGD3)
 
 int main(void) {
-    
-    unsigned char * players;
-    int i;
 
 
     // Want to initialize the game
     init_game();
 
-    // Enter the waiting state for other players
-    network_with_other_players();
-
-    // If we're the master player, we need to send out the begin messages to all other players
+    // If we were reset in the middle of a game, we're already back in it.
+    //  Otherwise wait in the waiting room for the game to start.
+    //  The master keeps telling the others it's back until they answer.
+    if (!game_was_resumed())
+    {
+        sched_start(network_thread);
+    }
     #if (THIS_PLAYER == MASTER_PLAYER)
-        players = get_active_players();
-        for (i = 1; i < NUM_PLAYERS; i++)
+        else
         {
-            if (players[i] == PLAYER_PLAYING)
-            {
-                display_write_line(1, "sending begin to 1");
-                send_message(MSG_BEGIN, 0, THIS_PLAYER, i, 0);
-                __delay_ms(100);
-            }
+            sched_start(resume_thread);
         }
     #endif
 
+    // The master polls the slaves whenever there's a game on
+    #if (THIS_PLAYER == MASTER_PLAYER)
+        sched_start(poll_thread);
+    #endif
+
+    // And everyone keeps the game on a clear channel
+    sched_start(chan_thread);
+
 
 
 
     // Made it to while loop!
     // display_write_line(1, "game begun!");
 
-    // Just loop for now
-    while(1){};
+    // Use our spare time to run the threads, to get the next request
+    //  ready, to handle whatever the interrupts have queued up and to
+    //  write out any checkpoint. Then stop the CPU until the next interrupt.
+    while(1)
+    {
+        sched_run();
+        prepare_next_request();
+        process_events();
+        checkpoint_service();
+        power_idle();
+    }
 
     display_write_line(1, "game over!");
 
@@ -7,46 +7,386 @@
 #include "spaceteam_display.h"
 #include "spaceteam_msg.h"
 #include "spaceteam_general.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_wireless.h"
+#include "spaceteam_alloc.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_chan.h"
+#include <stddef.h>
+
+// Make sure that every message type fits in the packed packet field,
+//	and that the players and request types fit in their nibbles on the
+//	wire
+typedef char msg_type_fits[(NUM_MSGS <= (1 << MSG_TYPE_BITS)) ? 1 : -1];
+typedef char wire_fields_fit[( (MSG_TYPE_BITS <= 4) && (PLAYER_BITS <= 4) && (REQ_TYPE_BITS <= 4) ) ? 1 : -1];
 
 #define FCY 8000000UL
 #include <libpic30.h> 
 
-// memory used for sending a packet
-spaceteam_packet_t packet_buf;
+// The messages waiting to go out, in the wire format. There's only the
+//	one payload rather than one per board, to save RAM, so a message to
+//	a different board sends the waiting ones first.
+unsigned char msg_agg_buf[wl_module_PAYLOAD_LEN];
+unsigned char msg_agg_len;
+unsigned char msg_agg_dest;				// The board they're for
+unsigned msg_agg_since;					// When the first one was added, in scheduler ms
+unsigned msg_dropped;					// Messages which the radio had no room for
 
 // This function sends a spaceteam message packet to another board.
-//	If will eventually do this using the wireless, but for now, just 
-//	keep everything local
-void send_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val )
+//	It returns FAILURE if the message was dropped for lack of room.
+int send_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val )
 {
+	spaceteam_packet_t * packet;
+	spaceteam_packet_t local;
+	int status = SUCCESS;
+
 	// First, see if the board that we are sending this to is our own. If so, 
 	//	just process it now and don't bother routing it through the master,
-	//	though that theoretically should work
+	//	though that theoretically should work. It still goes through
+	//	send_packet, so that a slave copies requests ending on its own
+	//	board to the master's request table.
 	if (recipient == THIS_PLAYER)
 	{
-		parse_message(msg, req, sender, recipient, val);
+		local.type = msg;
+		local.sender = sender;
+		local.recipient = recipient;
+		local.request = req;
+		local.val = val;
+
+		status = send_packet(&local);
 	}
 	else
 	{
-		// Move the message info into the packet buffer
-		packet_buf.type = msg;
-		packet_buf.sender = sender;
-		packet_buf.recipient = recipient;
-		packet_buf.request = req;
-		packet_buf.val = val;
+		// Get a packet of our own, so that an interrupt sending
+		//	at the same time can't write over it
+		packet = (spaceteam_packet_t *)pool_alloc(&packet_pool);
+		if (packet == NULL)
+		{
+			return FAILURE;
+		}
+
+		// Move the message info into the packet
+		packet->type = msg;
+		packet->sender = sender;
+		packet->recipient = recipient;
+		packet->request = req;
+		packet->val = val;
+
+		// Send it off. The radio has its own copy once this returns, so
+		//	we can give the packet back right away
+		status = send_packet(packet);
+		pool_free(&packet_pool, packet);
+	}
+
+	return status;
+}
+
+// This function sends a packet which has already been filled out. It's 
+//	used when the packet was built ahead of time. It returns FAILURE if
+//	the packet was dropped for lack of room.
+int send_packet(spaceteam_packet_t * packet)
+{
+	int status = SUCCESS;
+
+	// If it's for us, just process it now
+	if (packet->recipient == THIS_PLAYER)
+	{
+		parse_message(packet->type, packet->request, packet->sender, packet->recipient, packet->val);
 
+		// The master keeps the request table, so it needs to hear about
+		//	requests starting and ending even when they stay on one board
+		#if (THIS_PLAYER != MASTER_PLAYER)
+			if (packet->type <= MSG_REQ_FAILED)
+			{
+				msg_queue(packet, MASTER_PLAYER);
+			}
+		#endif
+	}
+	else
+	{
 		// if we are the wireless master, send it. Otherwise, we want to write it to our 
 		//	ACK FIFO
 		#if (THIS_PLAYER == MASTER_PLAYER)
+			// Keep the request table up to date
+			alloc_note_message(packet->type, packet->request, packet->sender, packet->recipient, packet->val);
 			// And then send the packet
-			wl_module_send_payload((unsigned char *)&packet_buf, recipient);
+			status = msg_queue(packet, packet->recipient);
 		// If we are not the master
 		#else
 			// Then send it as a response
-			wl_module_send_ack((unsigned char *)&packet_buf);
+			status = msg_queue(packet, MASTER_PLAYER);
+		#endif
+	}
+
+	return status;
+}
+
+// This function adds a packet to the ones waiting to go out to the
+//	passed board. Messages to the same board are sent together in one
+//	payload, once the payload is full, a message goes to a different
+//	board, an urgent message is added or they've waited long enough.
+//	It returns FAILURE if the packet had to be dropped.
+int msg_queue(const spaceteam_packet_t * packet, unsigned char dest)
+{
+	unsigned char buf[WIRE_MAX_LEN];
+	unsigned char len;
+	unsigned char i;
+	unsigned ipl;
+
+	len = msg_pack(packet, buf);
+
+	// Hold off everyone else who sends while we add to the payload
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	// If the waiting messages have to go first but the radio has no room
+	//	for them yet, this one is dropped rather than them
+	if ( (msg_agg_len != 0) &&
+		 ((dest != msg_agg_dest) || ((msg_agg_len + len) > WL_MSG_PAYLOAD_LEN)) )
+	{
+		if (msg_flush() == FAILURE)
+		{
+			msg_dropped++;
+			CRIT_EXIT(ipl);
+			return FAILURE;
+		}
+	}
+
+	if (msg_agg_len == 0)
+	{
+		msg_agg_dest = dest;
+		msg_agg_since = sched_get_ms();
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		msg_agg_buf[msg_agg_len + i] = buf[i];
+	}
+	msg_agg_len += len;
+
+	if (MSG_URGENT_MSGS & (1 << packet->type))
+	{
+		msg_flush();
+	}
+
+	CRIT_EXIT(ipl);
+
+	return SUCCESS;
+}
+
+// This function sends out whatever messages are waiting. The master
+//	transmits them, and a slave hands them to the radio to go back
+//	to the master with the next ACK. If the radio's queue is full they
+//	keep waiting, and it returns FAILURE.
+int msg_flush(void)
+{
+	int status = SUCCESS;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	if (msg_agg_len != 0)
+	{
+		// Talk to the radio at full speed
+		clock_boost();
+
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			if (msg_agg_dest == ALL_PLAYERS)
+			{
+				status = wl_module_send_broadcast(msg_agg_buf, msg_agg_len);
+			}
+			else
+			{
+				status = wl_module_send_payload(msg_agg_buf, msg_agg_len, msg_agg_dest);
+			}
+		#else
+			status = wl_module_send_ack(msg_agg_buf, msg_agg_len);
 		#endif
+
+		clock_release();
+
+		if (status == SUCCESS)
+		{
+			// The slave gets to answer in the ACK, so it doesn't need
+			//	a poll for a while
+			#if (THIS_PLAYER == MASTER_PLAYER)
+				if (msg_agg_dest != ALL_PLAYERS)
+				{
+					poll_note_sent(msg_agg_dest);
+				}
+			#endif
+			msg_agg_len = 0;
+		}
 	}
+
+	CRIT_EXIT(ipl);
+
+	return status;
+}
+
+// This function sends out the waiting messages once the first of them
+//	has waited MSG_AGG_DEADLINE_MS. It's called every timer 2 tick, so
+//	it also tries again when the radio had no room for them.
+void msg_service(void)
+{
+	if ( (msg_agg_len != 0) && sched_ms_passed(msg_agg_since + MSG_AGG_DEADLINE_MS) )
+	{
+		msg_flush();
+	}
+}
+
+// This function returns 1 if there are messages waiting to go out
+int msg_pending(void)
+{
+	return (msg_agg_len != 0);
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This function goes through the payload to the passed slave which the
+//	radio gave up on. It's called from the main loop for EVENT_TX_FAILED.
+//	The slots in any grants it had are freed, and messages about requests
+//	are sent again for as long as the slave is in the game. A payload
+//	which was lost while the last one was still waiting here is gone.
+void msg_note_lost(unsigned char dest)
+{
+	unsigned char buf[WL_MSG_PAYLOAD_LEN];
+	spaceteam_packet_t packet;
+	unsigned char len;
+	unsigned char pos = 0;
+	unsigned char used;
+
+	len = wl_module_tx_take_lost(buf);
+
+	while (pos < len)
+	{
+		used = msg_unpack(&buf[pos], len - pos, &packet);
+		if (used == 0)
+		{
+			break;
+		}
+		pos += used;
+
+		if (packet.type == MSG_REQ_GRANT)
+		{
+			alloc_release_grant(dest, packet.request, packet.val);
+		}
+		else if ( (MSG_RESEND_MSGS & (1 << packet.type)) &&
+				  (get_game_state() == GAME_STARTED) && (get_active_players() & PLAYER_BIT(dest)) )
+		{
+			msg_queue(&packet, dest);
+		}
+	}
+}
+
+#endif
+
+// This function writes a packet out in the wire format, and returns
+//	its length. The buffer has to be WIRE_MAX_LEN bytes.
+unsigned char msg_pack(const spaceteam_packet_t * packet, unsigned char * buf)
+{
+	unsigned char len = WIRE_HEADER_LEN;
+	unsigned char val_len;
+
+	// Only send as much of the value as there is
+	if (packet->val == 0)
+	{
+		val_len = 0;
+	}
+	else if (packet->val <= 0xFF)
+	{
+		val_len = 1;
+	}
+	else
+	{
+		val_len = 2;
+	}
+
+	buf[0] = (WIRE_VERSION << WIRE_VERSION_SHIFT) | (packet->type << WIRE_TYPE_SHIFT) | val_len;
+	buf[1] = (packet->sender << WIRE_SENDER_SHIFT) | packet->recipient;
+
+	if (WIRE_REQ_MSGS & (1 << packet->type))
+	{
+		buf[len] = packet->request << WIRE_REQ_SHIFT;
+		len++;
+	}
+
+	if (val_len != 0)
+	{
+		buf[len] = packet->val & 0xFF;
+		len++;
+	}
+	if (val_len == 2)
+	{
+		buf[len] = packet->val >> 8;
+		len++;
+	}
+
+	return len;
+}
+
+// This function reads the packet at the start of a payload in the wire
+//	format, and returns how many bytes it took up. It returns 0 if it's
+//	from a different version of the game, cut short or nonsense, in which
+//	case it and whatever follows it should be dropped.
+unsigned char msg_unpack(const unsigned char * buf, unsigned char len, spaceteam_packet_t * packet)
+{
+	unsigned char pos = WIRE_HEADER_LEN;
+	unsigned char val_len;
+	unsigned char type;
+
+	if ( (len < WIRE_HEADER_LEN) || ((buf[0] >> WIRE_VERSION_SHIFT) != WIRE_VERSION) )
+	{
+		return 0;
+	}
+
+	type = (buf[0] >> WIRE_TYPE_SHIFT) & WIRE_TYPE_MASK;
+	val_len = buf[0] & WIRE_VAL_LEN_MASK;
+
+	if ( (type >= NUM_MSGS) || (val_len > 2) )
+	{
+		return 0;
+	}
+
+	if ( ((buf[1] >> WIRE_SENDER_SHIFT) >= NUM_PLAYERS) ||
+		 (((buf[1] & WIRE_NIBBLE_MASK) >= NUM_PLAYERS) && ((buf[1] & WIRE_NIBBLE_MASK) != ALL_PLAYERS)) )
+	{
+		return 0;
+	}
+
+	packet->type = type;
+	packet->sender = buf[1] >> WIRE_SENDER_SHIFT;
+	packet->recipient = buf[1] & WIRE_NIBBLE_MASK;
+	packet->request = 0;
+	packet->val = 0;
+
+	if (WIRE_REQ_MSGS & (1 << type))
+	{
+		if (len <= pos)
+		{
+			return 0;
+		}
+		packet->request = buf[pos] >> WIRE_REQ_SHIFT;
+		pos++;
+	}
+
+	if (len < (pos + val_len))
+	{
+		return 0;
+	}
+
+	if (val_len != 0)
+	{
+		packet->val = buf[pos];
+	}
+	if (val_len == 2)
+	{
+		packet->val |= (unsigned)buf[pos + 1] << 8;
+	}
+
+	return pos + val_len;
 }
 
 // This function parses messages that are meant for our board
@@ -59,16 +399,36 @@ void parse_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sende
 	// 	char forward_msg = 0;
 	// #endif
 
-	// // We first need to see if we should simply be forwarding this message along, as 
-	// //	can happen if we are the wireless master
-	// #if (THIS_PLAYER == MASTER_PLAYER)
-	// 	if (recipient != THIS_PLAYER)
-	// 	{
-	// 		send_message(msg, req, sender, recipient, val);
-	// 	}
-	// 	// Otherwise, the message is meant for us
-	// 	else
-	// #endif
+	// We first need to see if we should simply be forwarding this message along, as 
+	//	can happen if we are the wireless master. Slaves can only talk to
+	//	the master, so everything between two slaves goes through us.
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		// Only we send to everyone, so one from a slave is garbage
+		if (recipient == ALL_PLAYERS)
+		{
+			return;
+		}
+
+		if (recipient != THIS_PLAYER)
+		{
+			// A message a slave sent to itself is a copy for the request
+			//	table, so don't send it back. Anything else gets forwarded, 
+			//	and the request table is updated on the way out.
+			if (recipient == sender)
+			{
+				alloc_note_message(msg, req, sender, recipient, val);
+			}
+			else
+			{
+				send_message(msg, req, sender, recipient, val);
+			}
+			return;
+		}
+
+		// Otherwise, the message is meant for us
+		alloc_note_message(msg, req, sender, recipient, val);
+	#endif
+
 	{
 		// Parse the message based on message type
 		switch(msg)
@@ -81,10 +441,9 @@ void parse_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sende
 			case MSG_REQ_FAILED:
 				deregister_request(req, sender, val);
 				break;
-			// If our request has been completed
+			// If our request has been completed, then make a new one
 			case MSG_REQ_COMPLETED:
-				// Just generate a new request
-				// generate_request();
+				request_done(req, sender);
 				break;
 			// If it's a standard polling message from the master
 			case MSG_POLL:
@@ -98,12 +457,56 @@ void parse_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sende
 				break;
 			// If it's a networking request, then register the player
 			case MSG_NETWORKING:
-				register_player(sender);
+				register_player(sender, val);
 				break;
 			// We need to begin the game!
 			case MSG_BEGIN:
+				// The master sends everyone the players in the game,
+				//	and we only join if we're one of them
+				#if (THIS_PLAYER != MASTER_PLAYER)
+					if (!(val & PLAYER_BIT(THIS_PLAYER)))
+					{
+						break;
+					}
+				#endif
 				begin_game();
 				break;
+			// The master has given us a request slot to use. The
+			//	value is the board the slot is on.
+			case MSG_REQ_GRANT:
+				#if (THIS_PLAYER != MASTER_PLAYER)
+					alloc_store_grant(req, val);
+				#endif
+				break;
+			// A board was reset in the middle of the game and picked it
+			//	back up. The value is the inputs it has. The master
+			//	needs them again, and takes back the request slots it
+			//	lost. If it was the master which was reset, it needs ours.
+			case MSG_RESUME:
+				#if (THIS_PLAYER == MASTER_PLAYER)
+					register_player(sender, val);
+					alloc_release_grants(sender);
+				#else
+					send_message(MSG_NETWORKING, 0, THIS_PLAYER, MASTER_PLAYER, THIS_BOARD_INPUTS);
+				#endif
+				break;
+			// The master says which channel to play on. The value is
+			//	the channel.
+			case MSG_CHANNEL:
+				#if (THIS_PLAYER != MASTER_PLAYER)
+					chan_set_pending(val);
+				#endif
+				break;
+			// The master is moving our link to another data rate. The
+			//	value is the rate.
+			case MSG_RATE:
+				#if (THIS_PLAYER != MASTER_PLAYER)
+					if (val < WL_NUM_RATES)
+					{
+						wl_module_rate_try(val);
+					}
+				#endif
+				break;
 			default:
 				break;
 		}
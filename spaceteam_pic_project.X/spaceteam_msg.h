@@ -17,26 +17,88 @@ typedef enum _spaceteam_msg_t
 	MSG_HEALTH,
 	MSG_NETWORKING,
 	MSG_BEGIN,
+	MSG_REQ_GRANT,
+	MSG_RESUME,
+	MSG_CHANNEL,
+	MSG_RATE,
+	MSG_GRANT_RETURN,
 	NUM_MSGS
 } spaceteam_msg_t;
 
-// The message packet to be sent
+// Width of the packed message type
+#define MSG_TYPE_BITS			4
+
+// A message, as the game sees it. The fields are packed into a word,
+//	followed by the value. This isn't what goes over the air, since its
+//	layout is up to the compiler; msg_pack and msg_unpack convert it to
+//	and from the wire format below.
 typedef struct _spaceteam_packet_t
 {
-	spaceteam_msg_t type;			// The type of message this is
-	unsigned char sender;			// which board originated the message
-	unsigned char recipient;		// which board is the final destination of the message
-	spaceteam_req_t request;		// If necessary, the game request type
-	unsigned 		val;			// And the game request value
+	unsigned type 		: MSG_TYPE_BITS;	// The type of message this is, a spaceteam_msg_t
+	unsigned sender 	: PLAYER_BITS;		// which board originated the message
+	unsigned recipient 	: PLAYER_BITS;		// which board is the final destination of the message
+	unsigned request 	: REQ_TYPE_BITS;	// If necessary, the game request type
+	unsigned val;							// And the game request value
 } spaceteam_packet_t;
 
-// The size of a spaceteam packet
-#define SPACETEAM_PACKET_SIZE (sizeof(spaceteam_packet_t))
+// The wire format. Every packet starts with two header bytes:
+//
+//	byte 0:	version (2 bits) | message type (4 bits) | value length (2 bits)
+//	byte 1:	sender (4 bits) | recipient (4 bits)
+//
+//	Messages about a request are followed by a byte with the request
+//	type in its high nibble, and then come however many bytes of the
+//	value there are, low byte first. A value of 0 isn't sent at all.
+#define WIRE_VERSION			1
+#define WIRE_VERSION_SHIFT		6
+#define WIRE_TYPE_SHIFT			2
+#define WIRE_TYPE_MASK			0x0F
+#define WIRE_VAL_LEN_MASK		0x03
+#define WIRE_SENDER_SHIFT		4
+#define WIRE_NIBBLE_MASK		0x0F
+#define WIRE_REQ_SHIFT			4
+#define WIRE_HEADER_LEN			2
+
+// The messages which have a request type byte, a bit per spaceteam_msg_t
+#define WIRE_REQ_MSGS			( (1 << MSG_NEW_REQ) | (1 << MSG_REQ_COMPLETED) | \
+								  (1 << MSG_REQ_FAILED) | (1 << MSG_REQ_GRANT) | \
+								  (1 << MSG_GRANT_RETURN) )
+
+// The longest packet: the header, a request type and a two byte value
+#define WIRE_MAX_LEN			(WIRE_HEADER_LEN + 1 + 2)
+
+// Messages to the same board are held for up to this long, in ms, so
+//	that the ones sent close together go out in one payload
+#define MSG_AGG_DEADLINE_MS		2
+
+// The messages which go out right away, a bit per spaceteam_msg_t. These
+//	are the ones from the waiting room, which never come in bunches, and
+//	the master's polls, which are only sent to get the ACK back. A channel
+//	isn't, so that the one in the join handshake goes out in the same
+//	payload as the MSG_NETWORKING after it. A hop sends its own right away.
+#define MSG_URGENT_MSGS			( (1 << MSG_NETWORKING) | (1 << MSG_BEGIN) | (1 << MSG_RESUME) | \
+								  (1 << MSG_POLL) )
+
+// The messages which the master sends again when the payload they were
+//	in was never ACKed, a bit per spaceteam_msg_t. These are the ones
+//	about requests, which nobody else would send again. Grants aren't,
+//	since the slot is freed instead, and the rest are repeated by
+//	whoever sent them.
+#define MSG_RESEND_MSGS			( (1 << MSG_NEW_REQ) | (1 << MSG_REQ_COMPLETED) | \
+								  (1 << MSG_REQ_FAILED) | (1 << MSG_HEALTH) )
 
 //
 // Function declarations
 //
-void send_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val );
+int send_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val );
+int send_packet(spaceteam_packet_t * packet);
+unsigned char msg_pack(const spaceteam_packet_t * packet, unsigned char * buf);
+unsigned char msg_unpack(const unsigned char * buf, unsigned char len, spaceteam_packet_t * packet);
+int msg_queue(const spaceteam_packet_t * packet, unsigned char dest);
+int msg_flush(void);
+void msg_service(void);
+int msg_pending(void);
+void msg_note_lost(unsigned char dest);
 void parse_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned val);
 
 #endif /* SPACETEAM_MSG_H_ */
\ No newline at end of file
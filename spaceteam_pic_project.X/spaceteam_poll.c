@@ -0,0 +1,218 @@
+//
+// This file implements the master's poller. Every slave has a time its
+//	next poll is due, and the thread sends MSG_POLL to the ones whose
+//	time has come. Polls go out right away rather than waiting to be
+//	put in with other messages, since all they're for is the ACK.
+//
+// The uplink latency of a message is measured when it gets to us, as
+//	the time since the contact before the one which brought it back.
+//	The slave couldn't have had it ready any earlier than that, or it
+//	would have come back with that contact instead, so it's the most
+//	the message could have waited.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_wireless.h"
+#include "spaceteam_poll.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// How often each slave is polled, in ms, and when its next poll is due
+unsigned poll_period[NUM_PLAYERS];
+unsigned poll_due[NUM_PLAYERS];
+
+// Set once a slave has sent us anything since its last poll
+unsigned char poll_answered[NUM_PLAYERS];
+
+// The last two times we sent each slave anything
+unsigned poll_contact[NUM_PLAYERS];
+unsigned poll_prev_contact[NUM_PLAYERS];
+
+// The uplink latency of the last message from each slave, and the worst
+unsigned poll_latency[NUM_PLAYERS];
+unsigned poll_max_latency[NUM_PLAYERS];
+
+// This function starts every slave off at the fastest rate, as if we'd
+//	just been in touch with it. It's called again at the start of each game.
+void init_poll(void)
+{
+	int i;
+	unsigned now;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	now = sched_get_ms();
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		poll_period[i] = POLL_MIN_MS;
+		poll_due[i] = now;
+		poll_answered[i] = 0;
+		poll_contact[i] = now;
+		poll_prev_contact[i] = now;
+		poll_latency[i] = 0;
+		poll_max_latency[i] = 0;
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns 1 if the passed player is a slave in the game
+//	whose poll is due
+int poll_is_due(unsigned char player)
+{
+	return ( (player != MASTER_PLAYER) && (get_active_players() & PLAYER_BIT(player)) &&
+			 sched_ms_passed(poll_due[player]) && !wl_module_tx_is_held(player) );
+}
+
+// This function returns 1 if any slave's poll is due
+int poll_any_due(void)
+{
+	unsigned char i;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if (poll_is_due(i))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// This function sets how often the passed slave is polled from how it
+//	answered the last one, and polls it. One we'd lost comes back at the
+//	slowest rate.
+void poll_send(unsigned char player)
+{
+	if (poll_answered[player])
+	{
+		if (poll_period[player] > POLL_MAX_MS)
+		{
+			poll_period[player] = POLL_MAX_MS;
+		}
+		else if (poll_period[player] > POLL_MIN_MS)
+		{
+			poll_period[player] >>= 1;
+		}
+	}
+	else if (poll_period[player] < POLL_MAX_MS)
+	{
+		poll_period[player] <<= 1;
+	}
+
+	poll_answered[player] = 0;
+	poll_due[player] = sched_get_ms() + poll_period[player];
+
+	send_message(MSG_POLL, 0, MASTER_PLAYER, player, 0);
+}
+
+// This thread polls the slaves while a game is on. It waits for the
+//	begin messages to go out first, so that polls don't get in their way.
+char poll_thread(pt_t * pt)
+{
+	static unsigned char player;
+
+	PT_BEGIN(pt);
+
+	while (1)
+	{
+		PT_WAIT_UNTIL(pt, (get_game_state() == GAME_STARTED) && !sched_is_running(network_thread));
+		init_poll();
+
+		while (get_game_state() == GAME_STARTED)
+		{
+			PT_WAIT_UNTIL(pt, poll_any_due() || (get_game_state() != GAME_STARTED));
+
+			for (player = 0; player < NUM_PLAYERS; player++)
+			{
+				if (poll_is_due(player))
+				{
+					poll_send(player);
+				}
+			}
+		}
+	}
+
+	PT_END(pt);
+}
+
+// This function notes that we've sent a slave something, which gives it
+//	the chance to answer just like a poll would. It's called whenever a
+//	payload to a slave goes to the radio.
+void poll_note_sent(unsigned char player)
+{
+	unsigned now;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	now = sched_get_ms();
+	poll_prev_contact[player] = poll_contact[player];
+	poll_contact[player] = now;
+	poll_due[player] = now + poll_period[player];
+
+	CRIT_EXIT(ipl);
+}
+
+// This function notes that the radio gave up sending the passed slave
+//	something, so it's off or lost. It's called from the radio interrupt.
+void poll_note_failed(unsigned char player)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	poll_period[player] = POLL_LOST_MS;
+	poll_due[player] = sched_get_ms() + POLL_LOST_MS;
+	poll_answered[player] = 0;
+
+	CRIT_EXIT(ipl);
+}
+
+// This function notes that a message has come in from a slave, and how
+//	long it could have waited there
+void poll_note_heard(unsigned char player)
+{
+	unsigned latency;
+
+	// The waiting room isn't polled
+	if (get_game_state() != GAME_STARTED)
+	{
+		return;
+	}
+
+	poll_answered[player] = 1;
+
+	latency = sched_get_ms() - poll_prev_contact[player];
+	poll_latency[player] = latency;
+	if (latency > poll_max_latency[player])
+	{
+		poll_max_latency[player] = latency;
+	}
+}
+
+// This function returns the uplink latency of the last message from the
+//	passed slave, in ms
+unsigned poll_get_latency(unsigned char player)
+{
+	return poll_latency[player];
+}
+
+// This function returns the worst uplink latency seen from the passed
+//	slave, in ms
+unsigned poll_get_max_latency(unsigned char player)
+{
+	return poll_max_latency[player];
+}
+
+#endif
@@ -0,0 +1,35 @@
+//
+// This is the include file for the master's poller. A slave can only
+//	talk to the master in the ACK to something the master sent it, so
+//	the master polls each slave in the game on its own schedule. A slave
+//	which answered its last poll is polled twice as often, and one which
+//	didn't is polled half as often, between POLL_MIN_MS and POLL_MAX_MS.
+//	Anything else the master sends a slave counts as a poll too. A slave
+//	which we gave up sending something to is only polled every
+//	POLL_LOST_MS, and not at all while the radio is backing off from it,
+//	so that one which is off or lost doesn't hold up the others.
+//
+
+#ifndef SPACETEAM_POLL_H_
+#define SPACETEAM_POLL_H_
+
+#include "spaceteam_pt.h"
+
+// The fastest and slowest a slave is polled, in ms. The longest a
+//	message can wait on a slave is about POLL_MAX_MS.
+#define POLL_MIN_MS				4
+#define POLL_MAX_MS				64
+#define POLL_LOST_MS			500
+
+//
+// Function declarations
+//
+void init_poll(void);
+char poll_thread(pt_t * pt);
+void poll_note_sent(unsigned char player);
+void poll_note_heard(unsigned char player);
+void poll_note_failed(unsigned char player);
+unsigned poll_get_latency(unsigned char player);
+unsigned poll_get_max_latency(unsigned char player);
+
+#endif /* SPACETEAM_POLL_H_ */
@@ -0,0 +1,152 @@
+//
+// This file implements the object pools. A pool is an array of
+//	fixed-size blocks with a free list threaded through their headers,
+//	so allocating pops the head of the list and freeing pushes onto it.
+//	Both take the same handful of cycles no matter how full the pool
+//	is, and both are safe to call from any interrupt.
+//
+
+#include "xc.h"
+#include <stddef.h>
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_event.h"
+#include "spaceteam_pool.h"
+
+// Storage for the pools
+POOL_STORAGE(request_mem, spaceteam_request_t, REQUEST_POOL_SIZE);
+POOL_STORAGE(packet_mem, spaceteam_packet_t, PACKET_POOL_SIZE);
+POOL_STORAGE(event_mem, spaceteam_event_t, EVENT_POOL_SIZE);
+
+// The pools
+spaceteam_pool_t request_pool;
+spaceteam_pool_t packet_pool;
+spaceteam_pool_t event_pool;
+
+// Set up all of the pools
+void init_pools(void)
+{
+	pool_init(&request_pool, request_mem, POOL_BLOCK_SIZE(spaceteam_request_t), REQUEST_POOL_SIZE);
+	pool_init(&packet_pool, packet_mem, POOL_BLOCK_SIZE(spaceteam_packet_t), PACKET_POOL_SIZE);
+	pool_init(&event_pool, event_mem, POOL_BLOCK_SIZE(spaceteam_event_t), EVENT_POOL_SIZE);
+}
+
+// This function sets up a pool over the passed storage
+void pool_init(spaceteam_pool_t * pool, void * mem, unsigned char block_size, unsigned char num_blocks)
+{
+	pool->mem = (unsigned char *)mem;
+	pool->block_size = block_size;
+	pool->num_blocks = num_blocks;
+	pool->high_water = 0;
+	pool->failures = 0;
+
+	pool_reset(pool);
+}
+
+// This function frees every block in a pool at once. It's used when
+//	the game restarts and everything in the pool is stale.
+void pool_reset(spaceteam_pool_t * pool)
+{
+	pool_header_t * block;
+	unsigned char i;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, POOL_CRITICAL_IPL);
+
+	// Chain every block onto the free list in order
+	for (i = 0; i < pool->num_blocks; i++)
+	{
+		block = (pool_header_t *)(pool->mem + (i * pool->block_size));
+		block->index = i;
+		block->next = i + 1;
+	}
+	block->next = POOL_NONE;
+
+	pool->free_head = 0;
+	pool->in_use = 0;
+	pool->used_mask = 0;
+
+	CRIT_EXIT(ipl);
+}
+
+// This function takes a block out of the pool. It returns NULL if the
+//	pool is empty.
+void * pool_alloc(spaceteam_pool_t * pool)
+{
+	pool_header_t * block;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, POOL_CRITICAL_IPL);
+
+	if (pool->free_head == POOL_NONE)
+	{
+		pool->failures++;
+		CRIT_EXIT(ipl);
+		return NULL;
+	}
+
+	// Pop the head of the free list
+	block = (pool_header_t *)(pool->mem + (pool->free_head * pool->block_size));
+	pool->free_head = block->next;
+	pool->used_mask |= (1 << block->index);
+
+	// And keep track of how full we've gotten
+	pool->in_use++;
+	if (pool->in_use > pool->high_water)
+	{
+		pool->high_water = pool->in_use;
+	}
+
+	CRIT_EXIT(ipl);
+
+	return (void *)(block + 1);
+}
+
+// This function puts a block back in the pool. Freeing a block which
+//	isn't handed out does nothing, so a double free can't corrupt
+//	the free list.
+void pool_free(spaceteam_pool_t * pool, void * obj)
+{
+	pool_header_t * block;
+	unsigned ipl;
+
+	if (obj == NULL)
+	{
+		return;
+	}
+
+	block = ((pool_header_t *)obj) - 1;
+
+	CRIT_ENTER(ipl, POOL_CRITICAL_IPL);
+
+	if (pool->used_mask & (1 << block->index))
+	{
+		// Push it onto the head of the free list
+		pool->used_mask &= ~(1 << block->index);
+		block->next = pool->free_head;
+		pool->free_head = block->index;
+		pool->in_use--;
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns the block at the passed index if it's handed
+//	out, or NULL if it's free. It's used to walk everything in a pool.
+void * pool_get(spaceteam_pool_t * pool, unsigned char index)
+{
+	if (pool->used_mask & (1 << index))
+	{
+		return (void *)(((pool_header_t *)(pool->mem + (index * pool->block_size))) + 1);
+	}
+
+	return NULL;
+}
+
+// This function returns the most blocks the pool has ever had handed
+//	out at once, which is how much headroom it really needs
+unsigned char pool_high_water(spaceteam_pool_t * pool)
+{
+	return pool->high_water;
+}
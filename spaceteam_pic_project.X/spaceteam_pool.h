@@ -0,0 +1,80 @@
+//
+// This is the include file for the object pools. Everything which comes
+//	and goes while the game runs (requests we've been given, packets
+//	being sent and received, and queued events) lives in a fixed-size
+//	pool of its own, so that there's one owner for every object and
+//	we can see how close we ever come to running out.
+//
+
+#ifndef SPACETEAM_POOL_H_
+#define SPACETEAM_POOL_H_
+
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_crit.h"
+
+// Index marking the end of a free list
+#define POOL_NONE				0xFF
+
+// The most blocks a pool can have, since there is a bit per block in
+//	the used mask
+#define POOL_MAX_BLOCKS			16
+
+// Priority which the pool code runs at while it touches a free list.
+//	This is the radio interrupt's, so that it can allocate in the middle
+//	of a timer interrupt doing the same.
+#define POOL_CRITICAL_IPL		CRIT_SHARED_IPL
+
+// Number of blocks in each pool. Packets can be nested four deep: a
+//	send from timer 2, preempted by a send from timer 1, preempted by
+//	a received packet which is then forwarded.
+#define REQUEST_POOL_SIZE		MAX_ACTIVE_REQS
+#define PACKET_POOL_SIZE		4
+#define EVENT_POOL_SIZE			4
+
+// Every block starts with a header which holds its index, so that
+//	freeing a block doesn't need to search or divide to find it, and the
+//	next free block while it's on the free list
+typedef struct _pool_header_t
+{
+	unsigned char index;
+	unsigned char next;
+} pool_header_t;
+
+// The size of a block for the passed type, header included. It's
+//	rounded up to an even size so that every block is word aligned.
+#define POOL_BLOCK_SIZE(type)	((sizeof(pool_header_t) + sizeof(type) + 1) & ~1)
+
+// Declare the (word aligned) storage for a pool
+#define POOL_STORAGE(name, type, count)	unsigned name[(POOL_BLOCK_SIZE(type) * (count)) / 2]
+
+// A pool of fixed-size blocks
+typedef struct _spaceteam_pool_t
+{
+	unsigned char * mem;			// Storage for the blocks
+	unsigned char block_size;		// Size of a block, header included
+	unsigned char num_blocks;		// Number of blocks in the pool
+	unsigned char free_head;		// First block on the free list
+	unsigned char in_use;			// Number of blocks handed out
+	unsigned char high_water;		// Most blocks ever handed out at once
+	unsigned char failures;			// Allocations which found the pool empty
+	unsigned used_mask;				// Bit per block which is handed out
+} spaceteam_pool_t;
+
+// The pools
+extern spaceteam_pool_t request_pool;
+extern spaceteam_pool_t packet_pool;
+extern spaceteam_pool_t event_pool;
+
+//
+// Function declarations
+//
+void init_pools(void);
+void pool_init(spaceteam_pool_t * pool, void * mem, unsigned char block_size, unsigned char num_blocks);
+void * pool_alloc(spaceteam_pool_t * pool);
+void pool_free(spaceteam_pool_t * pool, void * obj);
+void * pool_get(spaceteam_pool_t * pool, unsigned char index);
+void pool_reset(spaceteam_pool_t * pool);
+unsigned char pool_high_water(spaceteam_pool_t * pool);
+
+#endif /* SPACETEAM_POOL_H_ */
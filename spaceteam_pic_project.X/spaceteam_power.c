@@ -0,0 +1,213 @@
+//
+// This file implements the power manager. Nothing happens on the boards
+//	except in interrupts, so whenever the main loop is out of work we
+//	stop the CPU until the next one. If the game is running, the timers
+//	still need their clocks, so we Idle. If it isn't, and neither the
+//	display nor the LEDs need refreshing, we Sleep, and the wireless
+//	interrupt or the watchdog (which we use as a wake timer for the
+//	begin button) brings us back.
+//
+// It also keeps track of how long the CPU spends running, idle and
+//	asleep in each phase of the game, so that the current draw can be
+//	estimated.
+//
+
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_clock.h"
+#include "spaceteam_game.h"
+#include "spaceteam_display.h"
+#include "spaceteam_led.h"
+#include "spaceteam_event.h"
+#include "spaceteam_power.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_wireless.h"
+
+// The phase we're in, and what the CPU is doing
+volatile power_phase_t power_phase;
+volatile power_mode_t power_mode;
+
+// Time spent in each mode in each phase, in ms
+unsigned long power_time[NUM_POWER_PHASES][NUM_POWER_MODES];
+
+// Start out awake in the waiting room
+void init_power(void)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < NUM_POWER_PHASES; i++)
+	{
+		for (j = 0; j < NUM_POWER_MODES; j++)
+		{
+			power_time[i][j] = 0;
+		}
+	}
+
+	power_mode = POWER_RUN;
+	power_enter_phase(POWER_PHASE_WAITING);
+}
+
+// This function is called when the game moves into a new phase. It
+//	sets timer 2 to scan the inputs as fast as the phase needs.
+void power_enter_phase(power_phase_t phase)
+{
+	power_phase = phase;
+
+	if (phase == POWER_PHASE_PLAYING)
+	{
+		PR2 = TIMER_2_1KHz;
+	}
+	else
+	{
+		PR2 = TIMER_2_WAITING;
+	}
+}
+
+// This function returns 1 if nothing needs a clock, so that we can
+//	Sleep rather than Idle
+int power_can_sleep(void)
+{
+	if (power_phase == POWER_PHASE_PLAYING)
+	{
+		return 0;
+	}
+
+	if (display_needs_tick())
+	{
+		return 0;
+	}
+
+	if (led_get_lit_count() > POWER_SLEEP_MAX_LEDS)
+	{
+		return 0;
+	}
+
+	// The EEPROM needs waking up after each word of a save, and a save
+	//	which is held back needs the clock to start it
+	if (checkpoint_busy())
+	{
+		return 0;
+	}
+
+	// Timer 2 has to keep running to send any waiting messages, or any
+	//	which are waiting to be sent again
+	if (msg_pending() || wl_module_tx_backing_off())
+	{
+		return 0;
+	}
+
+	// And to put the rate back if the master didn't follow us to it
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		if (wl_module_rate_trying())
+		{
+			return 0;
+		}
+	#endif
+
+	return 1;
+}
+
+// This function is called from the main loop when it has nothing left
+//	to do. It stops the CPU until the next interrupt. Interrupts are
+//	held off from when we check the event queue until we're stopped, so
+//	that an event can't be posted in between and then sit in the queue
+//	while we sleep. An interrupt still wakes us up while they're held
+//	off, and it runs as soon as we let it.
+void power_idle(void)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	if (event_pending())
+	{
+		CRIT_EXIT(ipl);
+		return;
+	}
+
+	// We're out of work, so whatever interrupts run while we're stopped
+	//	can do so at the slow clock unless they ask for more
+	clock_set_idle(1);
+
+	if (power_can_sleep())
+	{
+		power_mode = POWER_SLEEP;
+
+		// Use the watchdog as our wake timer
+		ClrWdt();
+		RCONbits.SWDTEN = 1;
+		Sleep();
+		RCONbits.SWDTEN = 0;
+
+		// If the watchdog woke us, timer 2 was stopped the whole time,
+		//	so have it check the begin button now
+		if (RCONbits.WDTO)
+		{
+			RCONbits.WDTO = 0;
+			power_time[power_phase][POWER_SLEEP] += POWER_WAKE_MS;
+			TIMER_2_INT_FLAG = 1;
+		}
+	}
+	else
+	{
+		power_mode = POWER_IDLE;
+		Idle();
+	}
+
+	power_mode = POWER_RUN;
+
+	CRIT_EXIT(ipl);
+}
+
+// This function is called on every timer 2 tick. It puts the tick in
+//	whichever mode the CPU was in, which over many ticks adds up to how
+//	much of the time it spends in each. Time asleep is counted when the
+//	watchdog wakes us, since timer 2 doesn't run then.
+void power_sample(void)
+{
+	power_time[power_phase][power_mode] += power_get_tick_ms();
+}
+
+// This function returns the length of a timer 2 tick in the phase we're
+//	in, in ms
+unsigned power_get_tick_ms(void)
+{
+	if (power_phase == POWER_PHASE_PLAYING)
+	{
+		return POWER_TICK_MS_PLAYING;
+	}
+
+	return POWER_TICK_MS_WAITING;
+}
+
+// This function returns the time spent in the passed mode in the passed
+//	phase, in ms
+unsigned long power_get_time(power_phase_t phase, power_mode_t mode)
+{
+	return power_time[phase][mode];
+}
+
+// This function returns the percent of the time that the CPU was
+//	running in the passed phase. The current draw is about this much of
+//	the running current, plus the rest split between the idle and
+//	sleep currents by power_get_time.
+unsigned char power_get_duty(power_phase_t phase)
+{
+	unsigned long total = 0;
+	int i;
+
+	for (i = 0; i < NUM_POWER_MODES; i++)
+	{
+		total += power_time[phase][i];
+	}
+
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	return (unsigned char)((power_time[phase][POWER_RUN] * 100) / total);
+}
@@ -0,0 +1,56 @@
+//
+// This is the include file for the power manager. Whenever the main
+//	loop runs out of work, the power manager puts the PIC into Idle, or
+//	into Sleep if nothing needs a clock, until the next interrupt.
+//
+
+#ifndef SPACETEAM_POWER_H_
+#define SPACETEAM_POWER_H_
+
+// What the CPU is doing
+typedef enum _power_mode_t
+{
+	POWER_RUN,
+	POWER_IDLE,
+	POWER_SLEEP,
+	NUM_POWER_MODES
+} power_mode_t;
+
+// Parts of the game which use the power differently
+typedef enum _power_phase_t
+{
+	POWER_PHASE_WAITING,	// In the waiting room or after a game
+	POWER_PHASE_PLAYING,	// In a game
+	NUM_POWER_PHASES
+} power_phase_t;
+
+// Length of a timer 2 tick in each phase, in ms. While we play, the
+//	inputs are scanned at 1KHz. While we wait, the begin button is
+//	the only input, so the tick slows to about 122Hz.
+#define POWER_TICK_MS_WAITING	8
+#define POWER_TICK_MS_PLAYING	1
+
+// How long the watchdog lets us sleep before waking to check the begin
+//	button, in ms. This is set by the WDTPS and FWPSA configuration bits.
+#define POWER_WAKE_MS			16
+
+// The most LEDs which can be lit without needing the scan timer. A
+//	single LED stays lit with the mux left on it.
+#define POWER_SLEEP_MAX_LEDS	1
+
+// Set to 1 to show the percent of the time the CPU was awake while
+//	playing on the game over screen, as a hex number
+#define PROFILE_POWER			0
+
+//
+// Function declarations
+//
+void init_power(void);
+void power_enter_phase(power_phase_t phase);
+void power_idle(void);
+void power_sample(void);
+unsigned power_get_tick_ms(void);
+unsigned char power_get_duty(power_phase_t phase);
+unsigned long power_get_time(power_phase_t phase, power_mode_t mode);
+
+#endif /* SPACETEAM_POWER_H_ */
@@ -0,0 +1,67 @@
+//
+// This is the include file for protothreads. A protothread is a function
+//	which is written as if it blocks, but which returns whenever it has
+//	to wait and picks up where it left off the next time it's called. It
+//	doesn't get a stack of its own, just the line it's waiting on, so a
+//	thread costs a few bytes of RAM instead of a few hundred.
+//
+// Since the function really does return, its locals don't survive a
+//	wait. Anything needed on both sides of one has to be static or kept
+//	in a struct which is passed in. The waits are case labels in a
+//	switch, so a thread can't wait from inside a switch of its own.
+//
+
+#ifndef SPACETEAM_PT_H_
+#define SPACETEAM_PT_H_
+
+// A protothread's state
+typedef struct _pt_t
+{
+	unsigned 	lc;				// The line it's waiting on, or 0 to start at the top
+	unsigned 	wake;			// When a timed wait is up, in scheduler ms
+} pt_t;
+
+// What a thread returns
+#define PT_WAITING				0		// It's waiting on something
+#define PT_YIELDED				1		// It gave up the CPU, but has more to do
+#define PT_EXITED				2		// It's done
+
+// Sets a thread to start at the top the next time it's run
+#define PT_INIT(pt)				do { (pt)->lc = 0; } while (0)
+
+// Goes at the top and bottom of the thread's function
+#define PT_BEGIN(pt)			{ char pt_yielded = 1; (void)pt_yielded; switch ((pt)->lc) { case 0:
+#define PT_END(pt)				} PT_INIT(pt); return PT_EXITED; }
+
+// Waits until cond is true. It's checked every time the thread is run.
+#define PT_WAIT_UNTIL(pt, cond)	\
+	do { (pt)->lc = __LINE__; case __LINE__: if (!(cond)) { return PT_WAITING; } } while (0)
+
+#define PT_WAIT_WHILE(pt, cond)	PT_WAIT_UNTIL((pt), !(cond))
+
+// Gives up the CPU for one pass of the scheduler
+#define PT_YIELD(pt)	\
+	do { pt_yielded = 0; (pt)->lc = __LINE__; case __LINE__: if (pt_yielded == 0) { return PT_YIELDED; } } while (0)
+
+// Waits for the passed number of ms, to within a timer 2 tick
+#define PT_WAIT_MS(pt, ms)	\
+	do { (pt)->wake = sched_get_ms() + (ms); PT_WAIT_UNTIL((pt), sched_ms_passed((pt)->wake)); } while (0)
+
+// Waits until the main loop handles an event of the passed type
+#define PT_WAIT_EVENT(pt, type)	PT_WAIT_UNTIL((pt), sched_event_seen(type))
+
+// Runs a child thread until it's done. The child's pt_t has to outlive
+//	the wait, so it's usually static or in the caller's struct.
+#define PT_WAIT_THREAD(pt, thread)	PT_WAIT_WHILE((pt), (thread) < PT_EXITED)
+
+// Starts a child thread from the top and waits for it to finish
+#define PT_SPAWN(pt, child, thread)	\
+	do { PT_INIT(child); PT_WAIT_THREAD((pt), (thread)); } while (0)
+
+// Stops the thread, and starts it from the top if it's run again
+#define PT_EXIT(pt)				do { PT_INIT(pt); return PT_EXITED; } while (0)
+
+// Runs a thread to completion right here, for callers which can block
+#define PT_RUN_BLOCKING(thread)	do { } while ((thread) < PT_EXITED)
+
+#endif /* SPACETEAM_PT_H_ */
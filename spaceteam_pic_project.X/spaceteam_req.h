@@ -49,10 +49,13 @@ const char  req_ship[]			= "YOUR SHIP";
 const char req_for[]			= "for";
 const char req_to[]				= "to";
 
+// The tables of pointers are const too, so that they live in program
+//	space along with the strings instead of in data memory
+
 // Only need these for the first three
-const char * req_preps[] = {req_to, req_for, req_to};
+const char * const req_preps[] = {req_to, req_for, req_to};
 
-const char * req_verbs[] =
+const char * const req_verbs[] =
 {
 	req_set, 		req_scan, 		req_crank, 		req_cycle, 		req_deactivate, 
 	req_engage, 	req_vent, 		req_randomize, 	req_check, 
@@ -60,7 +63,7 @@ const char * req_verbs[] =
 	req_flood, 		req_align
 };
 
-const char * req_names[] =
+const char * const req_names[] =
 {
 	req_thrust, 	req_badge,		req_distiller,  req_vaporizer, 	req_network, 
 	req_perc,		req_combustor, 	req_sequencer,	req_impeller, 
@@ -4,17 +4,59 @@
 //	but hopefully simplified some. 
 
 #include "xc.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_rfid.h"
 #include "spaceteam_spi.h"
+#include "spaceteam_general.h"
+#include "spaceteam_script.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_sched.h"
 
 #define FCY 8000000UL
 #include <libpic30.h>
 
-// This function will initialize the RFID module
+// How the init scripts talk to the RC522
+const script_bus_t rfid_bus =
+	{
+		rfid_write_regs,
+		rfid_read_regs
+	};
+
+// The RC522's settings, which are checked once they're written. This is
+//	pretty much copied from
+//	http://www.onemansanthology.com//arduino/rfid-arduino-micro-via-spi.pde
+const script_op_t rfid_config_script[] =
+	{
+		{ RFID_TMODE_REG, 		0x8D, 	0xFF, 	0 },	// Timer starts when a transmit ends
+		{ RFID_TPRESCALER_REG, 	0x3E, 	0xFF, 	0 },
+		{ RFID_TRELOADL_REG, 	30, 	0xFF, 	0 },
+		{ RFID_TRELOADH_REG, 	0, 		0xFF, 	0 },
+		{ RFID_TXAUTO_REG, 		0x40, 	0xFF, 	0 },	// 100% ASK
+		{ RFID_MODE_REG, 		0x3D, 	0xFF, 	0 }		// CRC preset 0x6363
+	};
+
+// This function will initialize the RFID module. It waits on the module
+//	after the reset, so the startup sequencer runs the steps itself
+//	rather than calling this.
 void init_rfid(void)
 {
-	unsigned char temp_val;
+	unsigned wait = RFID_RESET_TIMEOUT_MS;
+
+	rfid_soft_reset();
+
+	// Wait for the module to come back up, rather than a flat second
+	while ( !rfid_is_ready() && (wait != 0) )
+	{
+		clock_delay_ms(1);
+		wait--;
+	}
+
+	rfid_configure();
+}
 
+// This function soft resets the RC522
+int rfid_soft_reset(void)
+{
 	// Make sure that SPI is initialized
 	if (!is_spi_initialized())
 	{
@@ -24,41 +66,42 @@ void init_rfid(void)
 	// Set our CS and the wireless CS high
 	RFID_CS = 1;
 
-	__delay_us(1);
-
+	clock_delay_us(1);
 
 	// Perform a soft reset of the RFID MODULE
 	rfid_write_reg(RFID_COMMAND_REG, RFID_SOFTRESET);
 
-	// Give it a second to init. Not sure about this
-	__delay_ms(1000);
+	return SUCCESS;
+}
 
-	// Need to set up the timers aparently, this code is pretty much copied
-	// from http://www.onemansanthology.com//arduino/rfid-arduino-micro-via-spi.pde
-	rfid_write_reg(RFID_TMODE_REG, 0x8D);
-	rfid_write_reg(RFID_TPRESCALER_REG, 0x3E);
-	rfid_write_reg(RFID_TRELOADL_REG, 30);
-	rfid_write_reg(RFID_TRELOADH_REG, 0);
+// This function returns 1 once the RC522 is done with a soft reset. It
+//	holds the PowerDown bit until its oscillator is running again.
+int rfid_is_ready(void)
+{
+	return ((rfid_read_reg(RFID_COMMAND_REG) & RFID_POWER_DOWN) == 0);
+}
 
-	// Other TX stuff
-	rfid_write_reg(RFID_TXAUTO_REG, 0x40);
-	rfid_write_reg(RFID_MODE_REG, 0x3D);
+// This function sets up the RC522 once it's out of reset. It returns
+//	FAILURE if the module didn't take the settings.
+int rfid_configure(void)
+{
+	int status;
 
-	// Turn on the antenna, if it is not already on. 
-	temp_val = rfid_read_reg(RFID_TXCONTROL_REG);
-	if (!(temp_val & 0x03))
-	{
-		temp_val = (temp_val | 0x03);
-		rfid_write_reg(RFID_TXCONTROL_REG, temp_val);
+	status = script_run(&rfid_bus, rfid_config_script, SCRIPT_LEN(rfid_config_script));
 
-	}
+	// Turn on the antenna, if it is not already on
+	rfid_set_bits(RFID_TXCONTROL_REG, 0x03);
 
+	return status;
 }
 
 // This function writes a command to the RC522 module
 void rfid_write_reg(unsigned char addr, unsigned char data)
 {
+	unsigned ipl;
+
 	// Need to set the chip select low
+	ipl = spi_begin();
 	RFID_CS = 0;
 
 	// Write the address and data
@@ -67,17 +110,72 @@ void rfid_write_reg(unsigned char addr, unsigned char data)
 
 	// Now pull the chip select back high
 	RFID_CS = 1;
+	spi_end(ipl);
 
 	// Give it a few clocks to propogate... the chip selects don't always update instantly.
-	__delay_us(1);
+	clock_delay_us(1);
+}
+
+// This function writes a number of bytes to one register in one transfer.
+//	The RC522 doesn't step through the registers, so this is only any
+//	use for the FIFO.
+void rfid_write_regs(unsigned char addr, const unsigned char * data, unsigned char len)
+{
+	unsigned char i;
+	unsigned ipl;
+
+	ipl = spi_begin();
+	RFID_CS = 0;
+
+	spi_write((addr << 1) & (~RFID_READ_MASK));
+	for (i = 0; i < len; i++)
+	{
+		spi_write(data[i]);
+	}
+
+	RFID_CS = 1;
+	spi_end(ipl);
+
+	clock_delay_us(1);
+}
+
+// This function reads a list of registers in one transfer. Each byte
+//	sent is the address of the next register to read, and the byte that
+//	comes back with it is the value of the one before.
+void rfid_read_regs(const unsigned char * addrs, unsigned char * data, unsigned char len)
+{
+	unsigned char i;
+	unsigned ipl;
+
+	if (len == 0)
+	{
+		return;
+	}
+
+	ipl = spi_begin();
+	RFID_CS = 0;
+
+	spi_write((addrs[0] << 1) | RFID_READ_MASK);
+	for (i = 1; i < len; i++)
+	{
+		data[i - 1] = spi_write((addrs[i] << 1) | RFID_READ_MASK);
+	}
+	data[len - 1] = spi_write(0);
+
+	RFID_CS = 1;
+	spi_end(ipl);
+
+	clock_delay_us(1);
 }
 
 // This function reads a register from the RC522 module
 unsigned char rfid_read_reg(unsigned char addr)
 {
 	unsigned char ret_val;
+	unsigned ipl;
 
 	// Need to set the chip select low
+	ipl = spi_begin();
 	RFID_CS = 0;
 
 	// Issue the read command
@@ -87,6 +185,7 @@ unsigned char rfid_read_reg(unsigned char addr)
 
 	// Pull the chip select back high
 	RFID_CS = 1;
+	spi_end(ipl);
 
 	return ret_val;
 }
@@ -115,17 +214,31 @@ void rfid_clear_bits(unsigned char reg, unsigned char mask)
 	rfid_write_reg(reg, (temp_val & (~mask)));
 }
 
-// This function performs the transcieve transaction with the RFID card. It takes 
-//	a command to perform, a buffer of input data, a length of the input data buffer, 
-//	and output data buffer of size MAX_LEN and an output pointer to the length of 
-//	data in the buffer.
-rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len, unsigned char * dataout, unsigned char * dataout_len)
+// This function sets up a transcieve with the RFID card. It takes a
+//	buffer of input data, a length of the input data buffer and an output
+//	data buffer of size RFID_MAX_LEN.
+void rfid_xfer_init(rfid_xfer_t * xfer, unsigned char * datain, unsigned char datain_len, unsigned char * dataout)
 {
-	unsigned char irq_reg = 0;
-	unsigned char num_bytes = 0;
-	unsigned char num_bits = 0;
-	int i;
-	rfid_status_t status = RFID_ERROR;
+	PT_INIT(&xfer->pt);
+	xfer->datain = datain;
+	xfer->datain_len = datain_len;
+	xfer->dataout = dataout;
+	xfer->dataout_len = 0;
+	xfer->irq_reg = 0;
+	xfer->status = RFID_ERROR;
+}
+
+// This thread performs the transcieve transaction with the RFID card.
+//	Rather than spinning on the IRQ register while the card answers, it
+//	checks it once every time it's run. When it exits, the status and
+//	the answer are in the xfer.
+char rfid_transcieve_thread(rfid_xfer_t * xfer)
+{
+	unsigned char num_bytes;
+	unsigned char num_bits;
+	unsigned char i;
+
+	PT_BEGIN(&xfer->pt);
 
 	// Want to clear the interrupt bits
 	rfid_clear_bits(RFID_IRQ_REG, 0x80);
@@ -141,10 +254,7 @@ rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len,
 	//
 
 	// Write the input data to the FIFO
-	for (i = 0; i < datain_len; i++)
-	{
-		rfid_write_reg(RFID_FIFO_DATA_REG, datain[i]);
-	}
+	rfid_write_regs(RFID_FIFO_DATA_REG, xfer->datain, xfer->datain_len);
 
 	// Tell the controller to do the transcieve
 	rfid_write_reg(RFID_COMMAND_REG, RFID_TRANSCIEVE);
@@ -153,26 +263,21 @@ rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len,
 	rfid_set_bits(RFID_BITFRAMING_REG, 0x80);
 
 	//
-	// Now, wait until the transmission is done, or we have a timeout. 
-	//	the timeout is a simple counter of reads on the SPI connection
+	// Now, wait until the transmission is done, or we have a timeout
 	//
-	i = RFID_TIMEOUT_CYCLES;
-	while ( ((irq_reg & IRQ_WAIT_MASK) == 0) && (i > 0))
-	{
-		irq_reg = rfid_read_reg(RFID_IRQ_REG);
-		i--;
-	}
+	xfer->pt.wake = sched_get_ms() + RFID_TIMEOUT_MS;
+	PT_WAIT_UNTIL(&xfer->pt, ((xfer->irq_reg = rfid_read_reg(RFID_IRQ_REG)) & IRQ_WAIT_MASK) ||
+							 sched_ms_passed(xfer->pt.wake));
 
 	// Want to clear the StartSend bit
 	rfid_clear_bits(RFID_BITFRAMING_REG, 0x80);
 
-
 	//
 	// Read back the value, if we didn't have a timeout
 	//
-	if (i != 0)
+	if (xfer->irq_reg & IRQ_WAIT_MASK)
 	{
-		status = RFID_SUCCESS;
+		xfer->status = RFID_SUCCESS;
 
 		// Get the number of bytes in the FIFO
 		num_bytes = rfid_read_reg(RFID_FIFO_LEVEL_REG);
@@ -191,25 +296,41 @@ rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len,
 			num_bits += 8*(num_bytes -1);
 		}
 
-		// Write the number of bits to the output parameter
-		*dataout_len = num_bits;
+		// Write the number of bits to the output
+		xfer->dataout_len = num_bits;
 
 		// Finally, read the data out of the fifo data register
 		//	and write it into the output buffer
 		for (i = 0; i < num_bytes; i++)
 		{
-			dataout[i] = rfid_read_reg(RFID_FIFO_DATA_REG);
+			xfer->dataout[i] = rfid_read_reg(RFID_FIFO_DATA_REG);
 		}
 	}
 	// If we did have a timeout, note it
 	else
 	{
-		status = RFID_TIMEOUT;
-		*dataout_len = 0;
+		xfer->status = RFID_TIMEOUT;
+		xfer->dataout_len = 0;
 	}
 
-	return status;
+	PT_END(&xfer->pt);
+}
+
+// This function performs the transcieve transaction with the RFID card,
+//	and waits for it. It takes the same buffers as rfid_xfer_init, and an
+//	output pointer to the length of data in the buffer. The timeout is
+//	kept by timer 2, so it can't be called from an interrupt which holds
+//	timer 2 off.
+rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len, unsigned char * dataout, unsigned char * dataout_len)
+{
+	rfid_xfer_t xfer;
+
+	rfid_xfer_init(&xfer, datain, datain_len, dataout);
+	PT_RUN_BLOCKING(rfid_transcieve_thread(&xfer));
+
+	*dataout_len = xfer.dataout_len;
 
+	return xfer.status;
 }
 
 // This function sends a request to an RFID card, and will 
@@ -9,6 +9,7 @@
 #define	SPACETEAM_RFID_H
 
 #include "xc.h"
+#include "spaceteam_pt.h"
 
 #ifdef	__cplusplus
 extern "C" {
@@ -44,6 +45,13 @@ extern "C" {
 // Other defines
 #define RFID_CLEAR_FIFO			0x80
 
+// The PowerDown bit in the command register, which stays set after a
+//	soft reset until the module is running again
+#define RFID_POWER_DOWN			0x10
+
+// The longest we wait for the module to come out of a soft reset
+#define RFID_RESET_TIMEOUT_MS	100
+
 // Mask for waiting for a transmission to be done
 #define IRQ_WAIT_MASK			0x30
 
@@ -53,7 +61,7 @@ extern "C" {
 #define RFID_IDREQ				0x93
 
 // Timeout for the RFID request
-#define RFID_TIMEOUT_CYCLES		2000
+#define RFID_TIMEOUT_MS			25
 
 // Maximum size of the readback buffer for RFID
 #define RFID_MAX_LEN 			16
@@ -70,10 +78,33 @@ typedef enum _rfid_status_t
 	RFID_ERROR
 } rfid_status_t;
 
+// A transcieve with a card, which is run as a thread so that whoever
+//	started it can get on with other things while the card answers
+typedef struct _rfid_xfer_t
+{
+	pt_t 			pt;
+	unsigned char * datain;			// What to send
+	unsigned char 	datain_len;
+	unsigned char * dataout;		// Where the answer goes, RFID_MAX_LEN bytes
+	unsigned char 	dataout_len;	// The length of the answer, in bits
+	unsigned char 	irq_reg;		// The last IRQ register value read
+	rfid_status_t 	status;
+} rfid_xfer_t;
+
 // Function declarations
 void init_rfid(void);
+int rfid_soft_reset(void);
+int rfid_is_ready(void);
+int rfid_configure(void);
 void rfid_write_reg(unsigned char addr, unsigned char data);
 unsigned char rfid_read_reg(unsigned char addr);
+void rfid_write_regs(unsigned char addr, const unsigned char * data, unsigned char len);
+void rfid_read_regs(const unsigned char * addrs, unsigned char * data, unsigned char len);
+void rfid_set_bits(unsigned char reg, unsigned char mask);
+void rfid_clear_bits(unsigned char reg, unsigned char mask);
+void rfid_xfer_init(rfid_xfer_t * xfer, unsigned char * datain, unsigned char datain_len, unsigned char * dataout);
+char rfid_transcieve_thread(rfid_xfer_t * xfer);
+rfid_status_t rfid_transcieve(unsigned char * datain, unsigned char datain_len, unsigned char * dataout, unsigned char * dataout_len);
 rfid_status_t rfid_request_type(unsigned char *data);
 rfid_status_t rfid_request_id(unsigned char *data);
 rfid_status_t rfid_get_token(unsigned char *data);
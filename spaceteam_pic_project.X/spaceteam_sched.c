@@ -0,0 +1,134 @@
+//
+// This file implements the scheduler. Threads are started into a small
+//	table and run in order until they exit. The clock is a count of ms
+//	which timer 2 adds to every tick, and the events are a bit per event
+//	type which the main loop has handled since the last pass.
+//
+
+#include "xc.h"
+#include <stddef.h>
+#include "spaceteam_general.h"
+#include "spaceteam_sched.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// The threads
+sched_thread_t sched_threads[SCHED_MAX_THREADS];
+
+// The time in ms, which wraps around about once a minute
+volatile unsigned sched_ms;
+
+// The events which were handled before this pass, and the ones which
+//	have been handled during it and will be seen on the next one
+unsigned sched_events_seen;
+unsigned sched_events_new;
+
+// This function empties the thread table
+void init_sched(void)
+{
+	int i;
+
+	for (i = 0; i < SCHED_MAX_THREADS; i++)
+	{
+		sched_threads[i].fn = NULL;
+	}
+
+	sched_ms = 0;
+	sched_events_seen = 0;
+	sched_events_new = 0;
+}
+
+// This function starts a thread from the top. It's only called from the
+//	main loop. It returns FAILURE if the table is full.
+int sched_start(sched_fn_t fn)
+{
+	int i;
+
+	for (i = 0; i < SCHED_MAX_THREADS; i++)
+	{
+		if (sched_threads[i].fn == NULL)
+		{
+			sched_threads[i].fn = fn;
+			PT_INIT(&sched_threads[i].pt);
+			return SUCCESS;
+		}
+	}
+
+	return FAILURE;
+}
+
+// This function returns 1 if the thread is still running
+int sched_is_running(sched_fn_t fn)
+{
+	int i;
+
+	for (i = 0; i < SCHED_MAX_THREADS; i++)
+	{
+		if (sched_threads[i].fn == fn)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// This function runs each thread once, and frees the slots of the ones
+//	which are done. The events handled since the last pass are seen by
+//	every thread in this pass, and then forgotten.
+void sched_run(void)
+{
+	int i;
+
+	sched_events_seen = sched_events_new;
+	sched_events_new = 0;
+
+	for (i = 0; i < SCHED_MAX_THREADS; i++)
+	{
+		if (sched_threads[i].fn == NULL)
+		{
+			continue;
+		}
+
+		if (sched_threads[i].fn(&sched_threads[i].pt) == PT_EXITED)
+		{
+			sched_threads[i].fn = NULL;
+		}
+	}
+}
+
+// This function moves the clock on. It's called from the timer 2
+//	interrupt with the length of its tick. Timer 2 doesn't run while
+//	we sleep, so waits can run long then, but never short.
+void sched_tick(unsigned ms)
+{
+	sched_ms += ms;
+}
+
+// This function returns the time in ms
+unsigned sched_get_ms(void)
+{
+	return sched_ms;
+}
+
+// This function returns 1 if the passed time has come. It works across
+//	the clock wrapping, for waits of up to half a wrap.
+int sched_ms_passed(unsigned when)
+{
+	return ((int)(sched_ms - when) >= 0);
+}
+
+// This function notes that the main loop has handled an event, so that
+//	the threads waiting on it see it on their next pass
+void sched_post_event(spaceteam_evt_t type)
+{
+	sched_events_new |= (1 << type);
+}
+
+// This function returns 1 if an event of the passed type was handled
+//	just before this pass
+int sched_event_seen(spaceteam_evt_t type)
+{
+	return ((sched_events_seen & (1 << type)) != 0);
+}
@@ -0,0 +1,41 @@
+//
+// This is the include file for the scheduler. It runs the protothreads
+//	from the main loop, one pass over all of them every time round, and
+//	keeps the clock and events which they wait on. A thread waiting on
+//	something doesn't keep the CPU awake, since everything it can wait
+//	on comes from an interrupt which wakes the main loop anyway.
+//
+
+#ifndef SPACETEAM_SCHED_H_
+#define SPACETEAM_SCHED_H_
+
+#include "spaceteam_pt.h"
+#include "spaceteam_event.h"
+
+// A thread's function. It gets its own pt_t each time it's run.
+typedef char (*sched_fn_t)(pt_t * pt);
+
+// A slot in the thread table
+typedef struct _sched_thread_t
+{
+	sched_fn_t 	fn;				// The thread, or NULL if the slot is free
+	pt_t 		pt;				// Where it's at
+} sched_thread_t;
+
+// The most threads which can be running at once
+#define SCHED_MAX_THREADS		4
+
+//
+// Function declarations
+//
+void init_sched(void);
+int sched_start(sched_fn_t fn);
+int sched_is_running(sched_fn_t fn);
+void sched_run(void);
+void sched_tick(unsigned ms);
+unsigned sched_get_ms(void);
+int sched_ms_passed(unsigned when);
+void sched_post_event(spaceteam_evt_t type);
+int sched_event_seen(spaceteam_evt_t type);
+
+#endif /* SPACETEAM_SCHED_H_ */
@@ -0,0 +1,100 @@
+//
+// This file implements the register init script engine. Runs of writes to
+//	the same register are sent in one transfer, and once the whole script
+//	is written, the registers which have verify bits are read back and
+//	checked.
+//
+
+#include "xc.h"
+#include <stddef.h>
+#include "spaceteam_general.h"
+#include "spaceteam_clock.h"
+#include "spaceteam_script.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// This function writes out a script, and then checks it. It returns
+//	FAILURE if any register didn't read back what was written.
+int script_run(const script_bus_t * bus, const script_op_t * script, unsigned char len)
+{
+	unsigned char burst[SCRIPT_MAX_BURST];
+	unsigned char count;
+	unsigned char i = 0;
+
+	while (i < len)
+	{
+		// Gather up the writes to this register, stopping at any write
+		//	which has to be waited on
+		count = 0;
+		do
+		{
+			burst[count] = script[i + count].val;
+			count++;
+		} while ( ((i + count) < len) && (count < SCRIPT_MAX_BURST) &&
+				  (script[i + count].reg == script[i].reg) && (script[i + count - 1].delay == 0) );
+
+		bus->write(script[i].reg, burst, count);
+
+		if (script[i + count - 1].delay != 0)
+		{
+			clock_delay_us(script[i + count - 1].delay);
+		}
+
+		i += count;
+	}
+
+	return script_verify(bus, script, len);
+}
+
+// This function reads back the registers in a script which have verify
+//	bits, a handful at a time, and returns FAILURE if any of them don't
+//	match. A register written more than once in a row is a FIFO or the
+//	like, so only single writes should be given verify bits.
+int script_verify(const script_bus_t * bus, const script_op_t * script, unsigned char len)
+{
+	unsigned char regs[SCRIPT_MAX_VERIFY];
+	unsigned char vals[SCRIPT_MAX_VERIFY];
+	unsigned char ops[SCRIPT_MAX_VERIFY];
+	unsigned char count;
+	unsigned char i = 0;
+	unsigned char j;
+
+	if (bus->read == NULL)
+	{
+		return SUCCESS;
+	}
+
+	while (i < len)
+	{
+		// Gather up the next few registers to check
+		count = 0;
+		while ( (i < len) && (count < SCRIPT_MAX_VERIFY) )
+		{
+			if (script[i].verify != 0)
+			{
+				regs[count] = script[i].reg;
+				ops[count] = i;
+				count++;
+			}
+			i++;
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		bus->read(regs, vals, count);
+
+		for (j = 0; j < count; j++)
+		{
+			if ( (vals[j] ^ script[ops[j]].val) & script[ops[j]].verify )
+			{
+				return FAILURE;
+			}
+		}
+	}
+
+	return SUCCESS;
+}
@@ -0,0 +1,46 @@
+//
+// This is the include file for the register init scripts. Rather than
+//	each driver writing its registers one call at a time, it keeps a
+//	const table of register writes, and one engine writes them out and
+//	reads back the ones that need checking. A chip which didn't take its
+//	settings is caught right when it's set up.
+//
+
+#ifndef SPACETEAM_SCRIPT_H_
+#define SPACETEAM_SCRIPT_H_
+
+// One register write in a script
+typedef struct _script_op_t
+{
+	unsigned char reg;			// The register to write
+	unsigned char val;			// The value to write to it
+	unsigned char verify;		// Bits which have to read back the same, or 0 to not check
+	unsigned char delay;		// Time to wait after the write, in us
+} script_op_t;
+
+// How to talk to a chip. Neither the radio nor the RFID reader steps
+//	through registers on a multi-byte write; every byte goes to the
+//	one register, so a burst is only ever for a single register.
+typedef struct _script_bus_t
+{
+	// Writes a number of bytes to one register in one transfer
+	void (*write)(unsigned char reg, const unsigned char * vals, unsigned char len);
+	// Reads a list of registers, or NULL if the chip can't be read
+	void (*read)(const unsigned char * regs, unsigned char * vals, unsigned char len);
+} script_bus_t;
+
+// The longest run of writes to one register which is sent in one transfer
+#define SCRIPT_MAX_BURST		8
+// The most registers read back in one go
+#define SCRIPT_MAX_VERIFY		8
+
+// Gets the number of ops in a script table
+#define SCRIPT_LEN(script)		(sizeof(script) / sizeof(script_op_t))
+
+//
+// Function declarations
+//
+int script_run(const script_bus_t * bus, const script_op_t * script, unsigned char len);
+int script_verify(const script_bus_t * bus, const script_op_t * script, unsigned char len);
+
+#endif /* SPACETEAM_SCRIPT_H_ */
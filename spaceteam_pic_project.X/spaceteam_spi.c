@@ -6,6 +6,8 @@
 
  #include "xc.h"
  #include "spaceteam_spi.h"
+ #include "spaceteam_clock.h"
+ #include "spaceteam_crit.h"
  #include <stddef.h>
 
  static char init_done = 0;
@@ -26,16 +28,13 @@
 
  }
 
- // This function can be used to write a byte to the SPI bus
-unsigned char _spi_write(unsigned char data, unsigned char turn_off_int)
+ // This function can be used to write a byte to the SPI bus. It has to
+ //   be called between spi_begin and spi_end, so that nothing else can
+ //   use the bus in the middle of our frame.
+ unsigned char spi_write(unsigned char data)
  {
     unsigned char ret_val;
 
-    if (turn_off_int != 0)
-    {
-        __builtin_disi(DISI_MAX_VAL);
-    }
-
     // Do a dummy read to clear the BF flag
     //  if it's set
     ret_val = SSP1BUF;
@@ -48,18 +47,26 @@ unsigned char _spi_write(unsigned char data, unsigned char turn_off_int)
 
     ret_val = SSP1BUF;
 
-    if (turn_off_int != 0)
-    {
-        __builtin_disi(0x0000);
-    }
-
     return ret_val;
 
  }
 
- unsigned char spi_write(unsigned char data)
+ // This function starts a chip select frame. Everything else which uses
+ //   the SPI is held off until the matching spi_end, so the frame should
+ //   be kept short, and any waiting done after it's over.
+ unsigned spi_begin(void)
+ {
+    unsigned ipl;
+
+    CRIT_ENTER(ipl, CRIT_SPI_IPL);
+
+    return ipl;
+ }
+
+ // This function ends a chip select frame
+ void spi_end(unsigned ipl)
  {
-    return _spi_write(data, 1);
+    CRIT_EXIT(ipl);
  }
 
  // This function returns 1 if SPI has been initialized, else 0
@@ -70,14 +77,14 @@ unsigned char _spi_write(unsigned char data, unsigned char turn_off_int)
 
  // This function performs SPI writes on a bufffer of input data and
  // reads the results to a buffer of output data, unless the output data
- // pointer is NULL
- void spi_write_multiple(unsigned char * datain, unsigned char * dataout, unsigned char length)
+ // pointer is NULL. Like spi_write, it has to be called inside a frame.
+ void spi_write_multiple(const unsigned char * datain, unsigned char * dataout, unsigned char length)
  {
     int i;
     unsigned char temp_val;
 
-    // Turn off interrupts
-    __builtin_disi(DISI_MAX_VAL);
+    // Run at full speed for the burst
+    clock_boost();
 
     // Do a SPI write for all of the data in the buffer
     for( i = 0; i < length; i++)
@@ -85,13 +92,13 @@ unsigned char _spi_write(unsigned char data, unsigned char turn_off_int)
         // Do the SPI write, if we have data to write
         if (datain != NULL)
         {
-            temp_val = _spi_write(datain[i], 0);
+            temp_val = spi_write(datain[i]);
         }
         // Or, we may be trying to do a read, in which case
         //  just send zeroes
         else
         {
-            temp_val = _spi_write(0, 0);
+            temp_val = spi_write(0);
         }
         
         // And write the return value to the output buffer if
@@ -102,8 +109,7 @@ unsigned char _spi_write(unsigned char data, unsigned char turn_off_int)
         }
     }
 
-    // Turn interrupts back on
-    __builtin_disi(0);
+    clock_release();
  }
 
 
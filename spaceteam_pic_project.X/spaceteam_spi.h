@@ -12,13 +12,13 @@
 extern "C" {
 #endif
 
-#define DISI_MAX_VAL 0x3FFF
-
 // Function declarations
 void init_spi(void);
 unsigned char spi_write(unsigned char data);
+unsigned spi_begin(void);
+void spi_end(unsigned ipl);
 int is_spi_initialized(void);
-void spi_write_multiple(unsigned char * datain, unsigned char * dataout, unsigned char length);
+void spi_write_multiple(const unsigned char * datain, unsigned char * dataout, unsigned char length);
 
 #ifdef	__cplusplus
 }
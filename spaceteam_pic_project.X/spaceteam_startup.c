@@ -0,0 +1,162 @@
+//
+// This file implements the startup sequencer. Each device has a table of
+//	steps. The sequencer goes round the devices, and whenever one is
+//	done with its last step (its settle time is up and its ready check
+//	passes) it starts the next one. Times come from timer 1, which is
+//	started before anything else and isn't used by the game until the
+//	first request goes out.
+//
+
+#include "xc.h"
+#include <stddef.h>
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_display.h"
+#include "spaceteam_wireless.h"
+#include "spaceteam_rfid.h"
+#include "spaceteam_startup.h"
+
+#define FCY 8000000UL
+#include <libpic30.h>
+
+// Bringing up the display. Its busy flag can't be read through the
+//	shift register, so it only has times.
+const startup_step_t display_steps[] =
+	{
+		{ display_reset_start, 	NULL, 	STARTUP_TICKS(DISPLAY_RESET_START_US) },
+		{ display_reset_wake, 	NULL, 	STARTUP_TICKS(DISPLAY_RESET_WAKE_US) },
+		{ display_reset_config, NULL, 	STARTUP_TICKS(DISPLAY_CLEAR_US) }
+	};
+
+// Bringing up the radio. It's polled until it's out of its power on
+//	reset, and then has to be waited on while it goes to standby.
+const startup_step_t wireless_steps[] =
+	{
+		{ wl_module_prepare, 	wl_module_is_alive, 	0 },
+		{ wl_module_configure, 	NULL, 					STARTUP_TICKS(WL_STANDBY_US) },
+		{ wl_module_start, 		NULL, 					0 }
+	};
+
+#if (STARTUP_RFID == 1)
+// Bringing up the RFID reader, which is polled until it's out of reset
+const startup_step_t rfid_steps[] =
+	{
+		{ rfid_soft_reset, 		rfid_is_ready, 	0 },
+		{ rfid_configure, 		NULL, 			0 }
+	};
+#endif
+
+// The steps for each device, and how many there are
+const startup_step_t * const startup_steps[NUM_STARTUP_DEVICES] =
+	{
+		display_steps,
+		wireless_steps,
+#if (STARTUP_RFID == 1)
+		rfid_steps,
+#endif
+	};
+
+const unsigned char startup_num_steps[NUM_STARTUP_DEVICES] =
+	{
+		sizeof(display_steps) / sizeof(startup_step_t),
+		sizeof(wireless_steps) / sizeof(startup_step_t),
+#if (STARTUP_RFID == 1)
+		sizeof(rfid_steps) / sizeof(startup_step_t),
+#endif
+	};
+
+// The devices which didn't come up in time or didn't take their
+//	settings, a bit per device
+unsigned char startup_failed;
+
+// This function brings up all of the devices, and returns once they're
+//	all ready for use. Timer 1 has to be running.
+void run_startup(void)
+{
+	unsigned char step[NUM_STARTUP_DEVICES];
+	unsigned started_at[NUM_STARTUP_DEVICES];
+	unsigned char started[NUM_STARTUP_DEVICES];
+	unsigned char left = NUM_STARTUP_DEVICES;
+	const startup_step_t * curr;
+	unsigned elapsed;
+	int status;
+	int i;
+
+	startup_failed = 0;
+
+	for (i = 0; i < NUM_STARTUP_DEVICES; i++)
+	{
+		step[i] = 0;
+		started[i] = 0;
+	}
+
+	while (left != 0)
+	{
+		for (i = 0; i < NUM_STARTUP_DEVICES; i++)
+		{
+			// Skip the devices which are done
+			if (step[i] == startup_num_steps[i])
+			{
+				continue;
+			}
+
+			curr = &startup_steps[i][step[i]];
+
+			// Start the step if we haven't yet. If the device didn't
+			//	take it, there's no point in going on with it.
+			if (!started[i])
+			{
+				status = SUCCESS;
+				if (curr->start != NULL)
+				{
+					status = curr->start();
+				}
+				started_at[i] = TMR1;
+				started[i] = 1;
+
+				if (status != SUCCESS)
+				{
+					startup_failed |= (1 << i);
+					step[i] = startup_num_steps[i];
+					left--;
+					continue;
+				}
+			}
+
+			elapsed = TMR1 - started_at[i];
+
+			// Move on once it's settled and ready. If it never gets
+			//	ready, give up on it rather than hang the board.
+			if ( (elapsed >= curr->settle) && ( (curr->ready == NULL) || curr->ready() ) )
+			{
+				step[i]++;
+				started[i] = 0;
+			}
+			else if (elapsed >= STARTUP_TIMEOUT)
+			{
+				startup_failed |= (1 << i);
+				step[i] = startup_num_steps[i];
+			}
+
+			if (step[i] == startup_num_steps[i])
+			{
+				left--;
+			}
+		}
+	}
+}
+
+// This function returns the devices which didn't come up, with a bit
+//	per startup_device_t
+unsigned char startup_get_failed(void)
+{
+	return startup_failed;
+}
+
+// This function returns how long it's been since timer 1 was started at
+//	the beginning of boot, in ms. It's only good for the first couple of
+//	seconds, before timer 1 wraps around.
+unsigned startup_get_ms(void)
+{
+	return (unsigned)(((unsigned long)TMR1 * TIMER_1_TICK_US) / 1000);
+}
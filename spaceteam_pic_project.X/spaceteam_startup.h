@@ -0,0 +1,55 @@
+//
+// This is the include file for the startup sequencer. Each peripheral
+//	comes up in a few steps, with some time or a ready check between
+//	them. The sequencer brings them all up at once, starting a step on
+//	one device while the others are still busy with theirs, so that
+//	boot takes as long as the slowest device instead of all of them.
+//
+
+#ifndef SPACETEAM_STARTUP_H_
+#define SPACETEAM_STARTUP_H_
+
+#include "spaceteam_game.h"
+
+// One step in bringing up a device
+typedef struct _startup_step_t
+{
+	int 		(*start)(void);		// Starts the step, or NULL to only wait. Returns
+									//	FAILURE if the device didn't take it.
+	int 		(*ready)(void);		// Returns 1 once the device is done with the step, or NULL
+	unsigned 	settle;				// Time the device needs after the step, in timer 1 ticks
+} startup_step_t;
+
+// Set to 1 to bring up the RFID reader too
+#define STARTUP_RFID			0
+
+// The devices which the sequencer brings up
+typedef enum _startup_device_t
+{
+	STARTUP_DISPLAY,
+	STARTUP_WIRELESS,
+#if (STARTUP_RFID == 1)
+	STARTUP_RFID_READER,
+#endif
+	NUM_STARTUP_DEVICES
+} startup_device_t;
+
+// Converts a time in us to timer 1 ticks, rounding up
+#define STARTUP_TICKS(us)		(((us) + TIMER_1_TICK_US - 1) / TIMER_1_TICK_US)
+
+// The longest a device can take with a step before we give up on it
+//	and move on without it
+#define STARTUP_TIMEOUT			STARTUP_TICKS(100000UL)
+
+// Set to 1 to show how long boot took, in ms, on the welcome screen
+#define PROFILE_BOOT			0
+#define BOOT_LINE_MS_IDX		9		// Where the time goes in the welcome line
+
+//
+// Function declarations
+//
+void run_startup(void);
+unsigned char startup_get_failed(void);
+unsigned startup_get_ms(void);
+
+#endif /* SPACETEAM_STARTUP_H_ */
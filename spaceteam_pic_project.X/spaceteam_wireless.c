@@ -35,37 +35,147 @@
 #include "spaceteam_display.h"
 #include "spaceteam_rfid.h"
 #include "spaceteam_general.h"
+#include "spaceteam_clock.h"
 #include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_script.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_event.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_chan.h"
 #include <stddef.h>
 
 #define FCY 8000000UL
 #include <libpic30.h>
 
-// Flag which denotes transmitting mode
-volatile unsigned char PTX;
-spaceteam_packet_t pload_data;
-
-// Addresses for all of the players
-unsigned char player_addresses[NUM_PLAYERS][wl_module_ADDR_LEN] =
+// The payloads waiting to be sent. The oldest one the module hasn't
+//	sent yet is at the head, the next one to give it is at load and new
+//	ones go in at the tail.
+unsigned char wl_tx_ring[WL_TX_RING_SIZE];
+unsigned char wl_tx_head;
+unsigned char wl_tx_load;
+unsigned char wl_tx_tail;
+unsigned char wl_tx_used;				// Bytes of the ring in use
+unsigned char wl_tx_queued;				// Payloads not given to the module yet
+unsigned char wl_tx_loaded;				// Payloads in the module's TX FIFO
+unsigned char wl_tx_dest;				// Who the module's address is set for
+unsigned char wl_rate_now;				// The rate the module's set to
+unsigned char wl_tx_tries[NUM_PLAYERS];	// Times we've sent to each board again ourselves
+unsigned char wl_tx_held;				// Boards we're waiting to send to again, a bit each
+unsigned wl_tx_retry_at[NUM_PLAYERS];	// When to
+unsigned wl_tx_delivered;				// Payloads which were ACKed
+unsigned wl_tx_retries;					// Times we sent one again ourselves
+unsigned wl_tx_failures;				// Payloads which were never ACKed
+
+// The payloads which have come in but haven't been parsed yet
+unsigned char wl_rx_ring[WL_RX_RING_SIZE];
+unsigned char wl_rx_head;
+unsigned char wl_rx_tail;
+unsigned char wl_rx_used;				// Bytes of the ring in use
+volatile unsigned char wl_rx_posted;	// The main loop has been told about them
+unsigned char wl_rx_stalled;			// Payloads were left in the RX FIFO
+unsigned wl_rx_dups;					// Payloads which we already had
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+	// The sequence number of the last payload on each link
+	unsigned char wl_tx_seq[ALL_PLAYERS + 1];
+
+	// Each slave's rate, the payloads in a row which got through to it
+	//	on the first try, and the rate it's been told to go to along
+	//	with the payload which told it
+	unsigned char wl_rate[NUM_PLAYERS];
+	unsigned char wl_rate_clean[NUM_PLAYERS];
+	unsigned char wl_rate_pending[NUM_PLAYERS];
+	unsigned char wl_rate_seq[NUM_PLAYERS];
+
+	// The messages in the last payload which was never ACKed, without
+	//	its link header, until the main loop goes through them
+	unsigned char wl_tx_lost[WL_MSG_PAYLOAD_LEN];
+	unsigned char wl_tx_lost_len;
+
+	// The payloads to each slave which were ACKed, and the ones which
+	//	needed our retries or failed, since the channel manager looked
+	unsigned wl_link_delivered[NUM_PLAYERS];
+	unsigned wl_link_lost[NUM_PLAYERS];
+#else
+	// The last sequence number taken on each pipe, and when
+	unsigned char wl_rx_seq[WL_NUM_PIPES];
+	unsigned wl_rx_seq_at[WL_NUM_PIPES];
+
+	// The rate to go back to if the master doesn't follow us to the one
+	//	we're trying, and when we started trying it
+	unsigned char wl_rate_old;
+	unsigned wl_rate_try_at;
+#endif
+
+// RF_SETUP for each rate
+const unsigned char wl_rate_setup[WL_NUM_RATES] =
 	{
-		{0x00, 0x01, 0x02, 0x03, 0x04},
-		{0x01, 0x02, 0x03, 0x04, 0x05},
-		{0x02, 0x03, 0x04, 0x05, 0x06},
-		{0x03, 0x04, 0x05, 0x06, 0x07},
-		{0x04, 0x05, 0x06, 0x07, 0x08}
+		(RF_SETUP_RF_PWR_0 | RF_SETUP_RF_DR_250),
+		(RF_SETUP_RF_PWR_0 | RF_SETUP_RF_DR_1000),
+		(RF_SETUP_RF_PWR_0 | RF_SETUP_RF_DR_2000)
 	};
 
+// The upper bytes of every board's address. Only the low byte, which is
+//	WL_ADDR_LSB(player), differs from board to board.
+const unsigned char wl_addr_high[wl_module_ADDR_LEN - 1] = {0xA5, 0x3C, 0x96, 0xE1};
+
+// How the init scripts talk to the module
+const script_bus_t wl_module_bus =
+	{
+		wl_module_write_register,
+		wl_module_read_registers
+	};
 
+// The module's settings, which are checked once they're written. The
+//	slaves listen, so they also set their payload length and power up
+//	in PRX mode.
+const script_op_t wl_module_config_script[] =
+	{
+		{ STATUS, 		0x70, 					0x00, 	0 },	// Clear the interrupts, which reads back 0
+		{ RF_CH, 		wl_module_CH, 			0x7F, 	0 },
+		{ RF_SETUP, 	wl_module_RF_SETUP, 	(RF_SETUP_RF_DR_250 | RF_SETUP_RF_DR | RF_SETUP_RF_PWR), 0 },
+		{ FEATURE, 		((1<<EN_DPL) | (1<<EN_ACK_PAY) | (1<<EN_DYN_ACK)), 0x07, 0 },	// Dynamic payloads, ACK payloads and NOACK sends
+		{ SETUP_AW, 	SETUP_AW_5BYTES, 		0x03, 	0 },
+		{ EN_RXADDR, 	WL_PIPES, 				0x3F, 	0 },	// Only the pipes we use
+		{ EN_AA, 		WL_PIPES, 				0x3F, 	0 },
+		{ DYNPD, 		WL_PIPES, 				0x3F, 	0 },	// Dynamic payloads on them
+		{ SETUP_RETR, 	wl_module_RETR, 		0xFF, 	0 },
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		{ RX_PW_P1, 	wl_module_PAYLOAD_LEN, 	0x3F, 	0 },
+		{ RX_ADDR_P2, 	WL_ADDR_LSB(ALL_PLAYERS), 0xFF, 0 },	// Shares pipe 1's upper bytes
+		{ CONFIG, 		(wl_module_CONFIG | (1<<PWR_UP) | (1<<PRIM_RX)), 0x7F, 0 },
+	#endif
+	};
 
 //
 // This function fully resets and initializes the wireless
 //	module and sets it in PRX or PTX mode according to 
-//	whether it is a master or a slave
+//	whether it is a master or a slave. It waits on the module at
+//	each step, so the startup sequencer runs the steps itself
+//	rather than calling this.
 //
 void init_wireless()
 {
-	char curr_addr[wl_module_ADDR_LEN];
+	// Wait for the module to come out of its power on reset
+	wl_module_prepare();
+	while (!wl_module_is_alive())
+	{
+		clock_delay_us(100);
+	}
+
+	wl_module_configure();
+
+	// Give it a bit to power up
+	clock_delay_us(WL_STANDBY_US);
 
+	wl_module_start();
+}
+
+// This function sets up the pins and the SPI for the module
+int wl_module_prepare(void)
+{
     // Define CSN and CE as Output and set them to default
     wl_module_CE_lo;
     wl_module_CSN_hi;
@@ -76,79 +186,373 @@ void init_wireless()
     	init_spi();
     }
 
-    // Clear all pending interrupts for the wireless controller
-    wl_module_write_register_byte(STATUS, 0x70);
+    return SUCCESS;
+}
+
+// This function returns 1 once the module is out of its power on reset
+//	and taking commands over the SPI. Until then, nothing we write to it
+//	sticks, so write the channel and see if it reads back.
+int wl_module_is_alive(void)
+{
+	wl_module_write_register_byte(RF_CH, wl_module_CH);
+
+	return (wl_module_read_register_byte(RF_CH) == wl_module_CH);
+}
+
+// This function writes all of the module's settings, and powers it up
+//	in PRX or PTX mode. The module needs WL_STANDBY_US after this before
+//	it can send or listen. It returns FAILURE if the module didn't take
+//	the settings.
+int wl_module_configure(void)
+{
+	int status;
+
+    // Set up the addresses. A slave listens on its own, and the master
+    //  only has to change the low byte of its TX address from here on.
+    #if (THIS_PLAYER == MASTER_PLAYER)
+        wl_module_write_address(TX_ADDR, MASTER_PLAYER);
+        wl_module_write_address(RX_ADDR_P0, MASTER_PLAYER);
+    #else
+        wl_module_write_address(RX_ADDR_P1, THIS_PLAYER);
+    #endif
 
-    // Set up the chip address
-    wl_module_set_address(player_addresses[THIS_PLAYER]);
+    // Write and check the settings
+    status = script_run(&wl_module_bus, wl_module_config_script, SCRIPT_LEN(wl_module_config_script));
 
-    // Set RF channel
-    wl_module_write_register_byte(RF_CH, wl_module_CH);
-	// Set data speed & Output Power configured in wl_module.h
-	wl_module_write_register_byte(RF_SETUP, wl_module_RF_SETUP);
-	// Initialize the feature register to enable dynamic payloads and auto-ack
-	wl_module_write_register_byte(FEATURE, 0x06);
-	// Initialize the dynamic payload length register to enable dynamic payloads on pipe 0
-	wl_module_write_register_byte(DYNPD, 0x01);
 	// Flush the TX and RX FIFOs on startup
 	wl_module_send_command(FLUSH_TX, NULL, NULL, 0);
 	wl_module_send_command(FLUSH_RX, NULL, NULL, 0);
 
-	// Clear the shared variable for monitoring retries
-	PTX = 0;
+	// Nothing is waiting to go out, and every link is at the base rate
+	wl_module_tx_reset();
+	wl_rate_now = WL_RATE_BASE;
+	wl_module_rate_reset();
 
+	return status;
+}
+
+// This function turns on the module's interrupt, and if we're a slave
+//	starts listening for packets. It's the last step of bringing the
+//	module up, since the interrupt uses the SPI too.
+int wl_module_start(void)
+{
     // 
     // Set up interrupts on the PIC 
     //
-    IPC7bits.INT2IP = 7;	// Set interrupt priority to highest (7)
+    IPC7bits.INT2IP = RADIO_INT_PRIORITY;	// Just below the LED scan, see spaceteam_crit.h
     IFS1bits.INT2IF = 0;	// Clear the interrupt flag, if it was set.
     INTCON2bits.INT2EP = 1; // Falling edge
     IEC1bits.INT2IE = 1;	// Enable interrupt 2
 
-   	//
-	// Either start the transmitter or receiver, based on master/slave 
-	//
-	#if (THIS_PLAYER == MASTER_PLAYER)
-		// Setup retries
-		wl_module_write_register_byte(SETUP_RETR, (SETUP_RETR_ARD_1000 | SETUP_RETR_ARC_0));
+	#if (THIS_PLAYER != MASTER_PLAYER)
+		// And send the chip enable high to begin listening for packets
+		wl_module_CE_hi;
+	#endif
+
+	return SUCCESS;
+}
+
+// This function writes the whole of the passed player's address to one
+//	of the module's address registers, low byte first
+void wl_module_write_address(unsigned char reg, unsigned char player)
+{
+	unsigned char address[wl_module_ADDR_LEN];
+	unsigned char i;
+
+	address[0] = WL_ADDR_LSB(player);
+	for (i = 1; i < wl_module_ADDR_LEN; i++)
+	{
+		address[i] = wl_addr_high[i - 1];
+	}
+
+	wl_module_write_register(reg, address, wl_module_ADDR_LEN);
+}
 
+// This function points the master's TX address at the passed player. The
+//	ACK comes back to the same address on pipe 0. The upper bytes are the
+//	same for everyone, and a write shorter than the address only changes
+//	the low bytes, so only the low byte is written.
+void wl_module_set_dest(unsigned char player)
+{
+	unsigned char lsb = WL_ADDR_LSB(player);
+
+	wl_module_write_register(TX_ADDR, &lsb, 1);
+	wl_module_write_register(RX_ADDR_P0, &lsb, 1);
+}
+
+// This function moves the module to another channel. A slave carries on
+//	listening, and the master carries on with anything in its TX FIFO.
+void wl_module_set_channel(unsigned char channel)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	wl_module_CE_lo;
+	wl_module_write_register_byte(RF_CH, channel);
+
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		if (wl_tx_loaded != 0)
+		{
+			wl_module_CE_hi;
+		}
 	#else
-		// Setup retries
-		wl_module_write_register_byte(SETUP_RETR, (SETUP_RETR_ARD_1000 | SETUP_RETR_ARC_0));
-		// Set length of incoming payload
-    	wl_module_write_register_byte(RX_PW_P0, wl_module_PAYLOAD_LEN);
-		// Want to start up the receiver
-		RX_POWERUP;
-		// And send the chip enable high to begin listening for packets
 		wl_module_CE_hi;
 	#endif
 
-	// Give it a bit to power up
-	__delay_ms(50);
+	CRIT_EXIT(ipl);
 }
 
-// Set the TX and RX address for the module on data pipe 0
-void wl_module_set_address(unsigned char * address)
+// This function moves a slave to another data rate, and it carries on
+//	listening. The master changes rate as it loads payloads instead.
+void wl_module_set_rate(unsigned char rate)
 {
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	wl_module_CE_lo;
+	wl_module_write_register_byte(RF_SETUP, wl_rate_setup[rate]);
+	wl_rate_now = rate;
+	wl_module_CE_hi;
+
+	CRIT_EXIT(ipl);
+}
 
-	// Write the RX address to pipe 0
-	wl_module_write_register(RX_ADDR_P0, address, wl_module_ADDR_LEN);
+// This function returns the rate the module's set to
+unsigned char wl_module_get_rate(void)
+{
+	return wl_rate_now;
+}
 
-	// Only configure the TX address if we are a wireless master, otherwise
-	//	it does bad things
+// This function puts every link back to the base rate. The master's
+//	module follows when it next loads a payload; a slave's moves now.
+//	It doesn't touch a slave's module if it's already there, so it's safe
+//	to call before the module is up.
+void wl_module_rate_reset(void)
+{
 	#if (THIS_PLAYER == MASTER_PLAYER)
-		// And write the transmit address
-		wl_module_write_register(TX_ADDR, address, wl_module_ADDR_LEN);
+		unsigned char i;
+
+		for (i = 0; i < NUM_PLAYERS; i++)
+		{
+			wl_rate[i] = WL_RATE_BASE;
+			wl_rate_clean[i] = 0;
+			wl_rate_pending[i] = WL_RATE_NONE;
+		}
+	#else
+		wl_rate_old = WL_RATE_NONE;
+		if (wl_rate_now != WL_RATE_BASE)
+		{
+			wl_module_set_rate(WL_RATE_BASE);
+		}
 	#endif
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This function returns the rate a payload in the TX ring goes out at
+unsigned char wl_module_entry_rate(unsigned char dest)
+{
+	if ((dest & WL_DEST_MASK) == ALL_PLAYERS)
+	{
+		return dest >> WL_DEST_RATE_SHIFT;
+	}
+
+	return wl_rate[dest];
+}
+
+// This function returns the rates the slaves could be listening at, a
+//	bit per rate. The base rate is always one, since that's where a slave
+//	we've lost track of goes.
+unsigned char wl_module_rates_in_use(void)
+{
+	unsigned char rates = (1 << WL_RATE_BASE);
+	unsigned char i;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if (i == MASTER_PLAYER)
+		{
+			continue;
+		}
+
+		rates |= (1 << wl_rate[i]);
+		if (wl_rate_pending[i] != WL_RATE_NONE)
+		{
+			rates |= (1 << wl_rate_pending[i]);
+		}
+	}
+
+	return rates;
+}
+
+// This function is called from the interrupt for each payload to a slave
+//	which was ACKed, with its sequence number. If it told the slave to
+//	change rate, we change too.
+void wl_module_rate_acked(unsigned char dest, unsigned char seq)
+{
+	if ( (wl_rate_pending[dest] != WL_RATE_NONE) && (seq == wl_rate_seq[dest]) )
+	{
+		wl_rate[dest] = wl_rate_pending[dest];
+		wl_rate_pending[dest] = WL_RATE_NONE;
+		wl_rate_clean[dest] = 0;
+	}
+}
+
+// This function is called from the interrupt after a payload to a slave
+//	was ACKed, with how many retries it took, which say whether the link
+//	should go up or down a rate. Nothing changes while a change is
+//	already under way.
+void wl_module_rate_note(unsigned char dest, unsigned char arc)
+{
+	if (wl_rate_pending[dest] != WL_RATE_NONE)
+	{
+		return;
+	}
 
+	if (arc >= WL_RATE_DOWN_ARC)
+	{
+		wl_rate_clean[dest] = 0;
+		if (wl_rate[dest] != WL_RATE_BASE)
+		{
+			wl_module_rate_propose(dest, wl_rate[dest] - 1);
+		}
+	}
+	else if (arc == 0)
+	{
+		wl_rate_clean[dest]++;
+		if ( (wl_rate_clean[dest] >= WL_RATE_UP_AFTER) && (wl_rate[dest] < (WL_NUM_RATES - 1)) )
+		{
+			wl_rate_clean[dest] = 0;
+			wl_module_rate_propose(dest, wl_rate[dest] + 1);
+		}
+	}
+}
+
+// This function tells a slave to go to another rate, in a payload of its
+//	own so that we know when it's been ACKed
+void wl_module_rate_propose(unsigned char player, unsigned char rate)
+{
+	spaceteam_packet_t packet;
+	unsigned char buf[WIRE_MAX_LEN];
+	unsigned char len;
+
+	packet.type = MSG_RATE;
+	packet.sender = MASTER_PLAYER;
+	packet.recipient = player;
+	packet.request = 0;
+	packet.val = rate;
+	len = msg_pack(&packet, buf);
+
+	if (wl_module_send_link(buf, len, player, 1) == SUCCESS)
+	{
+		wl_rate_pending[player] = rate;
+		wl_rate_seq[player] = wl_tx_seq[player];
+	}
+}
+
+// This function returns the rate the passed slave's link is at
+unsigned char wl_module_get_link_rate(unsigned char player)
+{
+	return wl_rate[player];
+}
+
+#else
+
+// This function moves to the rate the master told us to, until we know
+//	it heard our ACK and followed
+void wl_module_rate_try(unsigned char rate)
+{
+	wl_rate_old = wl_rate_now;
+	wl_rate_try_at = sched_get_ms();
+	wl_module_set_rate(rate);
+}
+
+// This function is called by timer 2, and goes back to the old rate if
+//	nothing came in at the one we're trying
+void wl_module_rate_service(void)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	if ( (wl_rate_old != WL_RATE_NONE) && sched_ms_passed(wl_rate_try_at + WL_RATE_TRY_MS) )
+	{
+		wl_module_set_rate(wl_rate_old);
+		wl_rate_old = WL_RATE_NONE;
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns 1 if we're trying a rate. Timer 2 has to keep
+//	running until we know whether to keep it.
+int wl_module_rate_trying(void)
+{
+	return (wl_rate_old != WL_RATE_NONE);
+}
+
+#endif
+
+// This function listens to the passed channel the passed number of
+//	times, and returns how many of them the received power detector said
+//	someone else was on it. It's only for the master while it has nothing
+//	to send, since it has to take the module out of TX mode to listen.
+unsigned char wl_module_carrier_count(unsigned char channel, unsigned char samples)
+{
+	unsigned char old;
+	unsigned char hits = 0;
+	unsigned char i;
+
+	old = wl_module_read_register_byte(RF_CH);
+
+	wl_module_CE_lo;
+	RX_POWERUP;
+	wl_module_write_register_byte(RF_CH, channel);
+
+	for (i = 0; i < samples; i++)
+	{
+		wl_module_CE_hi;
+		clock_delay_us(WL_RPD_SETTLE_US);
+		if (wl_module_read_register_byte(RPD) & RPD_RPD)
+		{
+			hits++;
+		}
+		wl_module_CE_lo;
+	}
+
+	// Anything we happened to pick up wasn't for us
+	wl_module_send_command(FLUSH_RX, NULL, NULL, 0);
+
+	wl_module_write_register_byte(RF_CH, old);
+	TX_POWERUP;
+
+	return hits;
+}
+
+// This function returns the player which a payload that came in on the
+//	passed pipe is from. The master hears from whoever it's sending to,
+//	and a slave only ever hears from the master, either just to it or to
+//	everyone. A broadcast comes back as from ALL_PLAYERS.
+unsigned char wl_module_pipe_player(unsigned char pipe)
+{
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		(void)pipe;
+		return wl_tx_dest;
+	#else
+		return (pipe == WL_PIPE_BCAST) ? ALL_PLAYERS : MASTER_PLAYER;
+	#endif
 }
 
 //return the value of the status register
 unsigned char wl_module_get_status(void)
 {
 	unsigned char status;
+	unsigned ipl;
 
 	// Set the chip select low
+	ipl = spi_begin();
 	wl_module_CSN_lo
 
 	// Get the status byte
@@ -156,6 +560,7 @@ unsigned char wl_module_get_status(void)
 
 	// Pull the chip select back high
 	wl_module_CSN_hi
+	spi_end(ipl);
 
 	// And return the status
 	return status;
@@ -164,9 +569,12 @@ unsigned char wl_module_get_status(void)
 // Send a command to the wireless module. The command may also require sending/
 //	reading a number of bytes after the initial byte. If this is not the case, 
 //	make the length 0
-void wl_module_send_command(unsigned char command, unsigned char * datain, unsigned char * dataout, unsigned char data_len)
+void wl_module_send_command(unsigned char command, const unsigned char * datain, unsigned char * dataout, unsigned char data_len)
 {
+	unsigned ipl;
+
 	// Send the chip select low
+	ipl = spi_begin();
 	wl_module_CSN_lo;
 	// Write the command byte
 	spi_write(command);
@@ -177,6 +585,7 @@ void wl_module_send_command(unsigned char command, unsigned char * datain, unsig
 
 	// Pull the chip select back high
 	wl_module_CSN_hi;
+	spi_end(ipl);
 }
 
 // Read a number of bytes from a wireless register
@@ -199,8 +608,19 @@ unsigned char wl_module_read_register_byte(unsigned char reg)
     return reg_val;
 }
 
+// Read a list of registers, a byte from each
+void wl_module_read_registers(const unsigned char * regs, unsigned char * vals, unsigned char len)
+{
+	unsigned char i;
+
+	for (i = 0; i < len; i++)
+	{
+		vals[i] = wl_module_read_register_byte(regs[i]);
+	}
+}
+
 // Write a number of bytes to a wireless register
-void wl_module_write_register(unsigned char reg, unsigned char * value, unsigned char len)
+void wl_module_write_register(unsigned char reg, const unsigned char * value, unsigned char len)
 // Writes an array of bytes into inte the wl-module registers.
 {
 	// Send the command to write the bytes
@@ -216,95 +636,911 @@ void wl_module_write_register_byte(unsigned char reg, unsigned char value)
 	wl_module_write_register(reg, &reg_val, 1);
 }
 
-// Read the payload from the RX FIFO
-void wl_module_get_payload(unsigned char * pload)
-// Reads pload_len bytes from the RX fifo into the data array
+// This function moves everything in the module's RX FIFO into the RX
+//	ring, each payload as a length byte and then the payload, and then
+//	has the main loop parse it. It's called from the interrupt, and from
+//	the main loop once it's made room. Anything there isn't room for is
+//	left in the FIFO until then.
+void wl_module_rx_drain(void)
+{
+	unsigned char pipe;
+	unsigned char len;
+	unsigned char idx;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	wl_rx_stalled = 0;
+
+	// The status says which pipe the payload at the front of the FIFO
+	//	came in on, or that it's empty
+	while ((pipe = ((wl_module_get_status() & STATUS_RX_P_NO) >> RX_P_NO)) != WL_PIPE_EMPTY)
+	{
+		// Payloads are dynamic, so find out how long this one is
+		wl_module_send_command(R_RX_PL_WID, NULL, &len, 1);
+
+		// Anything longer than ours is garbage, and the only way to get
+		//	rid of it is to flush the FIFO
+		if ( (len == 0) || (len > wl_module_PAYLOAD_LEN) || (pipe >= WL_NUM_PIPES) )
+		{
+			wl_module_send_command(FLUSH_RX, NULL, NULL, 0);
+			break;
+		}
+
+		idx = wl_module_rx_reserve(len + WL_RX_ENTRY_HDR);
+		if (idx == WL_RX_FULL)
+		{
+			wl_rx_stalled = 1;
+			break;
+		}
+
+		wl_rx_ring[idx] = len;
+		wl_rx_ring[idx + 1] = wl_module_pipe_player(pipe);
+		wl_module_send_command(R_RX_PAYLOAD, NULL, &wl_rx_ring[idx + WL_RX_ENTRY_HDR], len);
+
+		// Leave out anything from the master which we've already got,
+		//	along with any too short to have a sequence number
+		#if (THIS_PLAYER != MASTER_PLAYER)
+			if ( (len <= WL_LINK_HDR_LEN) ||
+				 ( (wl_rx_ring[idx + WL_RX_ENTRY_HDR] == wl_rx_seq[pipe]) &&
+				   !sched_ms_passed(wl_rx_seq_at[pipe] + WL_RX_DEDUP_MS) ) )
+			{
+				wl_rx_dups++;
+				continue;
+			}
+
+			wl_rx_seq[pipe] = wl_rx_ring[idx + WL_RX_ENTRY_HDR];
+			wl_rx_seq_at[pipe] = sched_get_ms();
+
+			// Anything new on our own pipe came at the rate we're at, so
+			//	the master's there too
+			if (pipe == WL_PIPE_MASTER)
+			{
+				wl_rate_old = WL_RATE_NONE;
+			}
+		#endif
+
+		wl_rx_tail = idx + len + WL_RX_ENTRY_HDR;
+		if (wl_rx_tail >= WL_RX_RING_SIZE)
+		{
+			wl_rx_tail = 0;
+		}
+		wl_rx_used += len + WL_RX_ENTRY_HDR;
+	}
+
+	// Have the main loop parse it, unless it's already been asked to. If
+	//	the event pool is empty, the main loop has events to handle
+	//	anyway and picks it up after them.
+	if ( (wl_rx_used != 0) && !wl_rx_posted )
+	{
+		if (event_post(EVENT_RADIO_RX, 0) == SUCCESS)
+		{
+			wl_rx_posted = 1;
+		}
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function finds room in the RX ring for need bytes in one piece,
+//	and returns where it is, or WL_RX_FULL if there isn't any
+unsigned char wl_module_rx_reserve(unsigned char need)
+{
+	if (wl_rx_used == 0)
+	{
+		wl_rx_head = 0;
+		wl_rx_tail = 0;
+	}
+
+	if ( (wl_rx_used == 0) || (wl_rx_tail > wl_rx_head) )
+	{
+		if ((WL_RX_RING_SIZE - wl_rx_tail) >= need)
+		{
+			return wl_rx_tail;
+		}
+
+		if (wl_rx_head < need)
+		{
+			return WL_RX_FULL;
+		}
+
+		// Mark the rest of the end as skipped, and go to the start
+		wl_rx_ring[wl_rx_tail] = WL_RX_WRAP;
+		wl_rx_used += WL_RX_RING_SIZE - wl_rx_tail;
+		wl_rx_tail = 0;
+		return 0;
+	}
+
+	if ((wl_rx_head - wl_rx_tail) >= need)
+	{
+		return wl_rx_tail;
+	}
+
+	return WL_RX_FULL;
+}
+
+// This function parses everything in the RX ring. It's run by the main
+//	loop when the radio posts EVENT_RADIO_RX. The handlers share the
+//	request lists with the timers, so each message is parsed with them
+//	held off, just as it was in the interrupt, but only one at a time.
+void wl_module_rx_service(void)
 {
-    // Send the command to read the RX payload
-    wl_module_send_command( R_RX_PAYLOAD, NULL, pload , wl_module_PAYLOAD_LEN );
+	spaceteam_packet_t packet;
+	unsigned char * entry;
+	unsigned char pos;
+	unsigned char used;
+	unsigned ipl;
+
+	wl_rx_posted = 0;
+
+	while (wl_rx_used != 0)
+	{
+		// Skip the end of the ring if it was
+		if (wl_rx_ring[wl_rx_head] == WL_RX_WRAP)
+		{
+			CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+			wl_rx_used -= WL_RX_RING_SIZE - wl_rx_head;
+			wl_rx_head = 0;
+			CRIT_EXIT(ipl);
+			continue;
+		}
+
+		entry = &wl_rx_ring[wl_rx_head];
+
+		// Anything from a slave means it had something to say, and
+		//	anything from the master means we're on its channel
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+			poll_note_heard(entry[1]);
+			CRIT_EXIT(ipl);
+		#else
+			chan_note_heard();
+		#endif
+
+		// A payload can hold a few messages, so parse each of them,
+		//	until the end or anything which is garbage or from
+		//	another version. The master's have a sequence number first.
+		pos = WL_RX_ENTRY_HDR;
+		#if (THIS_PLAYER != MASTER_PLAYER)
+			pos += WL_LINK_HDR_LEN;
+		#endif
+		while (pos < (entry[0] + WL_RX_ENTRY_HDR))
+		{
+			used = msg_unpack(&entry[pos], entry[0] + WL_RX_ENTRY_HDR - pos, &packet);
+			if (used == 0)
+			{
+				break;
+			}
+
+			CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+			parse_message(packet.type, packet.request, packet.sender, packet.recipient, packet.val);
+			CRIT_EXIT(ipl);
+
+			pos += used;
+		}
+
+		CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+		wl_rx_used -= entry[0] + WL_RX_ENTRY_HDR;
+		wl_rx_head += entry[0] + WL_RX_ENTRY_HDR;
+		if (wl_rx_head >= WL_RX_RING_SIZE)
+		{
+			wl_rx_head = 0;
+		}
+		CRIT_EXIT(ipl);
+
+		// Now there's room, get anything which was left in the FIFO
+		if (wl_rx_stalled)
+		{
+			wl_module_rx_drain();
+			wl_module_tx_pump();
+		}
+	}
+}
 
+// This function returns 1 if there are payloads which haven't been parsed
+int wl_module_rx_pending(void)
+{
+	return (wl_rx_used != 0);
 }
 
+#if (THIS_PLAYER == MASTER_PLAYER)
+
 // Send the payload out
-void wl_module_send_payload(unsigned char * pload, spaceteam_player_t player)
-// Sends a data package to the default address. Be sure to send the correct
-// amount of bytes as configured as payload on the receiver.
+int wl_module_send_payload(const unsigned char * pload, unsigned char len, spaceteam_player_t player)
+// Queues a data package of len bytes for the player's address. Payloads are
+// dynamic, so the receiver finds out the length from the module. Returns
+// FAILURE if there's no room for it yet.
+{
+    return wl_module_send_link(pload, len, player, 1);
+}
+
+// Queue a payload for every slave at once. Nobody ACKs it, so it goes
+//	out WL_BCAST_REPEATS times.
+int wl_module_send_broadcast(const unsigned char * pload, unsigned char len)
+{
+	return wl_module_send_link(pload, len, ALL_PLAYERS, WL_BCAST_REPEATS);
+}
+
+// This function queues copies of a payload for the passed player or
+//	everyone, after the next sequence number on that link. Returns FAILURE
+//	if there's no room for even one copy; the rest are sent if there's
+//	room for them.
+int wl_module_send_link(const unsigned char * pload, unsigned char len, unsigned char dest, unsigned char copies)
+{
+	unsigned char buf[wl_module_PAYLOAD_LEN];
+	unsigned char rates;
+	unsigned char rate;
+	unsigned char entry;
+	unsigned char i;
+	int status = FAILURE;
+	unsigned ipl;
+
+	if (len > WL_MSG_PAYLOAD_LEN)
+	{
+		return FAILURE;
+	}
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	buf[0] = wl_tx_seq[dest] + 1;
+	for (i = 0; i < len; i++)
+	{
+		buf[WL_LINK_HDR_LEN + i] = pload[i];
+	}
+
+	// A payload to one slave goes at whatever rate its link is at when
+	//	it's loaded, and a broadcast goes at each rate a slave is at
+	rates = (dest == ALL_PLAYERS) ? wl_module_rates_in_use() : 1;
+
+	for (rate = 0; rate < WL_NUM_RATES; rate++)
+	{
+		if (!(rates & (1 << rate)))
+		{
+			continue;
+		}
+
+		entry = (dest == ALL_PLAYERS) ? (ALL_PLAYERS | (rate << WL_DEST_RATE_SHIFT)) : dest;
+		for (i = 0; i < copies; i++)
+		{
+			if (wl_module_tx_queue(buf, len + WL_LINK_HDR_LEN, entry) == SUCCESS)
+			{
+				status = SUCCESS;
+			}
+		}
+	}
+
+	if (status == SUCCESS)
+	{
+		wl_tx_seq[dest]++;
+	}
+
+	CRIT_EXIT(ipl);
+
+	return status;
+}
+
+#endif
+
+// Queue an ack payload, which goes back to the master with the ACK of the
+//	next packet it sends us
+int wl_module_send_ack(const unsigned char * pload, unsigned char len)
 {
-    // while (PTX) {}                  	// Wait until last packet is sent
+    return wl_module_tx_queue(pload, len, MASTER_PLAYER);
+}
 
-    wl_module_CE_lo;					// Send the chip enable low
+// This function empties out the TX queue. The module's TX FIFO has to
+//	be flushed along with it.
+void wl_module_tx_reset(void)
+{
+	unsigned char i;
+
+	wl_tx_head = 0;
+	wl_tx_load = 0;
+	wl_tx_tail = 0;
+	wl_tx_used = 0;
+	wl_tx_queued = 0;
+	wl_tx_loaded = 0;
+	wl_tx_dest = WL_TX_NO_DEST;
+	wl_tx_held = 0;
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		wl_tx_lost_len = 0;
 
-    // PTX = 1;                        	// Indicate that we are trying to send a packet
-    TX_POWERUP;                     	// Power up
+		for (i = 0; i < NUM_PLAYERS; i++)
+		{
+			wl_link_delivered[i] = 0;
+			wl_link_lost[i] = 0;
+		}
+	#endif
 
-    // Change the address
-    wl_module_set_address(player_addresses[player]);
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		wl_tx_tries[i] = 0;
+	}
+}
+
+// This function adds a payload to the end of the TX queue, and gives
+//	the module as much as it can take. Returns FAILURE if there's no room.
+int wl_module_tx_queue(const unsigned char * pload, unsigned char len, unsigned char dest)
+{
+	int status;
+	unsigned ipl;
 
-    // Flush the TX FIFO
-    wl_module_send_command(FLUSH_TX, NULL, NULL, 0);
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
 
-    // SEnd the command to write the payload
-    wl_module_send_command(W_TX_PAYLOAD, pload, NULL, wl_module_PAYLOAD_LEN);
+	status = wl_module_tx_append(pload, len, dest);
+	if (status == SUCCESS)
+	{
+		wl_module_tx_pump();
+	}
 
-    // And start the transmit
-    wl_module_start_transmit();
+	CRIT_EXIT(ipl);
 
+	return status;
 }
 
-// Write an ack payload
-void wl_module_send_ack(unsigned char * pload)
+// This function adds a payload to the end of the TX queue. A payload is
+//	never split across the end of the ring, so that it can be written
+//	straight out of it. Returns FAILURE if there's no room. It has to be
+//	called with the radio interrupt held off.
+int wl_module_tx_append(const unsigned char * pload, unsigned char len, unsigned char dest)
 {
-	// Flush the TX FIFO
-    wl_module_send_command(FLUSH_TX, NULL, NULL, 0);
-	// SEnd the command to write the payload
-    wl_module_send_command(W_ACK_PAYLOAD, pload, NULL, wl_module_PAYLOAD_LEN);
+	unsigned char need = len + WL_TX_ENTRY_HDR;
+	unsigned char i;
+
+	if ( (len == 0) || (len > wl_module_PAYLOAD_LEN) )
+	{
+		return FAILURE;
+	}
+
+	// Start back at the beginning whenever it's empty, so there's as much
+	//	room in one piece as there can be
+	if (wl_tx_used == 0)
+	{
+		wl_tx_head = 0;
+		wl_tx_load = 0;
+		wl_tx_tail = 0;
+	}
+
+	// If what's in use doesn't wrap, there's room at the end and then
+	//	at the start. Otherwise there's only the gap in the middle.
+	if ( (wl_tx_used == 0) || (wl_tx_tail > wl_tx_head) )
+	{
+		if ((WL_TX_RING_SIZE - wl_tx_tail) < need)
+		{
+			if (wl_tx_head < need)
+			{
+				return FAILURE;
+			}
+
+			// Mark the rest of the end as skipped, and go to the start
+			wl_tx_ring[wl_tx_tail] = WL_TX_WRAP;
+			wl_tx_used += WL_TX_RING_SIZE - wl_tx_tail;
+			wl_tx_tail = 0;
+		}
+	}
+	else if ((wl_tx_head - wl_tx_tail) < need)
+	{
+		return FAILURE;
+	}
+
+	wl_tx_ring[wl_tx_tail] = len;
+	wl_tx_ring[wl_tx_tail + 1] = dest;
+	for (i = 0; i < len; i++)
+	{
+		wl_tx_ring[wl_tx_tail + WL_TX_ENTRY_HDR + i] = pload[i];
+	}
+
+	wl_tx_tail = wl_module_tx_next(wl_tx_tail);
+	wl_tx_used += need;
+	wl_tx_queued++;
+
+	return SUCCESS;
 }
 
-// This function toggles the CE line for 10us to begin a transmit
-void wl_module_start_transmit(void)
+// This function gives the module as many of the waiting payloads as
+//	its TX FIFO can hold. The module can only send to one address at a
+//	time, so a payload for someone else waits until the FIFO is empty.
+//	A payload to a board we're backing off from goes to the back, once
+//	the module has nothing in front of it, if there's anything behind it
+//	which can go. It's called whenever a payload is queued or sent.
+void wl_module_tx_pump(void)
 {
-	wl_module_CE_hi;
-    __delay_us(10);						
-    wl_module_CE_lo;	
+	unsigned char idx;
+	unsigned char dest;
+	unsigned ipl;
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		unsigned char rate;
+	#endif
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	while ( (wl_tx_queued != 0) && (wl_tx_loaded < WL_TX_FIFO_DEPTH) )
+	{
+		idx = wl_module_tx_skip_wrap(wl_tx_load);
+		dest = wl_tx_ring[idx + 1];
+
+		if (wl_module_tx_is_held(dest))
+		{
+			if ( (wl_tx_loaded != 0) || !wl_module_tx_any_ready() )
+			{
+				break;
+			}
+
+			wl_module_tx_requeue();
+			continue;
+		}
+
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			rate = wl_module_entry_rate(dest);
+
+			// While a slave is changing rate, its payloads go one at a
+			//	time, so that none are loaded at the old rate after the
+			//	one which told it
+			if ( (dest < NUM_PLAYERS) && (wl_rate_pending[dest] != WL_RATE_NONE) && (wl_tx_loaded != 0) )
+			{
+				break;
+			}
+
+			if ( (dest != wl_tx_dest) || (rate != wl_rate_now) )
+			{
+				// ACK payloads left in the RX FIFO are from whoever
+				//	we're pointed at now, so wait for them to be read
+				if ( (wl_tx_loaded != 0) || wl_rx_stalled )
+				{
+					break;
+				}
+
+				wl_module_CE_lo;
+				if (wl_tx_dest == WL_TX_NO_DEST)
+				{
+					TX_POWERUP;
+				}
+				if ((dest & WL_DEST_MASK) != (wl_tx_dest & WL_DEST_MASK))
+				{
+					wl_module_set_dest(dest & WL_DEST_MASK);
+				}
+				if (rate != wl_rate_now)
+				{
+					wl_module_write_register_byte(RF_SETUP, wl_rate_setup[rate]);
+					wl_rate_now = rate;
+				}
+				wl_tx_dest = dest;
+			}
+
+			// Nobody ACKs a broadcast, so the module mustn't wait for one
+			wl_module_send_command(((dest & WL_DEST_MASK) == ALL_PLAYERS) ? W_TX_PAYLOAD_NOACK : W_TX_PAYLOAD,
+								   &wl_tx_ring[idx + WL_TX_ENTRY_HDR], NULL, wl_tx_ring[idx]);
+		#else
+			wl_module_send_command(W_ACK_PAYLOAD | WL_PIPE_MASTER, &wl_tx_ring[idx + WL_TX_ENTRY_HDR], NULL, wl_tx_ring[idx]);
+		#endif
+
+		wl_tx_load = wl_module_tx_next(idx);
+		wl_tx_queued--;
+		wl_tx_loaded++;
+	}
+
+	// The master keeps the chip enable high while there's anything in
+	//	the FIFO, so that it sends them one after another
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		if (wl_tx_loaded != 0)
+		{
+			wl_module_CE_hi;
+		}
+	#endif
+
+	CRIT_EXIT(ipl);
+}
+
+// This function is called from the interrupt when the module says it
+//	sent a payload. The one at the head is done with. If the FIFO is
+//	empty, everything we gave it has gone, even if we only heard about
+//	some of it.
+void wl_module_tx_sent(void)
+{
+	unsigned char dest;
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		unsigned char idx;
+		unsigned char head = WL_TX_NO_DEST;
+		unsigned char arc = 0;
+
+		// Note how many retries the one at the head took
+		if (wl_tx_loaded != 0)
+		{
+			head = wl_tx_ring[wl_module_tx_skip_wrap(wl_tx_head) + 1];
+			arc = wl_module_read_register_byte(OBSERVE_TX) & OBSERVE_TX_ARC_CNT;
+		}
+	#endif
+
+	while (wl_tx_loaded != 0)
+	{
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			idx = wl_module_tx_skip_wrap(wl_tx_head);
+			dest = wl_tx_ring[idx + 1];
+			if (dest < NUM_PLAYERS)
+			{
+				wl_module_rate_acked(dest, wl_tx_ring[idx + WL_TX_ENTRY_HDR]);
+			}
+		#endif
+
+		dest = wl_module_tx_pop();
+		wl_tx_loaded--;
+		wl_tx_delivered++;
+		if (dest < NUM_PLAYERS)
+		{
+			wl_tx_tries[dest] = 0;
+			#if (THIS_PLAYER == MASTER_PLAYER)
+				wl_link_delivered[dest]++;
+			#endif
+		}
+
+		if ( (wl_tx_loaded == 0) ||
+			 !(wl_module_read_register_byte(FIFO_STATUS) & (1 << TX_EMPTY)) )
+		{
+			break;
+		}
+	}
+
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		if (wl_tx_loaded == 0)
+		{
+			wl_module_CE_lo;
+		}
+
+		if (head < NUM_PLAYERS)
+		{
+			wl_module_rate_note(head, arc);
+		}
+	#endif
+
+	wl_module_tx_pump();
+}
+
+// This function is called from the interrupt when the payload at the
+//	head of the FIFO ran out of retries. Its board is held off for a
+//	backoff and then it's sent again, with the same sequence number,
+//	until it's out of our retries too, and then it's dropped and reported.
+//	Either way the rest of the FIFO, which we still have copies of, is
+//	flushed and loaded again, since the module can't take the failed one
+//	out on its own. Payloads to other boards go first while we wait.
+void wl_module_tx_failed(void)
+{
+	unsigned char dest;
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		unsigned char seq;
+	#endif
+
+	wl_module_CE_lo;
+	wl_module_send_command(FLUSH_TX, NULL, NULL, 0);
+
+	if (wl_tx_loaded != 0)
+	{
+		dest = wl_tx_ring[wl_module_tx_skip_wrap(wl_tx_head) + 1];
+		#if (THIS_PLAYER == MASTER_PLAYER)
+			seq = wl_tx_ring[wl_module_tx_skip_wrap(wl_tx_head) + WL_TX_ENTRY_HDR];
+		#endif
+
+		if ( (dest < NUM_PLAYERS) && (wl_tx_tries[dest] < WL_TX_SW_RETRIES) )
+		{
+			wl_tx_held |= PLAYER_BIT(dest);
+			wl_tx_retry_at[dest] = sched_get_ms() + (WL_TX_BACKOFF_MS << wl_tx_tries[dest]);
+			wl_tx_tries[dest]++;
+			wl_tx_retries++;
+			#if (THIS_PLAYER == MASTER_PLAYER)
+				wl_link_lost[dest]++;
+			#endif
+		}
+		else
+		{
+			// Keep what was in it, so the messages which matter can be
+			//	sent again. If the main loop hasn't got to the last one
+			//	yet, only the event goes.
+			#if (THIS_PLAYER == MASTER_PLAYER)
+				if ( (dest < NUM_PLAYERS) && (wl_tx_lost_len == 0) )
+				{
+					wl_module_tx_keep_lost();
+				}
+			#endif
+
+			wl_module_tx_pop();
+			wl_tx_loaded--;
+			event_post(EVENT_TX_FAILED, dest);
+			wl_tx_failures++;
+			if (dest < NUM_PLAYERS)
+			{
+				wl_tx_tries[dest] = 0;
+			}
+
+			// If it was the MSG_RATE, the slave either never heard it or
+			//	goes back to the old rate when we don't follow, so stay
+			//	there and give it time to. Otherwise we can't tell what
+			//	rate the slave is at now, so go back to the base rate,
+			//	where it goes once it's lost us.
+			#if (THIS_PLAYER == MASTER_PLAYER)
+				if (dest < NUM_PLAYERS)
+				{
+					wl_link_lost[dest]++;
+					wl_rate_clean[dest] = 0;
+					if ( (wl_rate_pending[dest] != WL_RATE_NONE) && (seq == wl_rate_seq[dest]) )
+					{
+						wl_rate_pending[dest] = WL_RATE_NONE;
+						wl_tx_held |= PLAYER_BIT(dest);
+						wl_tx_retry_at[dest] = sched_get_ms() + WL_RATE_TRY_MS;
+					}
+					else
+					{
+						wl_rate[dest] = WL_RATE_BASE;
+
+						// And don't keep the radio busy polling it
+						poll_note_failed(dest);
+					}
+				}
+			#endif
+		}
+	}
+
+	// Everything else that was in the FIFO goes back to waiting
+	wl_tx_load = wl_tx_head;
+	wl_tx_queued += wl_tx_loaded;
+	wl_tx_loaded = 0;
+
+	wl_module_tx_pump();
+}
+
+// This function takes the payload at the head off the ring, once the
+//	module is done with it, and returns who it was for. The caller counts
+//	it off wherever it was.
+unsigned char wl_module_tx_pop(void)
+{
+	unsigned char dest;
+
+	// Give back the skipped end of the ring along with it
+	if (wl_tx_ring[wl_tx_head] == WL_TX_WRAP)
+	{
+		wl_tx_used -= WL_TX_RING_SIZE - wl_tx_head;
+		wl_tx_head = 0;
+	}
+
+	dest = wl_tx_ring[wl_tx_head + 1];
+	wl_tx_used -= wl_tx_ring[wl_tx_head] + WL_TX_ENTRY_HDR;
+	wl_tx_head = wl_module_tx_next(wl_tx_head);
+
+	return dest;
+}
+
+// This function moves the payload at the head to the end of the ring.
+//	The module mustn't have anything, so that the head is the next one
+//	to load. There's always room for it, since it's just come off.
+void wl_module_tx_requeue(void)
+{
+	unsigned char buf[wl_module_PAYLOAD_LEN];
+	unsigned char idx;
+	unsigned char len;
+	unsigned char dest;
+	unsigned char i;
+
+	idx = wl_module_tx_skip_wrap(wl_tx_head);
+	len = wl_tx_ring[idx];
+	for (i = 0; i < len; i++)
+	{
+		buf[i] = wl_tx_ring[idx + WL_TX_ENTRY_HDR + i];
+	}
+
+	dest = wl_module_tx_pop();
+	wl_tx_queued--;
+	wl_tx_load = wl_tx_head;
+
+	wl_module_tx_append(buf, len, dest);
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This function copies the messages in the payload at the head into the
+//	lost payload
+void wl_module_tx_keep_lost(void)
+{
+	unsigned char idx;
+	unsigned char i;
+
+	idx = wl_module_tx_skip_wrap(wl_tx_head);
+	wl_tx_lost_len = wl_tx_ring[idx] - WL_LINK_HDR_LEN;
+	for (i = 0; i < wl_tx_lost_len; i++)
+	{
+		wl_tx_lost[i] = wl_tx_ring[idx + WL_TX_ENTRY_HDR + WL_LINK_HDR_LEN + i];
+	}
+}
+
+// This function copies the messages in the last payload which was never
+//	ACKed into the passed buffer, which has to be WL_MSG_PAYLOAD_LEN
+//	bytes, and returns their length. It returns 0 if there isn't one.
+unsigned char wl_module_tx_take_lost(unsigned char * buf)
+{
+	unsigned char len;
+	unsigned char i;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	len = wl_tx_lost_len;
+	for (i = 0; i < len; i++)
+	{
+		buf[i] = wl_tx_lost[i];
+	}
+	wl_tx_lost_len = 0;
+
+	CRIT_EXIT(ipl);
+
+	return len;
+}
+
+// This function writes out how many payloads to the passed slave were
+//	ACKed, and how many needed our retries or failed, since the last
+//	time it was called
+void wl_module_tx_take_link_stats(unsigned char player, unsigned * delivered, unsigned * lost)
+{
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	*delivered = wl_link_delivered[player];
+	*lost = wl_link_lost[player];
+	wl_link_delivered[player] = 0;
+	wl_link_lost[player] = 0;
+
+	CRIT_EXIT(ipl);
+}
+
+#endif
+
+// This function returns 1 if we're backing off from the passed board
+int wl_module_tx_is_held(unsigned char dest)
+{
+	return ( (dest < NUM_PLAYERS) && (wl_tx_held & PLAYER_BIT(dest)) );
+}
+
+// This function returns 1 if any payload the module doesn't have yet is
+//	for a board we aren't backing off from
+int wl_module_tx_any_ready(void)
+{
+	unsigned char idx = wl_tx_load;
+	unsigned char i;
+
+	for (i = 0; i < wl_tx_queued; i++)
+	{
+		idx = wl_module_tx_skip_wrap(idx);
+		if (!wl_module_tx_is_held(wl_tx_ring[idx + 1]))
+		{
+			return 1;
+		}
+		idx = wl_module_tx_next(idx);
+	}
+
+	return 0;
+}
+
+// This function returns where the entry at idx really is, which is the
+//	start of the ring if the end was skipped
+unsigned char wl_module_tx_skip_wrap(unsigned char idx)
+{
+	if (wl_tx_ring[idx] == WL_TX_WRAP)
+	{
+		return 0;
+	}
+
+	return idx;
+}
+
+// This function returns where the entry after the one at idx starts
+unsigned char wl_module_tx_next(unsigned char idx)
+{
+	idx += wl_tx_ring[idx] + WL_TX_ENTRY_HDR;
+	if (idx >= WL_TX_RING_SIZE)
+	{
+		idx = 0;
+	}
+
+	return idx;
+}
+
+// This function lets payloads to a board go again once its backoff is
+//	up. It's called every timer 2 tick.
+void wl_module_tx_service(void)
+{
+	unsigned char i;
+	unsigned ipl;
+
+	CRIT_ENTER(ipl, CRIT_SHARED_IPL);
+
+	if (wl_tx_held != 0)
+	{
+		for (i = 0; i < NUM_PLAYERS; i++)
+		{
+			if ( (wl_tx_held & PLAYER_BIT(i)) && sched_ms_passed(wl_tx_retry_at[i]) )
+			{
+				wl_tx_held &= ~PLAYER_BIT(i);
+			}
+		}
+
+		wl_module_tx_pump();
+	}
+
+	CRIT_EXIT(ipl);
+}
+
+// This function returns 1 if there are payloads which haven't gone yet
+int wl_module_tx_busy(void)
+{
+	return (wl_tx_used != 0);
+}
+
+// This function returns 1 if we're waiting to send a payload again.
+//	Timer 2 has to keep running until then.
+int wl_module_tx_backing_off(void)
+{
+	return (wl_tx_held != 0);
+}
+
+// This function returns how many payloads were ACKed. Along with the
+//	failures, that's the delivery rate.
+unsigned wl_module_tx_get_delivered(void)
+{
+	return wl_tx_delivered;
+}
+
+// This function returns how many times we sent a payload again ourselves
+unsigned wl_module_tx_get_retries(void)
+{
+	return wl_tx_retries;
+}
+
+// This function returns how many payloads were never ACKed
+unsigned wl_module_tx_get_failures(void)
+{
+	return wl_tx_failures;
+}
+
+// This function returns how many payloads we threw away for having
+//	already got them
+unsigned wl_module_rx_get_dups(void)
+{
+	return wl_rx_dups;
 }
 
 // The wireless module interrupt handler, based of INT2
 void _ISR _INT2Interrupt(void)
 {
 	unsigned char status;
-	unsigned char rfid_cs_val;
 
-	// Pull the RFID chip select high
-	// rfid_cs_val = RFID_CS;
-	// RFID_CS = 1;
+    // Clear the INT2 flag first, so that an edge which comes while we're
+    //  in here isn't lost
+    IFS1bits.INT2IF = 0;
+
+    // Handle the radio at full speed
+    clock_boost();
 
     // Read wl_module status
     status = wl_module_get_status();
 
 
+    // An ACK payload comes in along with the TX_DS for what it ACKed, so
+    //  get it before the next payload can change who we're pointed at
+	if (status & (1<<RX_DR)){ // IRQ: Packages have come in
+		wl_module_write_register_byte(STATUS, (1<<RX_DR)); //Clear Interrupt Bit
+		wl_module_rx_drain();	// Get them all out, and leave them to the main loop
+	}
+
     if (status & (1<<TX_DS)){ // IRQ: Package has been sent
     	// display_write_line(0, "PACKET SENT");
 	    wl_module_write_register_byte(STATUS, (1<<TX_DS)); //Clear Interrupt Bit
-	    // PTX=0;
+	    wl_module_tx_sent();	// And give the module the next one
     }
 
-	if (status & (1<<MAX_RT)){ // IRQ: Package has not been sent, oh well.
+	if (status & (1<<MAX_RT)){ // IRQ: Package has not been sent
 		// display_write_line(0, "PACKET NOT SENT");
 		wl_module_write_register_byte(STATUS, (1<<MAX_RT));	// Clear Interrupt Bit
-		// wl_module_start_transmit();
+		wl_module_tx_failed();	// Report it, and carry on with the rest
 	}
 
-	if (status & (1<<RX_DR)){
-		wl_module_get_payload((unsigned char *)&pload_data); // And get the data
-		wl_module_write_register_byte(STATUS, (1<<RX_DR)); //Clear Interrupt Bit
-		parse_message(pload_data.type, pload_data.request, pload_data.sender, pload_data.recipient, pload_data.val); // Parse the message
-	}
-
-	// Reset the RFID CS to what it was previously
-	// RFID_CS = rfid_cs_val;
-
-    // reset INT2 flag
-    IFS1bits.INT2IF = 0;
+    clock_release();
 }
 
 
@@ -40,9 +40,9 @@
 
 // WL-Module settings
 #define wl_module_CH			2
-#define wl_module_PAYLOAD_LEN	(sizeof(spaceteam_packet_t))
+#define wl_module_PAYLOAD_LEN	32		// The longest payload; they're dynamic
 #define wl_module_RF_DR_HIGH	0		//0 = 1Mbps, 1 = 2Mpbs
-#define wl_module_RF_SETUP		(RF_SETUP_RF_PWR_0 | RF_SETUP_RF_DR_250)
+#define wl_module_RF_SETUP		(RF_SETUP_RF_PWR_0 | RF_SETUP_RF_DR_250)	// The base rate
 #define wl_module_CONFIG		( (1<<EN_CRC) | (1<<CRCO) )
 #define wl_module_TX_NR_0		0
 #define wl_module_TX_NR_1		1
@@ -51,8 +51,128 @@
 #define wl_module_TX_NR_4		4
 #define wl_module_TX_NR_5		5
 
+// The module retries a payload that isn't ACKed this many times on its
+//	own. The delay has to cover a whole 32 byte ACK payload at 250 kbps.
+#define wl_module_RETR			(SETUP_RETR_ARD_1500 | SETUP_RETR_ARC_5)
+
 #define wl_module_ADDR_LEN      5
 
+// Every board's address is the same but for the low byte, so the master
+//	can send to someone else by rewriting just that byte of TX_ADDR and
+//	RX_ADDR_P0. The low byte goes first over the SPI.
+#define WL_ADDR_LSB_BASE		0xC0
+#define WL_ADDR_LSB(player)		(WL_ADDR_LSB_BASE + (player))
+
+// The pipes. The master hears the ACKs from whoever it's sending to on
+//	pipe 0, as the module requires, and a slave hears the master on its
+//	own address on pipe 1. The other pipes share pipe 1's upper address
+//	bytes, so more of them only cost a byte each.
+#define WL_PIPE_ACK				0
+#define WL_PIPE_MASTER			1
+#define WL_PIPE_BCAST			2		// Everyone's, at WL_ADDR_LSB(ALL_PLAYERS)
+#define WL_PIPE_EMPTY			7		// RX_P_NO when the RX FIFO is empty
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+	#define WL_PIPES			(1 << WL_PIPE_ACK)
+#else
+	#define WL_PIPES			( (1 << WL_PIPE_MASTER) | (1 << WL_PIPE_BCAST) )
+#endif
+
+#define WL_NUM_PIPES			6
+
+// Every payload the master sends starts with a sequence number for the
+//	link it's on, a slave or everyone. A payload can arrive twice, when
+//	its ACK was lost and we sent it again or when it's a broadcast, so a
+//	slave throws away one with the same sequence number as the last it
+//	took on that pipe within WL_RX_DEDUP_MS of it.
+#define WL_LINK_HDR_LEN			1
+#define WL_RX_DEDUP_MS			100
+
+// The most messages which fit in one of our payloads
+#if (THIS_PLAYER == MASTER_PLAYER)
+	#define WL_MSG_PAYLOAD_LEN	(wl_module_PAYLOAD_LEN - WL_LINK_HDR_LEN)
+#else
+	#define WL_MSG_PAYLOAD_LEN	wl_module_PAYLOAD_LEN
+#endif
+
+// Messages to ALL_PLAYERS are sent to the broadcast address without an
+//	ACK, so one payload reaches every slave. Since nobody ACKs it, it's
+//	sent WL_BCAST_REPEATS times.
+#define WL_BCAST_REPEATS		3
+
+// The data rates a link can run at, slowest first. Every link starts at
+//	the slowest, which reaches the furthest. The master moves a slave up
+//	a rate after WL_RATE_UP_AFTER payloads in a row got through on the
+//	first try, and down one when a payload took WL_RATE_DOWN_ARC or more
+//	of the module's retries. The slave is told with MSG_RATE, and the
+//	master follows once that's ACKed. If a payload fails outright, the
+//	master drops back to the base rate, and so does the slave once it
+//	hasn't heard from the master in a while.
+//
+// The ACK to the MSG_RATE can be lost after the slave has moved, so the
+//	slave only keeps the new rate once something new from the master
+//	has come in at it. If nothing has in WL_RATE_TRY_MS, it goes back to
+//	the old one. If the MSG_RATE itself fails, the master stays at the
+//	old rate and holds the slave off for WL_RATE_TRY_MS, so that it's
+//	back there before it's sent anything else. That's longer than the
+//	master takes to give up on a payload, and than it leaves a slave in
+//	a game without a poll, and shorter than CHAN_LOST_MS.
+#define WL_RATE_250K			0
+#define WL_RATE_1M				1
+#define WL_RATE_2M				2
+#define WL_NUM_RATES			3
+#define WL_RATE_BASE			WL_RATE_250K
+#define WL_RATE_NONE			0xFF	// No change is under way
+#define WL_RATE_UP_AFTER		64
+#define WL_RATE_DOWN_ARC		3
+#define WL_RATE_TRY_MS			128
+
+// A broadcast has to go out at every rate a slave might be listening at,
+//	so its destination in the TX ring has the rate above the player
+#define WL_DEST_MASK			0x0F
+#define WL_DEST_RATE_SHIFT		4
+
+// Once the module gives up on a payload, we try it again ourselves
+//	after a wait which doubles each time, starting at WL_TX_BACKOFF_MS,
+//	up to WL_TX_SW_RETRIES times before it's reported as failed. Only
+//	the board it was for waits; payloads to it go to the back of the
+//	ring so the ones to everyone else go out in the meantime. That can
+//	change the order of the ones to it, so the count is the board's
+//	rather than the payload's. It starts again whenever anything gets
+//	through to the board, and the one which fails last is reported.
+#define WL_TX_SW_RETRIES		3
+#define WL_TX_BACKOFF_MS		2
+
+// The payloads waiting to be sent are kept in a ring, each one as a
+//	length byte, a destination byte and then the payload. They stay in
+//	it until the module says they've gone, so that the module's TX FIFO
+//	can be flushed after a failure without losing the ones behind it.
+#define WL_TX_RING_SIZE			64
+#define WL_TX_ENTRY_HDR			2
+#define WL_TX_WRAP				0		// A length which means skip to the start
+#define WL_TX_NO_DEST			0xFF	// The address isn't set for anyone yet
+
+// The payloads which have come in are kept in a ring the same way, each
+//	one as a length byte, the player it came from and then the payload,
+//	until the main loop parses them. It holds a few short ones, and the module's RX FIFO holds three
+//	more while it's full.
+#define WL_RX_RING_SIZE			64
+#define WL_RX_ENTRY_HDR			2
+#define WL_RX_WRAP				0		// A length which means skip to the start
+#define WL_RX_FULL				0xFF	// No room for a payload
+
+// How many payloads the module's TX FIFO holds
+#define WL_TX_FIFO_DEPTH		3
+
+// Time the module takes to go from power down to standby once it's
+//	powered up, in us. There's no status bit for this, so it has to be
+//	waited out.
+#define WL_STANDBY_US			1500
+
+// How long the module has to listen on a channel before its received
+//	power detector says anything: the RX settling time and then 40 us
+#define WL_RPD_SETTLE_US		200
+
 // Pin definitions for chip select and chip enabled of the wl-module
 #define wl_module_CE    LATBbits.LATB15 // RA6
 #define wl_module_CSN   LATAbits.LATA7 // RA7
@@ -69,16 +189,63 @@
 
 // Function declarations
 void init_wireless(void);
-void wl_module_set_address(unsigned char * address);
+int wl_module_prepare(void);
+int wl_module_is_alive(void);
+int wl_module_configure(void);
+int wl_module_start(void);
+void wl_module_write_address(unsigned char reg, unsigned char player);
+void wl_module_set_dest(unsigned char player);
+unsigned char wl_module_pipe_player(unsigned char pipe);
 unsigned char wl_module_get_status(void);
-void wl_module_send_command(unsigned char command, unsigned char * datain, unsigned char * dataout, unsigned char data_len);
+void wl_module_send_command(unsigned char command, const unsigned char * datain, unsigned char * dataout, unsigned char data_len);
 void wl_module_read_register(unsigned char reg, unsigned char * value, unsigned char len);
 unsigned char wl_module_read_register_byte(unsigned char reg);
-void wl_module_write_register(unsigned char reg, unsigned char * value, unsigned char len);
+void wl_module_read_registers(const unsigned char * regs, unsigned char * vals, unsigned char len);
+void wl_module_write_register(unsigned char reg, const unsigned char * value, unsigned char len);
 void wl_module_write_register_byte(unsigned char reg, unsigned char value);
-void wl_module_get_payload(unsigned char * pload);
-void wl_module_send_payload(unsigned char * pload, spaceteam_player_t player);
-void wl_module_start_transmit(void);
-void wl_module_send_ack(unsigned char * pload);
+void wl_module_rx_drain(void);
+unsigned char wl_module_rx_reserve(unsigned char need);
+void wl_module_rx_service(void);
+int wl_module_rx_pending(void);
+int wl_module_send_payload(const unsigned char * pload, unsigned char len, spaceteam_player_t player);
+int wl_module_send_ack(const unsigned char * pload, unsigned char len);
+void wl_module_set_channel(unsigned char channel);
+void wl_module_set_rate(unsigned char rate);
+unsigned char wl_module_get_rate(void);
+void wl_module_rate_reset(void);
+unsigned char wl_module_entry_rate(unsigned char dest);
+unsigned char wl_module_rates_in_use(void);
+void wl_module_rate_acked(unsigned char dest, unsigned char seq);
+void wl_module_rate_note(unsigned char dest, unsigned char arc);
+void wl_module_rate_propose(unsigned char player, unsigned char rate);
+unsigned char wl_module_get_link_rate(unsigned char player);
+void wl_module_rate_try(unsigned char rate);
+void wl_module_rate_service(void);
+int wl_module_rate_trying(void);
+unsigned char wl_module_carrier_count(unsigned char channel, unsigned char samples);
+int wl_module_send_broadcast(const unsigned char * pload, unsigned char len);
+int wl_module_send_link(const unsigned char * pload, unsigned char len, unsigned char dest, unsigned char copies);
+void wl_module_tx_reset(void);
+int wl_module_tx_queue(const unsigned char * pload, unsigned char len, unsigned char dest);
+void wl_module_tx_pump(void);
+void wl_module_tx_sent(void);
+void wl_module_tx_failed(void);
+int wl_module_tx_append(const unsigned char * pload, unsigned char len, unsigned char dest);
+unsigned char wl_module_tx_pop(void);
+void wl_module_tx_requeue(void);
+void wl_module_tx_keep_lost(void);
+unsigned char wl_module_tx_take_lost(unsigned char * buf);
+void wl_module_tx_take_link_stats(unsigned char player, unsigned * delivered, unsigned * lost);
+int wl_module_tx_is_held(unsigned char dest);
+int wl_module_tx_any_ready(void);
+unsigned char wl_module_tx_skip_wrap(unsigned char idx);
+unsigned char wl_module_tx_next(unsigned char idx);
+void wl_module_tx_service(void);
+int wl_module_tx_busy(void);
+int wl_module_tx_backing_off(void);
+unsigned wl_module_tx_get_delivered(void);
+unsigned wl_module_tx_get_retries(void);
+unsigned wl_module_tx_get_failures(void);
+unsigned wl_module_rx_get_dups(void);
 
 #endif /* _WL_MODULE_H_ */
@@ -0,0 +1,223 @@
+//
+// This file is the board simulation which the host tests share. The
+//	radio here never touches the SPI: it keeps the payloads it was asked
+//	to send and hands them to the test. The board runs just as it does
+//	on the PIC, with timer 2 every ms, timer 1 every SIM_T1_MS and a
+//	pass of the main loop in between.
+//
+
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_power.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_wireless.h"
+#include "sim.h"
+
+// From spaceteam_msg.c and spaceteam_game.c
+extern unsigned char msg_agg_len;
+void init_game_vars(void);
+
+void (*sim_radio_hook)(unsigned char dest, const unsigned char * buf, unsigned char len);
+int sim_radio_status;
+sim_payload_t sim_log[SIM_LOG_LEN];
+unsigned sim_log_len;
+unsigned long sim_payloads;
+unsigned long sim_packets;
+unsigned long sim_ms;
+
+// The simulation's own random numbers, so that the board's are left to
+//	it. A 32-bit xorshift.
+unsigned long sim_seed = 0x2545F491;
+
+// This function returns a random number
+unsigned long sim_random(void)
+{
+	sim_seed ^= (sim_seed << 13) & 0xFFFFFFFF;
+	sim_seed ^= (sim_seed >> 17);
+	sim_seed ^= (sim_seed << 5) & 0xFFFFFFFF;
+
+	return sim_seed & 0xFFFFFFFF;
+}
+
+// This function returns a random number in the range [0, range)
+unsigned sim_random_in(unsigned range)
+{
+	return sim_random() % range;
+}
+
+// The radio. It keeps the payload, counts the messages in it and passes
+//	it on.
+int wl_module_send_payload(const unsigned char * pload, unsigned char len, spaceteam_player_t player)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos = 0;
+	unsigned char used;
+
+	if (sim_radio_status != SUCCESS)
+	{
+		return sim_radio_status;
+	}
+
+	if (sim_log_len == SIM_LOG_LEN)
+	{
+		memmove(&sim_log[0], &sim_log[1], sizeof(sim_log) - sizeof(sim_log[0]));
+		sim_log_len--;
+	}
+	sim_log[sim_log_len].dest = player;
+	sim_log[sim_log_len].len = len;
+	memcpy(sim_log[sim_log_len].buf, pload, len);
+	sim_log_len++;
+
+	sim_payloads++;
+	while ( (pos < len) && ((used = msg_unpack(&pload[pos], len - pos, &packet)) != 0) )
+	{
+		sim_packets++;
+		pos += used;
+	}
+
+	if (sim_radio_hook != NULL)
+	{
+		sim_radio_hook(player, pload, len);
+	}
+
+	return SUCCESS;
+}
+
+int wl_module_send_broadcast(const unsigned char * pload, unsigned char len)
+{
+	return wl_module_send_payload(pload, len, ALL_PLAYERS);
+}
+
+int wl_module_send_ack(const unsigned char * pload, unsigned char len)
+{
+	return wl_module_send_payload(pload, len, MASTER_PLAYER);
+}
+
+// Nothing is ever lost, and nothing is ever in the air
+unsigned char wl_module_tx_take_lost(unsigned char * buf)
+{
+	return 0;
+}
+
+int wl_module_tx_busy(void)
+{
+	return 0;
+}
+
+// This function resets the board as if it had just been powered on,
+//	less the devices
+void sim_reset(void)
+{
+	// The switches are pulled up, so nothing is pressed
+	PORTAbits.RA4 = 1;
+	TIMER_1_INT_ENABLE = 0;
+
+	init_pools();
+	init_events();
+	init_sched();
+	init_power();
+	msg_agg_len = 0;
+	init_game_vars();
+
+	sim_radio_hook = NULL;
+	sim_radio_status = SUCCESS;
+	sim_payloads = 0;
+	sim_packets = 0;
+	sim_ms = 0;
+	sim_clear_log();
+}
+
+// This function starts a game with the passed players, as a bit per
+//	player, with every board having every input
+void sim_start_game(unsigned char players)
+{
+	int i;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if ( (i != THIS_PLAYER) && (players & PLAYER_BIT(i)) )
+		{
+			register_player(i, THIS_BOARD_INPUTS);
+		}
+	}
+
+	// The seed comes from timer 1
+	TMR1 = sim_random();
+	begin_game();
+}
+
+// This function runs the board for a ms
+void sim_tick(void)
+{
+	sim_ms++;
+
+	_T2Interrupt();
+	if ( ((sim_ms % SIM_T1_MS) == 0) && TIMER_1_INT_ENABLE )
+	{
+		_T1Interrupt();
+	}
+
+	sched_run();
+	prepare_next_request();
+	process_events();
+	checkpoint_service();
+}
+
+// This function runs the board for the passed number of ms
+void sim_run_ms(unsigned long ms)
+{
+	while (ms-- != 0)
+	{
+		sim_tick();
+	}
+}
+
+// This function hands the board a message which came over the air, just
+//	as the radio's receive side would
+void sim_receive(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned short val)
+{
+	parse_message(msg, req, sender, recipient, val);
+}
+
+// This function forgets the payloads sent so far
+void sim_clear_log(void)
+{
+	sim_log_len = 0;
+}
+
+// This function returns 1 if a payload to the passed board has the passed
+//	message in it
+int sim_find(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned char dest)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos;
+	unsigned char used;
+	unsigned i;
+
+	for (i = 0; i < sim_log_len; i++)
+	{
+		if (sim_log[i].dest != dest)
+		{
+			continue;
+		}
+
+		pos = 0;
+		while ( (pos < sim_log[i].len) && ((used = msg_unpack(&sim_log[i].buf[pos], sim_log[i].len - pos, &packet)) != 0) )
+		{
+			if ( (packet.type == msg) && (packet.request == req) &&
+				 (packet.sender == sender) && (packet.recipient == recipient) )
+			{
+				return 1;
+			}
+			pos += used;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+//
+// This is the include file for the board simulation which the host tests
+//	share. It stands in for the radio, so that the payloads the board
+//	sends can be looked at or handed on to the other boards, which the
+//	test plays itself. And it runs the board's interrupts and main loop
+//	off a simulated clock, a millisecond at a time.
+//
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_wireless.h"
+
+// Timer 1 counts 64K at 1/256 of the 8MHz clock, so it goes off about
+//	every 2.1s
+#define SIM_T1_MS				2097
+
+// The number of payloads the radio keeps, newest last
+#define SIM_LOG_LEN				32
+
+// A payload which the board handed to the radio, and who it was for
+typedef struct _sim_payload_t
+{
+	unsigned char dest;
+	unsigned char len;
+	unsigned char buf[wl_module_PAYLOAD_LEN];
+} sim_payload_t;
+
+// Called with each payload the board sends, if it's set. The test passes
+//	it on to the boards it plays. It's called from inside the message
+//	code, so it mustn't send anything to the board itself.
+extern void (*sim_radio_hook)(unsigned char dest, const unsigned char * buf, unsigned char len);
+
+// What the radio answers the board with, SUCCESS unless a test is
+//	filling up its queue
+extern int sim_radio_status;
+
+// The payloads sent, and how many of them and of the messages in them
+//	there have been
+extern sim_payload_t sim_log[SIM_LOG_LEN];
+extern unsigned sim_log_len;
+extern unsigned long sim_payloads;
+extern unsigned long sim_packets;
+
+// The simulated time, in ms
+extern unsigned long sim_ms;
+
+//
+// Function declarations
+//
+unsigned long sim_random(void);
+unsigned sim_random_in(unsigned range);
+void sim_reset(void);
+void sim_start_game(unsigned char players);
+void sim_tick(void);
+void sim_run_ms(unsigned long ms);
+void sim_receive(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned short val);
+void sim_clear_log(void);
+int sim_find(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned char dest);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,24 @@
+//
+// This is a stand-in for the XC16 support library, for the tests. The
+//	data EEPROM is just the array it's declared as, so a program address
+//	is a pointer to it, and erasing and writing a word happen at once.
+//
+
+#ifndef LIBPIC30_H_
+#define LIBPIC30_H_
+
+typedef unsigned long _prog_addressT;
+
+#define _EE_WORD	2
+
+#define _init_prog_address(addr, var)	((addr) = (_prog_addressT)(&(var)))
+
+#define __delay_us(us)	((void)(us))
+#define __delay_ms(ms)	((void)(ms))
+
+void _erase_eedata(_prog_addressT dst, int len);
+void _write_eedata_word(_prog_addressT dst, int data);
+_prog_addressT _memcpy_p2d16(char * dest, _prog_addressT src, unsigned int len);
+void __delay32(unsigned long cycles);
+
+#endif /* LIBPIC30_H_ */
@@ -0,0 +1,5 @@
+//
+// The radio's register header is nRF24L01.h, which the PIC tools find
+//	by either name but the host doesn't.
+//
+#include "nRF24L01.h"
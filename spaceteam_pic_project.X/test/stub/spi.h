@@ -0,0 +1,5 @@
+//
+// This is a stand-in for the XC16 peripheral library's SPI header, for
+//	the tests. The game drives the SPI module through spaceteam_spi.c,
+//	so nothing from it is needed.
+//
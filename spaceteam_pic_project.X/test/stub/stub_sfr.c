@@ -0,0 +1,145 @@
+//
+// This file holds the registers and support library functions which
+//	the stand-in headers declare. The flags which the game spins on are
+//	left set, so that a transfer or conversion is always done, and the
+//	SPI and the delays count the cycles they'd take instead of taking them.
+//
+
+#include <string.h>
+#include "xc.h"
+#include <libpic30.h>
+
+volatile unsigned AD1CHS;
+volatile unsigned AD1CON1;
+volatile unsigned AD1CON2;
+volatile unsigned AD1CON3;
+volatile unsigned ADC1BUF0;
+volatile unsigned ANSA;
+volatile unsigned ANSB;
+volatile unsigned LATA;
+volatile unsigned LATB;
+volatile unsigned PORTA;
+volatile unsigned PORTB;
+volatile unsigned TRISA;
+volatile unsigned TRISB;
+volatile unsigned PR1;
+volatile unsigned PR2;
+volatile unsigned PR3;
+volatile unsigned PR4;
+volatile unsigned T1CON;
+volatile unsigned T2CON;
+volatile unsigned T3CON;
+volatile unsigned T4CON;
+volatile unsigned TMR1;
+volatile unsigned TMR2;
+volatile unsigned TMR3;
+volatile unsigned TMR4;
+volatile unsigned SSP1BUF;
+volatile unsigned SSP1CON1;
+volatile unsigned SSP1CON2;
+volatile unsigned SSP1CON3;
+volatile unsigned SSP1STAT;
+volatile unsigned SR;
+volatile unsigned CLKDIV;
+volatile unsigned OSCCON;
+volatile unsigned NVMCON;
+volatile unsigned RCON;
+
+volatile sfrbits_t AD1CON1bits = { .DONE = 1 };
+volatile sfrbits_t CLKDIVbits;
+volatile sfrbits_t IEC0bits;
+volatile sfrbits_t IEC1bits;
+volatile sfrbits_t IFS0bits;
+volatile sfrbits_t IFS1bits;
+volatile sfrbits_t INTCON2bits;
+volatile sfrbits_t IPC0bits;
+volatile sfrbits_t IPC1bits;
+volatile sfrbits_t IPC2bits;
+volatile sfrbits_t IPC3bits;
+volatile sfrbits_t IPC6bits;
+volatile sfrbits_t IPC7bits;
+volatile sfrbits_t LATAbits;
+volatile sfrbits_t LATBbits;
+volatile sfrbits_t PORTAbits;
+volatile sfrbits_t PORTBbits;
+volatile sfrbits_t NVMCONbits;
+volatile sfrbits_t RCONbits;
+
+// These two are only got at through stub_sr and stub_spi_stat
+static volatile sfrbits_t sr_bits;
+static volatile sfrbits_t ssp1stat_bits = { .BF = 1 };
+
+unsigned long stub_cycles;
+unsigned stub_mask_ipl = 8;
+unsigned long stub_masked;
+unsigned long stub_masked_max;
+
+// This function counts the passed number of cycles, at the CPU priority
+//	we're at now
+void stub_spend(unsigned long cycles)
+{
+	stub_cycles += cycles;
+
+	if (sr_bits.IPL >= stub_mask_ipl)
+	{
+		stub_masked += cycles;
+		if (stub_masked > stub_masked_max)
+		{
+			stub_masked_max = stub_masked;
+		}
+	}
+	else
+	{
+		stub_masked = 0;
+	}
+}
+
+volatile sfrbits_t * stub_sr(void)
+{
+	stub_spend(STUB_SR_CYCLES);
+
+	return &sr_bits;
+}
+
+// spi_write looks at the status once a byte, after it's written the
+//	buffer. The bus runs at Fcy whether or not the CPU is dozing.
+volatile sfrbits_t * stub_spi_stat(void)
+{
+	unsigned long code = STUB_SPI_CODE_CYCLES;
+
+	if (CLKDIVbits.DOZEN)
+	{
+		code <<= CLKDIVbits.DOZE;
+	}
+	stub_spend(STUB_SPI_BUS_CYCLES + code);
+
+	return &ssp1stat_bits;
+}
+
+// The cycles are the CPU's, so they're longer while it's dozing
+void __delay32(unsigned long cycles)
+{
+	if (CLKDIVbits.DOZEN)
+	{
+		cycles <<= CLKDIVbits.DOZE;
+	}
+	stub_spend(cycles);
+}
+
+// An erased EEPROM word reads back as all ones
+void _erase_eedata(_prog_addressT dst, int len)
+{
+	memset((void *)dst, 0xFF, len);
+}
+
+void _write_eedata_word(_prog_addressT dst, int data)
+{
+	*(unsigned short *)dst = (unsigned short)data;
+}
+
+_prog_addressT _memcpy_p2d16(char * dest, _prog_addressT src, unsigned int len)
+{
+	memcpy(dest, (const void *)src, len);
+
+	return src + len;
+}
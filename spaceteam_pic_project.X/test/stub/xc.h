@@ -0,0 +1,110 @@
+//
+// This is a stand-in for the XC16 device header, for building the game
+//	on the host for the tests. The registers are plain variables which
+//	the tests can set and look at, and every bit field is a whole word
+//	so one struct does for all of them.
+//
+
+#ifndef XC_H_
+#define XC_H_
+
+typedef struct _sfrbits_t
+{
+	unsigned ADON, DONE, SAMP, BF, IPL, BOR, POR, SWDTEN, WDTO, WR;
+	unsigned DOZE, DOZEN, ROI;
+	unsigned INT2IE, INT2IF, INT2EP, INT2IP;
+	unsigned T1IE, T1IP, T1IF, T2IE, T2IP, T2IF, T3IE, T3IP, T3IF, T4IE, T4IP, T4IF;
+	unsigned NVMIE, NVMIF, NVMIP;
+	unsigned LATA0, LATA1, LATA2, LATA3, LATA4, LATA5, LATA6, LATA7;
+	unsigned LATB0, LATB1, LATB2, LATB3, LATB4, LATB5, LATB6, LATB7;
+	unsigned LATB8, LATB9, LATB10, LATB11, LATB12, LATB13, LATB14, LATB15;
+	unsigned RA4, RB10, RB14, RB15;
+} sfrbits_t;
+
+extern volatile unsigned AD1CHS;
+extern volatile unsigned AD1CON1;
+extern volatile unsigned AD1CON2;
+extern volatile unsigned AD1CON3;
+extern volatile unsigned ADC1BUF0;
+extern volatile unsigned ANSA;
+extern volatile unsigned ANSB;
+extern volatile unsigned LATA;
+extern volatile unsigned LATB;
+extern volatile unsigned PORTA;
+extern volatile unsigned PORTB;
+extern volatile unsigned TRISA;
+extern volatile unsigned TRISB;
+extern volatile unsigned PR1;
+extern volatile unsigned PR2;
+extern volatile unsigned PR3;
+extern volatile unsigned PR4;
+extern volatile unsigned T1CON;
+extern volatile unsigned T2CON;
+extern volatile unsigned T3CON;
+extern volatile unsigned T4CON;
+extern volatile unsigned TMR1;
+extern volatile unsigned TMR2;
+extern volatile unsigned TMR3;
+extern volatile unsigned TMR4;
+extern volatile unsigned SSP1BUF;
+extern volatile unsigned SSP1CON1;
+extern volatile unsigned SSP1CON2;
+extern volatile unsigned SSP1CON3;
+extern volatile unsigned SSP1STAT;
+extern volatile unsigned SR;
+extern volatile unsigned CLKDIV;
+extern volatile unsigned OSCCON;
+extern volatile unsigned NVMCON;
+extern volatile unsigned RCON;
+
+extern volatile sfrbits_t AD1CON1bits;
+extern volatile sfrbits_t CLKDIVbits;
+extern volatile sfrbits_t IEC0bits;
+extern volatile sfrbits_t IEC1bits;
+extern volatile sfrbits_t IFS0bits;
+extern volatile sfrbits_t IFS1bits;
+extern volatile sfrbits_t INTCON2bits;
+extern volatile sfrbits_t IPC0bits;
+extern volatile sfrbits_t IPC1bits;
+extern volatile sfrbits_t IPC2bits;
+extern volatile sfrbits_t IPC3bits;
+extern volatile sfrbits_t IPC6bits;
+extern volatile sfrbits_t IPC7bits;
+extern volatile sfrbits_t LATAbits;
+extern volatile sfrbits_t LATBbits;
+extern volatile sfrbits_t PORTAbits;
+extern volatile sfrbits_t PORTBbits;
+extern volatile sfrbits_t NVMCONbits;
+extern volatile sfrbits_t RCONbits;
+
+// The host keeps count of the PIC's instruction cycles, for the tests
+//	which time things. Only the waiting is counted: an SPI byte takes as
+//	long as the bus and spi_write take over it, a delay as long as it
+//	asks for, and a look at the CPU priority a cycle. The time spent at
+//	or above stub_mask_ipl in one go is kept too, so a test can see how
+//	long an interrupt at that priority would have been held off.
+#define STUB_SPI_BUS_CYCLES		8
+#define STUB_SPI_CODE_CYCLES	12
+#define STUB_SR_CYCLES			1
+
+extern unsigned long stub_cycles;
+extern unsigned stub_mask_ipl;
+extern unsigned long stub_masked;
+extern unsigned long stub_masked_max;
+
+void stub_spend(unsigned long cycles);
+volatile sfrbits_t * stub_sr(void);
+volatile sfrbits_t * stub_spi_stat(void);
+
+#define SRbits			(*stub_sr())
+#define SSP1STATbits	(*stub_spi_stat())
+
+#define _ISR
+#define Nop()		((void)0)
+#define ClrWdt()	((void)0)
+#define Sleep()		((void)0)
+#define Idle()		((void)0)
+
+#define __builtin_muluu(a, b)	((unsigned long)(unsigned short)(a) * (unsigned short)(b))
+
+#endif /* XC_H_ */
@@ -0,0 +1,25 @@
+//
+// This is the include file for the host tests. Each test is a function
+//	which checks things with TEST_CHECK, and a failed check prints where
+//	it was and fails the run without stopping the rest of the tests.
+//
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+extern int test_failures;
+
+#define TEST_CHECK(cond)	\
+	do { if (!(cond)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); test_failures++; } } while (0)
+
+// Runs a test, and prints its name if any of its checks failed
+#define TEST_RUN(test)	\
+	do { int before = test_failures; test(); if (test_failures != before) { printf("FAILED %s\n", #test); } } while (0)
+
+// Goes at the end of main
+#define TEST_DONE()	\
+	do { printf("%s\n", test_failures ? "FAIL" : "OK"); return (test_failures != 0); } while (0)
+
+#endif /* TEST_H_ */
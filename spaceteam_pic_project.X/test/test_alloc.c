@@ -0,0 +1,638 @@
+//
+// These are the tests for the master's request table. They run as the
+//	master, with the whole game on the simulated radio, and play the
+//	slaves themselves. The slaves here are just what the table needs
+//	of them: they issue requests, on slots the master gave them or ones
+//	they picked, and the requests on their boards are done some while
+//	later or time out.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_alloc.h"
+#include "spaceteam_pool.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_alloc.c and spaceteam_game.c
+extern unsigned short req_reserved[NUM_PLAYERS];
+extern unsigned short req_outstanding[NUM_PLAYERS];
+extern unsigned char grant_slots[NUM_PLAYERS][REQ_GRANT_BATCH];
+extern issued_req_t my_reqs[MAX_ISSUED_REQS];
+
+// How the simulated slaves pick the requests they issue
+typedef enum _pick_mode_t
+{
+	PICK_GRANTS,		// The slots the master gave them, or their own board
+	PICK_LOCAL,			// Only ever their own board
+	PICK_RANDOM,		// Any board and input, as before the master kept a table
+	NUM_PICK_MODES
+} pick_mode_t;
+
+static const char * const mode_names[NUM_PICK_MODES] = { "grants", "local", "random" };
+
+// The number of requests a simulated slave keeps out at once
+#define SLAVE_ISSUE_LIMIT		2
+
+// A request on a simulated board is done somewhere in this long, in ms,
+//	so that some of them time out first
+#define SLAVE_DONE_MIN_MS		500
+#define SLAVE_DONE_SPREAD_MS	20000
+
+// The master's inputs do a request in this many ms, on average
+#define MASTER_DONE_ODDS		6000
+
+// How long a simulated game runs for, and how long the slaves are then
+//	given to finish off what they have out
+#define GAME_MS					(5UL * 60 * 1000)
+#define DRAIN_MS				((REQ_TIME_MAX + 1UL) * SIM_T1_MS + SLAVE_DONE_MIN_MS + SLAVE_DONE_SPREAD_MS)
+
+// A request, as a simulated slave knows it
+typedef struct _sim_req_t
+{
+	unsigned char type;			// NO_REQ if the entry is free
+	unsigned char board;		// The board it's on, or the one which issued it
+	unsigned long at;			// When it times out, or is done
+} sim_req_t;
+
+// A simulated slave
+typedef struct _sim_slave_t
+{
+	spaceteam_grant_t grants[REQ_GRANT_BATCH];
+	sim_req_t issued[SLAVE_ISSUE_LIMIT];
+	sim_req_t given[REQUEST_POOL_SIZE];
+} sim_slave_t;
+
+sim_slave_t slaves[NUM_PLAYERS];
+
+// What the slaves have sent the master which it hasn't had yet
+#define OUTBOX_LEN				64
+spaceteam_packet_t outbox[OUTBOX_LEN];
+unsigned outbox_len;
+
+pick_mode_t pick_mode;
+int issuing;
+
+// What happened in the game
+unsigned long sim_issued;
+unsigned long sim_conflicts;
+unsigned long sim_local;
+
+// The game never ends, so that it can run as long as the test likes
+int dec_game_health(void)
+{
+	return 1;
+}
+
+// This function stands in for the master's inputs
+int check_request_completed(spaceteam_request_t * req)
+{
+	return (sim_random_in(MASTER_DONE_ODDS) == 0);
+}
+
+// This function returns an input on the passed board which nobody has
+//	a request on
+spaceteam_req_t free_input(unsigned char board)
+{
+	spaceteam_req_t type;
+
+	for (type = 0; type < NO_REQ; type++)
+	{
+		if (!(req_reserved[board] & (1 << type)))
+		{
+			break;
+		}
+	}
+
+	return type;
+}
+
+// A request which a slave picked on its own board takes its slot until
+//	the slave's copy of it ending comes in, whichever way it ended. The
+//	copy isn't sent back to the slave.
+void test_slave_local_ends(void)
+{
+	static const spaceteam_msg_t ends[] = { MSG_REQ_COMPLETED, MSG_REQ_FAILED };
+	spaceteam_req_t type;
+	int i;
+
+	sim_reset();
+	sim_start_game(PLAYER_BIT(MASTER_PLAYER) | PLAYER_BIT(1) | PLAYER_BIT(2));
+
+	for (i = 0; i < 2; i++)
+	{
+		type = free_input(1);
+		TEST_CHECK(type != NO_REQ);
+
+		sim_receive(MSG_NEW_REQ, type, 1, 1, 0);
+		TEST_CHECK(req_reserved[1] & (1 << type));
+		TEST_CHECK(req_outstanding[1] & (1 << type));
+
+		sim_clear_log();
+		sim_receive(ends[i], type, 1, 1, 0);
+		msg_flush();
+		TEST_CHECK(!(req_reserved[1] & (1 << type)));
+		TEST_CHECK(!(req_outstanding[1] & (1 << type)));
+		TEST_CHECK(!sim_find(ends[i], type, 1, 1, 1));
+	}
+}
+
+// This function has a simulated slave send the master a message
+void slave_send(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned short val)
+{
+	spaceteam_packet_t * packet;
+
+	TEST_CHECK(outbox_len < OUTBOX_LEN);
+	if (outbox_len == OUTBOX_LEN)
+	{
+		return;
+	}
+
+	packet = &outbox[outbox_len++];
+	packet->type = msg;
+	packet->request = req;
+	packet->sender = sender;
+	packet->recipient = recipient;
+	packet->val = val;
+}
+
+// This function hands the master what the slaves have sent it
+void deliver_outbox(void)
+{
+	spaceteam_request_t * req;
+	spaceteam_packet_t packet;
+	unsigned i;
+	int j;
+
+	for (i = 0; i < outbox_len; i++)
+	{
+		packet = outbox[i];
+
+		// Count the requests which land on an input of ours which
+		//	already has one
+		if ( (packet.type == MSG_NEW_REQ) && (packet.recipient == MASTER_PLAYER) )
+		{
+			sim_issued++;
+			for (j = 0; j < REQUEST_POOL_SIZE; j++)
+			{
+				req = (spaceteam_request_t *)pool_get(&request_pool, j);
+				if ( (req != NULL) && (req->type == packet.request) )
+				{
+					sim_conflicts++;
+					break;
+				}
+			}
+		}
+
+		sim_receive(packet.type, packet.request, packet.sender, packet.recipient, packet.val);
+	}
+
+	outbox_len = 0;
+}
+
+// This function puts a request on a simulated slave's board. It returns
+//	1 if the input already had one.
+int slave_give(unsigned char player, spaceteam_req_t type, unsigned char issuer)
+{
+	sim_slave_t * slave = &slaves[player];
+	int conflict = 0;
+	int i;
+
+	sim_issued++;
+
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		if (slave->given[i].type == type)
+		{
+			conflict = 1;
+		}
+	}
+
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		if (slave->given[i].type == NO_REQ)
+		{
+			slave->given[i].type = type;
+			slave->given[i].board = issuer;
+			slave->given[i].at = sim_ms + SLAVE_DONE_MIN_MS + sim_random_in(SLAVE_DONE_SPREAD_MS);
+			break;
+		}
+	}
+
+	sim_conflicts += conflict;
+
+	return conflict;
+}
+
+// This function takes a request off a simulated slave's board
+void slave_take(unsigned char player, spaceteam_req_t type, unsigned char issuer)
+{
+	int i;
+
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		if ( (slaves[player].given[i].type == type) && (slaves[player].given[i].board == issuer) )
+		{
+			slaves[player].given[i].type = NO_REQ;
+			return;
+		}
+	}
+}
+
+// This function ends one of a simulated slave's requests
+void slave_done(unsigned char player, spaceteam_req_t type, unsigned char board)
+{
+	int i;
+
+	for (i = 0; i < SLAVE_ISSUE_LIMIT; i++)
+	{
+		if ( (slaves[player].issued[i].type == type) && (slaves[player].issued[i].board == board) )
+		{
+			slaves[player].issued[i].type = NO_REQ;
+			return;
+		}
+	}
+}
+
+// This function is the simulated slaves' radio. It takes each message
+//	in a payload the master sent, for whichever of them it's for.
+void slaves_receive(unsigned char dest, const unsigned char * buf, unsigned char len)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos = 0;
+	unsigned char used;
+	sim_slave_t * slave;
+	int i;
+
+	while ( (pos < len) && ((used = msg_unpack(&buf[pos], len - pos, &packet)) != 0) )
+	{
+		pos += used;
+
+		if ( (dest == ALL_PLAYERS) || (packet.recipient != dest) )
+		{
+			continue;
+		}
+		slave = &slaves[dest];
+
+		switch (packet.type)
+		{
+			case MSG_REQ_GRANT:
+				for (i = 0; i < REQ_GRANT_BATCH; i++)
+				{
+					if (slave->grants[i].type == NO_GRANT)
+					{
+						slave->grants[i].type = packet.request;
+						slave->grants[i].board = packet.val;
+						break;
+					}
+				}
+				if (i == REQ_GRANT_BATCH)
+				{
+					slave_send(MSG_GRANT_RETURN, packet.request, dest, MASTER_PLAYER, packet.val);
+				}
+				break;
+			case MSG_NEW_REQ:
+				slave_give(dest, packet.request, packet.sender);
+				break;
+			case MSG_REQ_COMPLETED:
+				slave_done(dest, packet.request, packet.sender);
+				break;
+			case MSG_REQ_FAILED:
+				slave_take(dest, packet.request, packet.sender);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// This function returns 1 if a simulated slave knows of a request on the
+//	passed input already, as is_request_pending does
+int slave_pending(unsigned char player, spaceteam_req_t type, unsigned char board)
+{
+	int i;
+
+	for (i = 0; i < SLAVE_ISSUE_LIMIT; i++)
+	{
+		if ( (slaves[player].issued[i].type == type) && (slaves[player].issued[i].board == board) )
+		{
+			return 1;
+		}
+	}
+
+	if (board != player)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		if (slaves[player].given[i].type == type)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// This function has a simulated slave issue a request into the passed
+//	entry, the way pick_mode says
+void slave_issue(unsigned char player, sim_req_t * issued)
+{
+	sim_slave_t * slave = &slaves[player];
+	spaceteam_req_t type = NO_REQ;
+	unsigned char board = player;
+	int tries;
+	int i;
+
+	if (pick_mode == PICK_GRANTS)
+	{
+		for (i = 0; i < REQ_GRANT_BATCH; i++)
+		{
+			if (slave->grants[i].type != NO_GRANT)
+			{
+				type = slave->grants[i].type;
+				board = slave->grants[i].board;
+				slave->grants[i].type = NO_GRANT;
+				break;
+			}
+		}
+	}
+	else if (pick_mode == PICK_RANDOM)
+	{
+		do
+		{
+			board = sim_random_in(NUM_PLAYERS);
+		} while (board == player);
+		type = sim_random_in(NO_REQ);
+
+		// If it happens to be a slot we were given, it's used up
+		for (i = 0; i < REQ_GRANT_BATCH; i++)
+		{
+			if ( (slave->grants[i].type == type) && (slave->grants[i].board == board) )
+			{
+				slave->grants[i].type = NO_GRANT;
+				break;
+			}
+		}
+	}
+
+	// Otherwise pick something on our own board, with the same few
+	//	rerolls as pick_request
+	if (type == NO_REQ)
+	{
+		sim_local++;
+		tries = 0;
+		do
+		{
+			type = sim_random_in(NO_REQ);
+			tries++;
+		} while ( slave_pending(player, type, board) && (tries < REQ_GEN_MAX_TRIES) );
+	}
+
+	issued->type = type;
+	issued->board = board;
+	issued->at = sim_ms + (unsigned long)REQ_TIME_MAX * SIM_T1_MS;
+
+	// A request on our own board stays here, and the master gets a copy
+	if (board == player)
+	{
+		slave_give(player, type, player);
+	}
+	slave_send(MSG_NEW_REQ, type, player, board, 0);
+}
+
+// This function runs a simulated slave for a ms
+void slave_run(unsigned char player)
+{
+	sim_slave_t * slave = &slaves[player];
+	sim_req_t * req;
+	int i;
+
+	// The requests on our board which are done
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		req = &slave->given[i];
+		if ( (req->type != NO_REQ) && (sim_ms >= req->at) )
+		{
+			if (req->board == player)
+			{
+				slave_done(player, req->type, player);
+			}
+			slave_send(MSG_REQ_COMPLETED, req->type, player, req->board, 0);
+			req->type = NO_REQ;
+		}
+	}
+
+	// Ours which timed out, and new ones in their place
+	for (i = 0; i < SLAVE_ISSUE_LIMIT; i++)
+	{
+		req = &slave->issued[i];
+		if ( (req->type != NO_REQ) && (sim_ms >= req->at) )
+		{
+			if (req->board == player)
+			{
+				slave_take(player, req->type, player);
+			}
+			slave_send(MSG_REQ_FAILED, req->type, player, req->board, 0);
+			req->type = NO_REQ;
+		}
+
+		if ( (req->type == NO_REQ) && issuing )
+		{
+			slave_issue(player, req);
+		}
+	}
+}
+
+// This function runs the whole game for the passed number of ms
+void run_game(unsigned long ms, unsigned char players)
+{
+	unsigned char player;
+
+	while (ms-- != 0)
+	{
+		for (player = 0; player < NUM_PLAYERS; player++)
+		{
+			if ( (player != MASTER_PLAYER) && (players & PLAYER_BIT(player)) )
+			{
+				slave_run(player);
+			}
+		}
+		deliver_outbox();
+		sim_tick();
+	}
+}
+
+// This function checks that the master's table has exactly the requests
+//	which are out, and that a slot is only reserved while a request or a
+//	grant is on it. The master's next request may be holding one more.
+void check_table(unsigned char players)
+{
+	unsigned short truth[NUM_PLAYERS];
+	unsigned short held[NUM_PLAYERS];
+	spaceteam_request_t * req;
+	unsigned char slot;
+	unsigned spare = 0;
+	int i, j;
+
+	// Get everything where it's going first
+	deliver_outbox();
+	msg_flush();
+	deliver_outbox();
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		truth[i] = 0;
+		held[i] = 0;
+	}
+
+	for (i = 0; i < REQUEST_POOL_SIZE; i++)
+	{
+		req = (spaceteam_request_t *)pool_get(&request_pool, i);
+		if (req != NULL)
+		{
+			truth[MASTER_PLAYER] |= (1 << req->type);
+		}
+	}
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		if ( (i == MASTER_PLAYER) || !(players & PLAYER_BIT(i)) )
+		{
+			continue;
+		}
+
+		for (j = 0; j < REQUEST_POOL_SIZE; j++)
+		{
+			if (slaves[i].given[j].type != NO_REQ)
+			{
+				truth[i] |= (1 << slaves[i].given[j].type);
+			}
+		}
+
+		// The master and the slave agree on the grants it holds
+		for (j = 0; j < REQ_GRANT_BATCH; j++)
+		{
+			slot = grant_slots[i][j];
+			if (slot != NO_GRANT)
+			{
+				held[slot >> 4] |= (1 << (slot & 0x0F));
+			}
+			if (slaves[i].grants[j].type != NO_GRANT)
+			{
+				TEST_CHECK(alloc_grants_held(i) != 0);
+			}
+		}
+	}
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		TEST_CHECK(req_outstanding[i] == truth[i]);
+		TEST_CHECK((req_reserved[i] & (truth[i] | held[i])) == (truth[i] | held[i]));
+
+		for (j = 0; j < NO_REQ; j++)
+		{
+			if (req_reserved[i] & ~(truth[i] | held[i]) & (1 << j))
+			{
+				spare++;
+			}
+		}
+	}
+	TEST_CHECK(spare <= 1);
+}
+
+// This function plays a game with the passed players, the slaves picking
+//	their requests the passed way. The slaves stop issuing for the end
+//	of it, so that everything they had out is done or has timed out and
+//	the master's table can be checked against what's left. It returns
+//	the conflicts per thousand requests.
+unsigned long play(pick_mode_t mode, unsigned char players)
+{
+	int i, j;
+
+	sim_reset();
+	sim_radio_hook = slaves_receive;
+	pick_mode = mode;
+	issuing = 1;
+	outbox_len = 0;
+	sim_issued = 0;
+	sim_conflicts = 0;
+	sim_local = 0;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		for (j = 0; j < REQ_GRANT_BATCH; j++)
+		{
+			slaves[i].grants[j].type = NO_GRANT;
+		}
+		for (j = 0; j < SLAVE_ISSUE_LIMIT; j++)
+		{
+			slaves[i].issued[j].type = NO_REQ;
+		}
+		for (j = 0; j < REQUEST_POOL_SIZE; j++)
+		{
+			slaves[i].given[j].type = NO_REQ;
+		}
+	}
+
+	sim_start_game(players);
+	run_game(GAME_MS, players);
+
+	issuing = 0;
+	run_game(DRAIN_MS, players);
+	check_table(players);
+
+	printf("%-6s %d players: %lu requests, %lu conflicts, %lu picked locally\n",
+		   mode_names[mode], count_active_players(), sim_issued, sim_conflicts, sim_local);
+
+	TEST_CHECK(sim_issued != 0);
+
+	return (sim_conflicts * 1000) / sim_issued;
+}
+
+// With every board in the game, the slaves' requests hardly ever land
+//	on an input which already has one when they use the master's slots,
+//	next to when they pick any input they like. Picking only on their
+//	own boards is in between, since they can't see the slots the master
+//	has handed out there. Either way, the master's table ends up with
+//	just what's out, including the requests which slaves picked on their
+//	own boards.
+void test_conflicts(void)
+{
+	unsigned char players = (1 << NUM_PLAYERS) - 1;
+	unsigned long granted;
+	unsigned long local;
+	unsigned long random;
+
+	granted = play(PICK_GRANTS, players);
+	local = play(PICK_LOCAL, players);
+	random = play(PICK_RANDOM, players);
+
+	TEST_CHECK(granted * 10 < random);
+	TEST_CHECK(local * 2 < random);
+}
+
+// The same with just two boards, where every slot the master gives out
+//	is on its own board
+void test_two_boards(void)
+{
+	play(PICK_GRANTS, PLAYER_BIT(MASTER_PLAYER) | PLAYER_BIT(1));
+	play(PICK_LOCAL, PLAYER_BIT(MASTER_PLAYER) | PLAYER_BIT(1));
+}
+
+int main(void)
+{
+	TEST_RUN(test_slave_local_ends);
+	TEST_RUN(test_conflicts);
+	TEST_RUN(test_two_boards);
+
+	TEST_DONE();
+}
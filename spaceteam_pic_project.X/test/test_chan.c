@@ -0,0 +1,337 @@
+//
+// These are the tests for the master's side of the channel manager, on
+//	a model of the air. Each channel has its own noise, which is how
+//	often the received power detector hears something on it, and its
+//	own loss, which is how many of the payloads sent on it go missing.
+//	The scan listens to the noise, and the hop watches the loss. It runs
+//	as the master, with the whole game on the simulated radio.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_chan.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_chan.c
+extern const unsigned char chan_candidates[CHAN_NUM_CANDIDATES];
+extern unsigned char chan_scores[CHAN_NUM_CANDIDATES];
+
+// The radio's channels, and the ones a Wi-Fi channel's 22MHz covers.
+//	Radio channel n is at 2400 + n MHz, and Wi-Fi channel k is centred
+//	on 2407 + 5k MHz.
+#define NUM_CHANNELS			126
+#define WIFI_LO(k)				(7 + 5 * (k) - 11)
+#define WIFI_HI(k)				(7 + 5 * (k) + 11)
+
+// How often a channel with Wi-Fi on it is busy, and one without, in
+//	percent
+#define WIFI_BUSY_PCT			70
+#define QUIET_BUSY_PCT			5
+
+// How many venues with random noise the scan is tried in, and how far
+//	off the quietest it may pick, in percent, given it only listens
+//	CHAN_SCAN_SAMPLES times
+#define SCAN_VENUES				200
+#define SCAN_SLACK_PCT			30
+
+// How many payloads go to each slave between checks, and how many of
+//	them are lost on a bad channel and a good one, in percent
+#define LINK_SENT				40
+#define BAD_LOSS_PCT			50
+#define GOOD_LOSS_PCT			5
+
+#define MIN(a, b)				(((a) < (b)) ? (a) : (b))
+
+// The air. Each slave can be off, or have a bad link of its own
+//	whatever the channel.
+unsigned char noise_pct[NUM_CHANNELS];
+unsigned char loss_pct[NUM_CHANNELS];
+unsigned char slave_off[NUM_PLAYERS];
+unsigned char slave_bad[NUM_PLAYERS];
+
+// The channel the radio is on, how many times it's been moved during a
+//	game, and whether the hop had been sent when it was
+unsigned char radio_channel;
+int hops;
+int hop_sent_first;
+
+// This function listens to a channel the passed number of times
+unsigned char wl_module_carrier_count(unsigned char channel, unsigned char samples)
+{
+	unsigned char hits = 0;
+
+	while (samples-- != 0)
+	{
+		if (sim_random_in(100) < noise_pct[channel])
+		{
+			hits++;
+		}
+	}
+
+	return hits;
+}
+
+void wl_module_set_channel(unsigned char channel)
+{
+	radio_channel = channel;
+
+	if (get_game_state() == GAME_STARTED)
+	{
+		hops++;
+		hop_sent_first = sim_find(MSG_CHANNEL, 0, MASTER_PLAYER, ALL_PLAYERS, ALL_PLAYERS);
+	}
+}
+
+// This function hands back how the payloads to the passed slave did
+//	since the last time
+void wl_module_tx_take_link_stats(unsigned char player, unsigned short * delivered, unsigned short * lost)
+{
+	unsigned char loss = slave_bad[player] ? BAD_LOSS_PCT : loss_pct[radio_channel];
+	int i;
+
+	*delivered = 0;
+	*lost = 0;
+
+	for (i = 0; i < LINK_SENT; i++)
+	{
+		if ( slave_off[player] || (sim_random_in(100) < loss) )
+		{
+			(*lost)++;
+		}
+		else
+		{
+			(*delivered)++;
+		}
+	}
+}
+
+// This function sets up a venue with access points on the passed Wi-Fi
+//	channels, a bit per channel
+void venue(unsigned wifi)
+{
+	int n, k;
+
+	for (n = 0; n < NUM_CHANNELS; n++)
+	{
+		noise_pct[n] = QUIET_BUSY_PCT;
+		for (k = 1; k <= 13; k++)
+		{
+			if ( (wifi & (1 << k)) && (n >= WIFI_LO(k)) && (n <= WIFI_HI(k)) )
+			{
+				noise_pct[n] = WIFI_BUSY_PCT;
+			}
+		}
+		loss_pct[n] = GOOD_LOSS_PCT;
+	}
+}
+
+// This function scans the candidates, as the master does before the
+//	waiting room
+void scan(void)
+{
+	pt_t pt;
+
+	init_chan();
+	PT_INIT(&pt);
+	PT_RUN_BLOCKING(chan_scan_thread(&pt));
+}
+
+// This function starts a game with the passed players on the channel
+//	the scan picked, with the channel manager running
+void start(unsigned char players)
+{
+	int i;
+
+	sim_reset();
+	scan();
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		slave_off[i] = 0;
+		slave_bad[i] = 0;
+	}
+
+	sim_start_game(players);
+	chan_begin();
+	sched_start(chan_thread);
+	hops = 0;
+	hop_sent_first = 0;
+}
+
+// In venues with random noise, the scan picks the quietest candidate
+//	or one not much noisier, which it can't tell apart
+void test_scan(void)
+{
+	unsigned char quietest;
+	unsigned char picked;
+	int exact = 0;
+	int v, i;
+
+	for (v = 0; v < SCAN_VENUES; v++)
+	{
+		quietest = 100;
+		for (i = 0; i < CHAN_NUM_CANDIDATES; i++)
+		{
+			noise_pct[chan_candidates[i]] = sim_random_in(101);
+			quietest = MIN(quietest, noise_pct[chan_candidates[i]]);
+		}
+
+		scan();
+		picked = noise_pct[chan_get_chosen()];
+		TEST_CHECK(picked <= quietest + SCAN_SLACK_PCT);
+		if (picked == quietest)
+		{
+			exact++;
+		}
+	}
+
+	printf("picked the quietest channel in %d of %d venues\n", exact, SCAN_VENUES);
+	TEST_CHECK(exact > SCAN_VENUES / 2);
+}
+
+// With the usual access points on 1, 6 and 11, or 1, 6 and 13, the
+//	scan picks a channel in the gaps between them
+void test_wifi(void)
+{
+	static const unsigned plans[] = { (1 << 1) | (1 << 6) | (1 << 11), (1 << 1) | (1 << 6) | (1 << 13) };
+	int p;
+
+	// The waiting room is under Wi-Fi channel 1
+	venue(1 << 1);
+	TEST_CHECK(noise_pct[wl_module_CH] == WIFI_BUSY_PCT);
+
+	for (p = 0; p < sizeof(plans) / sizeof(plans[0]); p++)
+	{
+		venue(plans[p]);
+		scan();
+		TEST_CHECK(noise_pct[chan_get_chosen()] == QUIET_BUSY_PCT);
+	}
+}
+
+// The join handshake tells each slave the channel in the same payload
+//	as every MSG_NETWORKING
+void test_handshake(void)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos;
+	unsigned char used;
+	int channel;
+	int networking;
+	int i;
+
+	sim_reset();
+	venue(1 << 1);
+	init_chan();
+	sched_start(network_thread);
+	sim_run_ms(NUM_PLAYERS * NETWORK_SEND_GAP_MS);
+	TEST_CHECK(sim_find(MSG_NETWORKING, 0, MASTER_PLAYER, 1, 1));
+
+	for (i = 0; i < sim_log_len; i++)
+	{
+		if (sim_log[i].dest != 1)
+		{
+			continue;
+		}
+
+		channel = 0;
+		networking = 0;
+		pos = 0;
+		while ( (pos < sim_log[i].len) && ((used = msg_unpack(&sim_log[i].buf[pos], sim_log[i].len - pos, &packet)) != 0) )
+		{
+			pos += used;
+			if ( (packet.type == MSG_CHANNEL) && (packet.val == chan_get_chosen()) )
+			{
+				channel = 1;
+			}
+			networking |= (packet.type == MSG_NETWORKING);
+		}
+		TEST_CHECK(channel && networking);
+	}
+}
+
+// When most of the links lose too many payloads, the master tells
+//	everyone where to go, and follows once that's out
+void test_hop(void)
+{
+	unsigned char first;
+	unsigned char second;
+
+	venue(1 << 1);
+	start(PLAYER_BIT(0) | PLAYER_BIT(1) | PLAYER_BIT(2) | PLAYER_BIT(3));
+	first = radio_channel;
+	TEST_CHECK(first == chan_get_chosen());
+
+	sim_run_ms(3 * CHAN_CHECK_MS);
+	TEST_CHECK(hops == 0);
+
+	// A microwave comes on
+	loss_pct[first] = BAD_LOSS_PCT;
+	sim_clear_log();
+	sim_run_ms(CHAN_CHECK_MS + 1);
+	TEST_CHECK(hops == 1);
+	TEST_CHECK(hop_sent_first);
+	TEST_CHECK(radio_channel != first);
+	TEST_CHECK(sim_find(MSG_CHANNEL, 0, MASTER_PLAYER, ALL_PLAYERS, ALL_PLAYERS));
+
+	// And if the next one goes bad too, it doesn't go back
+	second = radio_channel;
+	loss_pct[second] = BAD_LOSS_PCT;
+	sim_run_ms(CHAN_CHECK_MS + 1);
+	TEST_CHECK(hops == 2);
+	TEST_CHECK(radio_channel != first);
+	TEST_CHECK(radio_channel != second);
+}
+
+// One bad link out of three isn't the channel's fault, and neither are
+//	slaves which are off
+void test_no_hop(void)
+{
+	venue(1 << 1);
+	start(PLAYER_BIT(0) | PLAYER_BIT(1) | PLAYER_BIT(2) | PLAYER_BIT(3));
+
+	slave_bad[2] = 1;
+	sim_run_ms(5 * CHAN_CHECK_MS);
+	TEST_CHECK(hops == 0);
+
+	slave_off[1] = 1;
+	slave_off[3] = 1;
+	slave_bad[2] = 0;
+	sim_run_ms(5 * CHAN_CHECK_MS);
+	TEST_CHECK(hops == 0);
+
+	// But two bad out of three is
+	slave_off[1] = 0;
+	slave_off[3] = 0;
+	slave_bad[1] = 1;
+	slave_bad[2] = 1;
+	sim_run_ms(CHAN_CHECK_MS + 1);
+	TEST_CHECK(hops != 0);
+
+	// Which doesn't help if it's their links, but once they're better
+	//	it stays put
+	slave_bad[1] = 0;
+	slave_bad[2] = 0;
+	sim_run_ms(CHAN_CHECK_MS + 1);
+	hops = 0;
+	sim_run_ms(5 * CHAN_CHECK_MS);
+	TEST_CHECK(hops == 0);
+}
+
+int main(void)
+{
+	TEST_RUN(test_scan);
+	TEST_RUN(test_wifi);
+	TEST_RUN(test_handshake);
+	TEST_RUN(test_hop);
+	TEST_RUN(test_no_hop);
+
+	TEST_DONE();
+}
@@ -0,0 +1,165 @@
+//
+// These are the tests for a slave's side of the channel manager. It goes
+//	where the master tells it, and if it misses a move it goes looking
+//	for the master on each candidate channel in turn. They run as player
+//	1, with the whole game on the simulated radio. The master is only on
+//	one channel, and we hear from it whenever we're on the same one.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_chan.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_chan.c
+extern const unsigned char chan_candidates[CHAN_NUM_CANDIDATES];
+
+// The channel the radio is on, and the one the master is on
+unsigned char radio_channel;
+unsigned char master_channel;
+
+void wl_module_set_channel(unsigned char channel)
+{
+	radio_channel = channel;
+}
+
+// This function starts a game, having been told in the waiting room to
+//	play on the passed candidate
+void start(unsigned char idx)
+{
+	sim_reset();
+	init_chan();
+	radio_channel = wl_module_CH;
+	master_channel = chan_candidates[idx];
+
+	sim_receive(MSG_CHANNEL, 0, MASTER_PLAYER, THIS_PLAYER, chan_candidates[idx]);
+	TEST_CHECK(radio_channel == wl_module_CH);
+
+	sim_start_game(PLAYER_BIT(MASTER_PLAYER) | PLAYER_BIT(THIS_PLAYER));
+	sched_start(chan_thread);
+}
+
+// This function runs the game for the passed number of ms, hearing from
+//	the master whenever we're on its channel at its rate, and returns how
+//	long it took to find it, or ms if we didn't
+unsigned long run(unsigned long ms)
+{
+	unsigned long found = ms;
+	unsigned long i;
+
+	for (i = 0; i < ms; i++)
+	{
+		if ( (radio_channel == master_channel) && (wl_module_get_rate() == WL_RATE_BASE) )
+		{
+			chan_note_heard();
+			if (found == ms)
+			{
+				found = i;
+			}
+		}
+		sim_tick();
+	}
+
+	return found;
+}
+
+// The channel we're told in the waiting room is where the game is
+void test_pending(void)
+{
+	start(2);
+	TEST_CHECK(radio_channel == chan_candidates[2]);
+	TEST_CHECK(chan_get_chosen() == chan_candidates[2]);
+}
+
+// During a game, we move as soon as we're told. One which isn't a
+//	candidate is garbage, and is ignored.
+void test_move(void)
+{
+	start(0);
+	run(CHAN_CHECK_MS);
+
+	master_channel = chan_candidates[3];
+	sim_receive(MSG_CHANNEL, 0, MASTER_PLAYER, ALL_PLAYERS, master_channel);
+	TEST_CHECK(radio_channel == master_channel);
+
+	sim_receive(MSG_CHANNEL, 0, MASTER_PLAYER, ALL_PLAYERS, wl_module_CH);
+	TEST_CHECK(radio_channel == master_channel);
+}
+
+// While we hear from the master, we stay put
+void test_stay(void)
+{
+	start(1);
+	run(10UL * CHAN_LOST_MS);
+	TEST_CHECK(radio_channel == chan_candidates[1]);
+}
+
+// If the master moved without us, we find it within a trip round all
+//	the candidates, wherever it went
+void test_hunt(void)
+{
+	unsigned long found;
+	unsigned long worst = 0;
+	int from, to;
+
+	for (from = 0; from < CHAN_NUM_CANDIDATES; from++)
+	{
+		for (to = 0; to < CHAN_NUM_CANDIDATES; to++)
+		{
+			if (to == from)
+			{
+				continue;
+			}
+
+			start(from);
+			run(CHAN_LOST_MS);
+			master_channel = chan_candidates[to];
+
+			found = run((CHAN_NUM_CANDIDATES + 1) * (CHAN_LOST_MS + 1));
+			TEST_CHECK(found <= CHAN_NUM_CANDIDATES * (CHAN_LOST_MS + 1));
+			worst = (found > worst) ? found : worst;
+
+			// And then stays with it
+			run(10UL * CHAN_LOST_MS);
+			TEST_CHECK(radio_channel == master_channel);
+		}
+	}
+
+	printf("found the master within %lu ms of losing it\n", worst);
+}
+
+// If we'd moved up a rate when we lost it, we try the base rate on the
+//	same channel first, since that's what the master falls back to
+void test_rate_first(void)
+{
+	unsigned long found;
+
+	start(4);
+	run(CHAN_LOST_MS);
+	wl_module_set_rate(WL_RATE_2M);
+
+	found = run((CHAN_NUM_CANDIDATES + 1) * (CHAN_LOST_MS + 1));
+	TEST_CHECK(found <= CHAN_LOST_MS + 1);
+	TEST_CHECK(radio_channel == chan_candidates[4]);
+	TEST_CHECK(wl_module_get_rate() == WL_RATE_BASE);
+}
+
+int main(void)
+{
+	TEST_RUN(test_pending);
+	TEST_RUN(test_move);
+	TEST_RUN(test_stay);
+	TEST_RUN(test_hunt);
+	TEST_RUN(test_rate_first);
+
+	TEST_DONE();
+}
@@ -0,0 +1,317 @@
+//
+// These are the tests for the game checkpoints: the checksum, and the
+//	ring of slots which the saves go into. The EEPROM is the array the
+//	checkpoint code declares, so a reset is just calling init_checkpoint
+//	again with whatever was written left in it.
+//
+
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_checkpoint.h"
+#include "spaceteam_sched.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_checkpoint.c
+extern unsigned short checkpoint_ee[CHECKPOINT_SLOTS * CHECKPOINT_WORDS];
+extern unsigned char checkpoint_slot;
+
+// The game which game_get_checkpoint hands over
+spaceteam_checkpoint_t test_game;
+
+// This function stands in for the game, and copies out its state
+void game_get_checkpoint(struct _spaceteam_checkpoint_t * ckpt)
+{
+	*ckpt = test_game;
+}
+
+// This function sets up the game to save. The lfsr is used to tell the
+//	saves apart.
+void set_game(game_state_t state, unsigned short lfsr)
+{
+	memset(&test_game, 0, sizeof(test_game));
+	test_game.game_state = state;
+	test_game.chan_idx = 3;
+	test_game.players = 0x0B;
+	test_game.health = 5;
+	test_game.issue_limit = 2;
+	test_game.reqs_completed = 1;
+	test_game.lfsr = lfsr;
+	test_game.reqs[0].req.type = 2;
+	test_game.reqs[0].req.board = 1;
+	test_game.reqs[0].req.val = 0x1234;
+	test_game.reqs[0].time = 7;
+}
+
+// This function resets the board, warm or from power on
+void reset(int warm)
+{
+	RCONbits.POR = !warm;
+	init_sched();
+	init_checkpoint();
+}
+
+// This function erases the whole EEPROM and resets
+void erase_all(void)
+{
+	memset(checkpoint_ee, 0xFF, sizeof(checkpoint_ee));
+	reset(1);
+}
+
+// This function saves the game and runs the save to the end, waiting
+//	out the gap between saves first
+void save_now(void)
+{
+	sched_tick(CHECKPOINT_MIN_GAP_MS);
+	checkpoint_save();
+	while (checkpoint_busy())
+	{
+		checkpoint_service();
+	}
+}
+
+// This function writes a checkpoint straight into a slot
+void write_slot(unsigned char slot, spaceteam_checkpoint_t * ckpt)
+{
+	ckpt->magic = CHECKPOINT_MAGIC;
+	ckpt->check = checkpoint_sum(ckpt);
+	memcpy(&checkpoint_ee[slot * CHECKPOINT_WORDS], ckpt, sizeof(*ckpt));
+}
+
+// The layout has to be the 16 words the EEPROM code writes
+void test_layout(void)
+{
+	TEST_CHECK(sizeof(spaceteam_checkpoint_t) == CHECKPOINT_WORDS * 2);
+}
+
+// Every single bit flip in the covered words, and swapping two words,
+//	has to change the checksum
+void test_sum_catches_changes(void)
+{
+	spaceteam_checkpoint_t ckpt;
+	unsigned short * words = (unsigned short *)&ckpt;
+	unsigned short sum;
+	unsigned short tmp;
+	int i;
+	int bit;
+
+	set_game(GAME_STARTED, 0xBEEF);
+	ckpt = test_game;
+	ckpt.magic = CHECKPOINT_MAGIC;
+	ckpt.seq = 42;
+	sum = checkpoint_sum(&ckpt);
+
+	for (i = 0; i < CHECKPOINT_WORDS - 1; i++)
+	{
+		for (bit = 0; bit < 16; bit++)
+		{
+			words[i] ^= (1 << bit);
+			TEST_CHECK(checkpoint_sum(&ckpt) != sum);
+			words[i] ^= (1 << bit);
+		}
+	}
+
+	for (i = 0; i < CHECKPOINT_WORDS - 2; i++)
+	{
+		if (words[i] == words[i + 1])
+		{
+			continue;
+		}
+		tmp = words[i];
+		words[i] = words[i + 1];
+		words[i + 1] = tmp;
+		TEST_CHECK(checkpoint_sum(&ckpt) != sum);
+		words[i + 1] = words[i];
+		words[i] = tmp;
+	}
+
+	TEST_CHECK(checkpoint_sum(&ckpt) == sum);
+
+	// An erased slot mustn't pass either
+	memset(&ckpt, 0xFF, sizeof(ckpt));
+	TEST_CHECK(checkpoint_sum(&ckpt) != ckpt.check);
+}
+
+// A blank EEPROM has nothing to resume
+void test_blank(void)
+{
+	spaceteam_checkpoint_t ckpt;
+
+	erase_all();
+	TEST_CHECK(checkpoint_load(&ckpt) == FAILURE);
+}
+
+// A saved game comes back after a warm reset, but not after a power on
+//	reset, and not once it's over
+void test_save_and_load(void)
+{
+	spaceteam_checkpoint_t ckpt;
+
+	erase_all();
+	set_game(GAME_STARTED, 0x1111);
+	save_now();
+
+	reset(1);
+	TEST_CHECK(checkpoint_load(&ckpt) == SUCCESS);
+	TEST_CHECK(ckpt.lfsr == 0x1111);
+	TEST_CHECK(ckpt.chan_idx == 3);
+	TEST_CHECK(ckpt.players == 0x0B);
+	TEST_CHECK(ckpt.health == 5);
+	TEST_CHECK(ckpt.reqs[0].req.val == 0x1234);
+	TEST_CHECK(ckpt.reqs[0].time == 7);
+
+	reset(0);
+	TEST_CHECK(checkpoint_load(&ckpt) == FAILURE);
+
+	reset(1);
+	set_game(GAME_OVER, 0x2222);
+	save_now();
+	reset(1);
+	TEST_CHECK(checkpoint_load(&ckpt) == FAILURE);
+}
+
+// Each save goes in the next slot round the ring, and a reset finds the
+//	newest one
+void test_slots_rotate(void)
+{
+	spaceteam_checkpoint_t ckpt;
+	int i;
+
+	erase_all();
+
+	for (i = 0; i < CHECKPOINT_SLOTS + 3; i++)
+	{
+		set_game(GAME_STARTED, i);
+		save_now();
+		TEST_CHECK(checkpoint_slot == (i % CHECKPOINT_SLOTS));
+	}
+
+	for (i = 0; i < CHECKPOINT_SLOTS; i++)
+	{
+		TEST_CHECK(checkpoint_read(i, &ckpt) == SUCCESS);
+	}
+
+	reset(1);
+	TEST_CHECK(checkpoint_slot == 2);
+	TEST_CHECK(checkpoint_load(&ckpt) == SUCCESS);
+	TEST_CHECK(ckpt.lfsr == CHECKPOINT_SLOTS + 2);
+
+	// And the next save carries on from there
+	set_game(GAME_STARTED, 0x3333);
+	save_now();
+	TEST_CHECK(checkpoint_slot == 3);
+}
+
+// The newest slot is still found when the sequence number wraps
+void test_seq_wraps(void)
+{
+	spaceteam_checkpoint_t ckpt;
+
+	erase_all();
+	set_game(GAME_STARTED, 0x4444);
+	ckpt = test_game;
+	ckpt.seq = 0xFFFE;
+	write_slot(4, &ckpt);
+
+	reset(1);
+	TEST_CHECK(checkpoint_slot == 4);
+
+	set_game(GAME_STARTED, 0x5555);
+	save_now();
+	set_game(GAME_STARTED, 0x6666);
+	save_now();
+
+	reset(1);
+	TEST_CHECK(checkpoint_slot == 6);
+	TEST_CHECK(checkpoint_load(&ckpt) == SUCCESS);
+	TEST_CHECK(ckpt.seq == 0);
+	TEST_CHECK(ckpt.lfsr == 0x6666);
+}
+
+// A save which is cut off part way leaves the one before it as the
+//	newest, wherever it was cut off
+void test_torn_save(void)
+{
+	spaceteam_checkpoint_t ckpt;
+	int steps;
+	int i;
+
+	// checkpoint_save does the first step itself, and the last one
+	//	writes the checksum
+	for (steps = 0; steps < (2 * CHECKPOINT_WORDS) - 1; steps++)
+	{
+		erase_all();
+		set_game(GAME_STARTED, 0x7777);
+		save_now();
+
+		set_game(GAME_STARTED, 0x8888);
+		sched_tick(CHECKPOINT_MIN_GAP_MS);
+		checkpoint_save();
+		for (i = 0; i < steps; i++)
+		{
+			checkpoint_service();
+		}
+
+		reset(1);
+		TEST_CHECK(checkpoint_load(&ckpt) == SUCCESS);
+		TEST_CHECK(ckpt.lfsr == 0x7777);
+	}
+}
+
+// Saves asked for too soon after the last one are held back, and then
+//	all go out as one save of the newest state
+void test_saves_held(void)
+{
+	spaceteam_checkpoint_t ckpt;
+	int i;
+
+	erase_all();
+	set_game(GAME_STARTED, 0x9999);
+	save_now();
+
+	for (i = 0; i < 5; i++)
+	{
+		set_game(GAME_STARTED, 0xA000 + i);
+		checkpoint_save();
+	}
+
+	for (i = 0; i < 100; i++)
+	{
+		checkpoint_service();
+	}
+	TEST_CHECK(checkpoint_busy());
+	TEST_CHECK(checkpoint_slot == 0);
+
+	sched_tick(CHECKPOINT_MIN_GAP_MS - 1);
+	checkpoint_service();
+	TEST_CHECK(checkpoint_slot == 0);
+
+	sched_tick(1);
+	while (checkpoint_busy())
+	{
+		checkpoint_service();
+	}
+	TEST_CHECK(checkpoint_slot == 1);
+
+	reset(1);
+	TEST_CHECK(checkpoint_load(&ckpt) == SUCCESS);
+	TEST_CHECK(ckpt.lfsr == 0xA004);
+	TEST_CHECK(checkpoint_slot == 1);
+}
+
+int main(void)
+{
+	TEST_RUN(test_layout);
+	TEST_RUN(test_sum_catches_changes);
+	TEST_RUN(test_blank);
+	TEST_RUN(test_save_and_load);
+	TEST_RUN(test_slots_rotate);
+	TEST_RUN(test_seq_wraps);
+	TEST_RUN(test_torn_save);
+	TEST_RUN(test_saves_held);
+
+	TEST_DONE();
+}
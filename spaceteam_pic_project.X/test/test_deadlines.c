@@ -0,0 +1,327 @@
+//
+// These are the tests for the requests a board has out at once, each
+//	with its own deadline. They run as the master, with the whole game
+//	on the simulated radio, so timer 1 counts the requests down just as
+//	it does on the PIC. The other boards answer the requests they're
+//	given, or don't.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_game.c
+extern issued_req_t my_reqs[MAX_ISSUED_REQS];
+extern unsigned char issue_limit;
+extern unsigned char game_health;
+extern unsigned char shown_req;
+
+// The players in the games here
+#define PLAYERS					((1 << NUM_PLAYERS) - 1)
+
+// A request times out on the REQ_TIME_MAXth timer 1 tick after it was
+//	issued, and the messages each wait up to MSG_AGG_DEADLINE_MS
+#define TIMEOUT_MIN_MS			((REQ_TIME_MAX - 1UL) * SIM_T1_MS - MSG_AGG_DEADLINE_MS)
+#define TIMEOUT_MAX_MS			(REQ_TIME_MAX * (unsigned long)SIM_T1_MS + MSG_AGG_DEADLINE_MS)
+
+// The other boards do a request somewhere in this long, if they do it
+#define DONE_SPREAD_MS			(20000UL)
+
+// How long the long game runs for
+#define LONG_GAME_MS			(30UL * 60 * 1000)
+
+// Whether the health counts down, or the game goes on forever
+int immortal;
+
+// The requests out on each of the other boards. An issued time of 0
+//	means there isn't one.
+unsigned long issued_at[NUM_PLAYERS][NO_REQ];
+unsigned long done_at[NUM_PLAYERS][NO_REQ];
+
+// What happened to the requests
+unsigned long reqs_issued;
+unsigned long reqs_done;
+unsigned long reqs_failed;
+unsigned long reqs_late;
+
+int dec_game_health(void)
+{
+	if (immortal)
+	{
+		return 1;
+	}
+
+	game_health -= 1;
+
+	return (game_health != 0);
+}
+
+// This function is the other boards' radio. They note the requests they
+//	are given, and whether they'll do them, and check that the ones
+//	which fail do so on time.
+void boards_receive(unsigned char dest, const unsigned char * buf, unsigned char len)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos = 0;
+	unsigned char used;
+	unsigned long age;
+
+	while ( (pos < len) && ((used = msg_unpack(&buf[pos], len - pos, &packet)) != 0) )
+	{
+		pos += used;
+
+		if ( (dest >= NUM_PLAYERS) || (packet.sender != MASTER_PLAYER) )
+		{
+			continue;
+		}
+
+		switch (packet.type)
+		{
+			case MSG_NEW_REQ:
+				reqs_issued++;
+				issued_at[dest][packet.request] = sim_ms;
+
+				// Half of them are done, maybe after the deadline
+				done_at[dest][packet.request] = 0;
+				if (sim_random_in(2) == 0)
+				{
+					done_at[dest][packet.request] = sim_ms + 1 + sim_random_in(DONE_SPREAD_MS);
+				}
+				break;
+			case MSG_REQ_FAILED:
+				reqs_failed++;
+				age = sim_ms - issued_at[dest][packet.request];
+				if ( (age < TIMEOUT_MIN_MS) || (age > TIMEOUT_MAX_MS) )
+				{
+					reqs_late++;
+				}
+				issued_at[dest][packet.request] = 0;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// This function has the other boards send back the requests they've done
+void boards_run(void)
+{
+	int board;
+	int type;
+
+	for (board = 0; board < NUM_PLAYERS; board++)
+	{
+		for (type = 0; type < NO_REQ; type++)
+		{
+			if ( (issued_at[board][type] != 0) && (done_at[board][type] != 0) && (sim_ms >= done_at[board][type]) )
+			{
+				reqs_done++;
+				issued_at[board][type] = 0;
+				sim_receive(MSG_REQ_COMPLETED, type, board, MASTER_PLAYER, 0);
+			}
+		}
+	}
+}
+
+// This function starts a game against the other boards
+void start(int forever)
+{
+	int board;
+	int type;
+
+	sim_reset();
+	sim_radio_hook = boards_receive;
+	immortal = forever;
+	reqs_issued = 0;
+	reqs_done = 0;
+	reqs_failed = 0;
+	reqs_late = 0;
+
+	for (board = 0; board < NUM_PLAYERS; board++)
+	{
+		for (type = 0; type < NO_REQ; type++)
+		{
+			issued_at[board][type] = 0;
+		}
+	}
+
+	sim_start_game(PLAYERS);
+	sim_run_ms(MSG_AGG_DEADLINE_MS);
+}
+
+// This function runs the game until the next timer 1 tick has gone
+void run_ticks(unsigned ticks)
+{
+	while (ticks-- != 0)
+	{
+		do
+		{
+			sim_tick();
+		} while ((sim_ms % SIM_T1_MS) != 0);
+	}
+}
+
+// Requests issued at different times each count down from their own
+//	start, and only the one whose time is up fails
+void test_own_deadlines(void)
+{
+	issued_req_t first;
+	int i;
+
+	start(0);
+	TEST_CHECK(count_issued_requests() == 1);
+	first = my_reqs[0];
+
+	run_ticks(3);
+	issue_limit = 2;
+	fill_requests();
+	run_ticks(2);
+	issue_limit = 3;
+	fill_requests();
+
+	TEST_CHECK(count_issued_requests() == 3);
+	TEST_CHECK(my_reqs[0].time == REQ_TIME_MAX - 5);
+	TEST_CHECK(my_reqs[1].time == REQ_TIME_MAX - 2);
+	TEST_CHECK(my_reqs[2].time == REQ_TIME_MAX);
+
+	// Up to the tick before the first one's time is up, nothing fails
+	run_ticks(REQ_TIME_MAX - 6);
+	TEST_CHECK(reqs_failed == 0);
+	TEST_CHECK(game_health == GAME_HEALTH_MAX);
+	TEST_CHECK(my_reqs[0].time == 1);
+
+	// And then just the first one does, and is replaced
+	run_ticks(1);
+	sim_run_ms(MSG_AGG_DEADLINE_MS);
+	TEST_CHECK(reqs_failed == 1);
+	TEST_CHECK(sim_find(MSG_REQ_FAILED, first.req.type, MASTER_PLAYER, first.req.board, first.req.board));
+	TEST_CHECK(game_health == GAME_HEALTH_MAX - 1);
+	TEST_CHECK(my_reqs[0].time == REQ_TIME_MAX);
+	TEST_CHECK(my_reqs[1].time == 3);
+	TEST_CHECK(my_reqs[2].time == 5);
+
+	// The display moves round the ones which are out
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		TEST_CHECK(my_reqs[shown_req].time != 0);
+		run_ticks(1);
+	}
+}
+
+// Completing one frees its slot for a new one, and leaves the others'
+//	time alone. Every REQS_PER_LEVEL completions another one can be out,
+//	up to MAX_ISSUED_REQS.
+void test_completions(void)
+{
+	issued_req_t before[MAX_ISSUED_REQS];
+	issued_req_t req;
+	unsigned char limit;
+	unsigned char other;
+	spaceteam_req_t type;
+	int level;
+	int i;
+
+	start(0);
+
+	for (level = 1; level <= MAX_ISSUED_REQS + 1; level++)
+	{
+		TEST_CHECK(issue_limit == ((level < MAX_ISSUED_REQS) ? level : MAX_ISSUED_REQS));
+		TEST_CHECK(count_issued_requests() == issue_limit);
+
+		for (i = 0; i < REQS_PER_LEVEL; i++)
+		{
+			run_ticks(1);
+			req = my_reqs[0];
+			limit = issue_limit;
+			other = my_reqs[1].time;
+			sim_receive(MSG_REQ_COMPLETED, req.req.type, req.req.board, MASTER_PLAYER, 0);
+			TEST_CHECK(my_reqs[0].time == REQ_TIME_MAX);
+			if (issue_limit == limit)
+			{
+				TEST_CHECK(my_reqs[1].time == other);
+			}
+		}
+	}
+
+	// A completion for something we don't have out changes nothing
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		before[i] = my_reqs[i];
+	}
+	for (type = 0; is_request_pending(type, my_reqs[0].req.board); type++)
+	{
+	}
+	sim_receive(MSG_REQ_COMPLETED, type, my_reqs[0].req.board, MASTER_PLAYER, 0);
+	for (i = 0; i < MAX_ISSUED_REQS; i++)
+	{
+		TEST_CHECK(my_reqs[i].time == before[i].time);
+		TEST_CHECK(my_reqs[i].req.type == before[i].req.type);
+	}
+}
+
+// The game ends on the GAME_HEALTH_MAXth timeout, and not before
+void test_game_over(void)
+{
+	start(0);
+	issue_limit = MAX_ISSUED_REQS;
+	fill_requests();
+
+	while ( (get_game_state() == GAME_STARTED) && (sim_ms < (GAME_HEALTH_MAX + 1UL) * REQ_TIME_MAX * SIM_T1_MS) )
+	{
+		sim_tick();
+	}
+	sim_run_ms(MSG_AGG_DEADLINE_MS);
+
+	TEST_CHECK(get_game_state() != GAME_STARTED);
+	TEST_CHECK(reqs_failed == GAME_HEALTH_MAX);
+	TEST_CHECK(count_issued_requests() == 0);
+}
+
+// In a long game with as many requests out as there can be, where some
+//	are done in time and some aren't, every one which fails does so on
+//	its deadline, and the slots are always full
+void test_long_game(void)
+{
+	unsigned long full_ticks = 0;
+
+	start(1);
+
+	while (sim_ms < LONG_GAME_MS)
+	{
+		boards_run();
+		sim_tick();
+
+		if ( (issue_limit == MAX_ISSUED_REQS) && (count_issued_requests() == MAX_ISSUED_REQS) )
+		{
+			full_ticks++;
+		}
+		TEST_CHECK(count_issued_requests() == issue_limit);
+	}
+
+	printf("%lu requests in %lu minutes: %lu done, %lu failed, %lu failed off their deadline\n",
+		   reqs_issued, LONG_GAME_MS / 60000, reqs_done, reqs_failed, reqs_late);
+
+	TEST_CHECK(issue_limit == MAX_ISSUED_REQS);
+	TEST_CHECK(reqs_late == 0);
+	TEST_CHECK(reqs_done != 0);
+	TEST_CHECK(reqs_failed != 0);
+	TEST_CHECK(reqs_issued - reqs_done - reqs_failed == MAX_ISSUED_REQS);
+	TEST_CHECK(full_ticks > LONG_GAME_MS / 2);
+}
+
+int main(void)
+{
+	TEST_RUN(test_own_deadlines);
+	TEST_RUN(test_completions);
+	TEST_RUN(test_game_over);
+	TEST_RUN(test_long_game);
+
+	TEST_DONE();
+}
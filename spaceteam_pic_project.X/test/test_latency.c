@@ -0,0 +1,289 @@
+//
+// This is the model of how long the radio interrupt can be held off. It
+//	runs the display, the RFID and the radio's own SPI traffic at the
+//	priorities they run at on the PIC, on the stand-in SPI, which counts
+//	how long each byte would take on the bus. Whenever the CPU priority
+//	is at or above RADIO_INT_PRIORITY the radio interrupt can't get in,
+//	so the longest stretch of that is how late it can be.
+//
+// Only the SPI bytes, the delays and the priority changes are counted,
+//	not the code around them. That's most of the time in a frame, but the
+//	interrupts which do no SPI at all (the LED scan, and timer 1 when it
+//	has nothing to send) are only as long as their code, so they're
+//	given the rough counts below instead.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_crit.h"
+#include "spaceteam_clock.h"
+#include "spaceteam_game.h"
+#include "spaceteam_display.h"
+#include "spaceteam_led.h"
+#include "spaceteam_rfid.h"
+#include "spaceteam_wireless.h"
+#include "spaceteam_chan.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_power.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_game.c and spaceteam_display.c
+extern issued_req_t my_reqs[MAX_ISSUED_REQS];
+void init_game_vars(void);
+void _T4Interrupt(void);
+
+// The PIC24 takes this long to get into an interrupt once it's let in
+#define INT_ENTRY_CYCLES		5
+
+// Rough counts of the LED scan interrupt and of timer 1 with nothing to
+//	send, in and out. Neither touches the SPI.
+#define LED_ISR_CYCLES			60
+#define T1_ISR_CYCLES			150
+
+// How long a frame of the passed number of bytes holds the radio off.
+//	The overhead is the priority being looked at and changed inside it,
+//	for the frame itself, the display's control lines and the clock boost.
+#define FRAME_OVERHEAD_CYCLES	24
+#define FRAME_CYCLES(bytes)		((bytes) * (STUB_SPI_BUS_CYCLES + STUB_SPI_CODE_CYCLES) + FRAME_OVERHEAD_CYCLES)
+
+// The radio turns around in 130 us, and an interrupt answered inside
+//	that costs the link nothing
+#define LATENCY_MAX_US			130
+
+// The game's longest RFID frame is the two bytes of the ID request,
+//	written to the FIFO
+#define RFID_REQ_LEN			2
+
+#define MAX(a, b)				(((a) > (b)) ? (a) : (b))
+
+// The longest the radio was held off by each of the loads, in cycles
+unsigned long held_display;
+unsigned long held_rfid;
+unsigned long held_radio;
+unsigned long held_t2;
+unsigned long held_main;
+unsigned long held_t1;
+
+// How long the last load took, all told
+unsigned long busy;
+
+// This function runs the passed load at the passed CPU priority, and
+//	returns the longest it held the radio interrupt off
+unsigned long run_at(unsigned ipl, void (*load)(void))
+{
+	unsigned long before;
+
+	SRbits.IPL = ipl;
+	stub_mask_ipl = RADIO_INT_PRIORITY;
+	stub_masked = 0;
+	stub_masked_max = 0;
+	before = stub_cycles;
+
+	load();
+
+	SRbits.IPL = 0;
+	busy = stub_cycles - before;
+	stub_mask_ipl = 8;
+
+	return stub_masked_max;
+}
+
+// This function resets the board as if it had just been powered on,
+//	less the devices, which are left as they'd be once they're up
+void reset(void)
+{
+	SRbits.IPL = 0;
+	PORTAbits.RA4 = 1;
+
+	init_clock();
+	init_pools();
+	init_events();
+	init_sched();
+	init_power();
+	init_game_vars();
+	init_timer_1();
+	init_timer_2();
+	init_timer_4();
+
+	wl_module_prepare();
+	wl_module_tx_reset();
+	wl_module_rate_reset();
+	wl_module_start();
+}
+
+// The loads. The display's are two lines too long to fit, so that it
+//	rewrites both of them on every scroll.
+void load_display(void)
+{
+	int i;
+
+	for (i = 0; i < 2 * TIMER_4_INT_SCROLL; i++)
+	{
+		_T4Interrupt();
+	}
+}
+
+void load_rfid(void)
+{
+	unsigned char datain[RFID_REQ_LEN] = { RFID_IDREQ, 0x20 };
+	unsigned char dataout[RFID_MAX_LEN];
+	rfid_xfer_t xfer;
+
+	// Up to where it waits on the card
+	rfid_xfer_init(&xfer, datain, RFID_REQ_LEN, dataout);
+	rfid_transcieve_thread(&xfer);
+}
+
+void load_radio(void)
+{
+	unsigned char pload[wl_module_PAYLOAD_LEN] = { 0 };
+
+	wl_module_send_command(W_TX_PAYLOAD, pload, NULL, wl_module_PAYLOAD_LEN);
+	wl_module_get_status();
+	wl_module_carrier_count(wl_module_CH, CHAN_SCAN_SAMPLES);
+}
+
+void load_t1(void)
+{
+	_T1Interrupt();
+}
+
+void load_t2(void)
+{
+	_T2Interrupt();
+}
+
+void load_main(void)
+{
+	sched_run();
+	prepare_next_request();
+	process_events();
+}
+
+// The radio is the highest priority on the SPI, only the LED scan is
+//	above it, and the interrupts which write to the display and the
+//	RFID are below it
+void test_priorities(void)
+{
+	reset();
+	init_leds();
+
+	TEST_CHECK(IPC7bits.INT2IP == RADIO_INT_PRIORITY);
+	TEST_CHECK(TIMER_3_PRIORITY > RADIO_INT_PRIORITY);
+	TEST_CHECK(CRIT_SPI_IPL >= RADIO_INT_PRIORITY);
+	TEST_CHECK(CRIT_SPI_IPL < LED_INT_PRIORITY);
+	TEST_CHECK(TIMER_4_PRIORITY < RADIO_INT_PRIORITY);
+	TEST_CHECK(TIMER_2_PRIORITY < RADIO_INT_PRIORITY);
+
+	// Timer 1 is at the radio's priority, so all of it counts
+	TEST_CHECK(TIMER_1_PRIORITY == RADIO_INT_PRIORITY);
+}
+
+// The display's 37 us waits are between frames, so however many lines
+//	it rewrites, the radio only ever waits on one character
+void test_display(void)
+{
+	reset();
+	display_scroll_set(DISPLAY_LINE_1, SCROLL_ON);
+	display_scroll_set(DISPLAY_LINE_2, SCROLL_ON);
+	display_write_line(DISPLAY_LINE_1, "THE FIRST LINE IS TOO LONG");
+	display_write_line(DISPLAY_LINE_2, "AND SO IS THE SECOND ONE");
+
+	held_display = run_at(TIMER_4_PRIORITY, load_display);
+	TEST_CHECK(held_display <= FRAME_CYCLES(1));
+
+	// Four rewrites of 17 characters
+	TEST_CHECK(busy >= 4 * (DISP_CHARS_PER_LINE + 1) * 37UL * CLOCK_CYCLES_PER_US);
+}
+
+// A transcieve with a card is a handful of short frames
+void test_rfid(void)
+{
+	reset();
+
+	held_rfid = run_at(0, load_rfid);
+	TEST_CHECK(held_rfid <= FRAME_CYCLES(1 + RFID_REQ_LEN));
+	TEST_CHECK(held_rfid >= FRAME_CYCLES(1 + RFID_REQ_LEN) - FRAME_OVERHEAD_CYCLES);
+}
+
+// The longest frame of all is a whole payload to the radio, and the
+//	channel scan's settling is outside its frames
+void test_radio(void)
+{
+	reset();
+
+	held_radio = run_at(0, load_radio);
+	TEST_CHECK(held_radio <= FRAME_CYCLES(1 + wl_module_PAYLOAD_LEN));
+	TEST_CHECK(held_radio >= FRAME_CYCLES(1 + wl_module_PAYLOAD_LEN) - FRAME_OVERHEAD_CYCLES);
+	TEST_CHECK(busy >= CHAN_SCAN_SAMPLES * (unsigned long)WL_RPD_SETTLE_US * CLOCK_CYCLES_PER_US);
+}
+
+// In a game, with the threads and the timers running the radio, none of
+//	them holds the radio off for longer than a frame. Timer 1 doesn't
+//	touch the SPI at all, even when a request fails.
+void test_game(void)
+{
+	int i;
+
+	reset();
+	register_player(1, THIS_BOARD_INPUTS);
+	register_player(2, THIS_BOARD_INPUTS);
+	begin_game();
+	sched_start(network_thread);
+	sched_start(poll_thread);
+	sched_start(chan_thread);
+
+	held_t2 = 0;
+	held_main = 0;
+	for (i = 0; i < 1000; i++)
+	{
+		held_t2 = MAX(held_t2, run_at(TIMER_2_PRIORITY, load_t2));
+		held_main = MAX(held_main, run_at(0, load_main));
+	}
+	TEST_CHECK(held_t2 <= FRAME_CYCLES(1 + wl_module_PAYLOAD_LEN));
+	TEST_CHECK(held_main <= FRAME_CYCLES(1 + wl_module_PAYLOAD_LEN));
+
+	my_reqs[0].time = 1;
+	held_t1 = run_at(RADIO_INT_PRIORITY, load_t1);
+	TEST_CHECK(busy < FRAME_CYCLES(1));
+}
+
+// All told, the radio waits on the longest frame, then on the LED scan
+//	which came in at the end of it, then gets in
+void test_worst(void)
+{
+	unsigned long worst = 0;
+
+	worst = MAX(worst, held_display);
+	worst = MAX(worst, held_rfid);
+	worst = MAX(worst, held_radio);
+	worst = MAX(worst, held_t2);
+	worst = MAX(worst, held_main);
+	worst = MAX(worst, held_t1 + T1_ISR_CYCLES);
+	worst += LED_ISR_CYCLES + INT_ENTRY_CYCLES;
+
+	printf("radio held off, in cycles: display %lu, rfid %lu, radio %lu, timer 2 %lu, main loop %lu, timer 1 %lu\n",
+		   held_display, held_rfid, held_radio, held_t2, held_main, held_t1 + T1_ISR_CYCLES);
+	printf("worst radio latency %lu cycles, %lu us\n", worst, worst / CLOCK_CYCLES_PER_US);
+
+	TEST_CHECK(worst <= LATENCY_MAX_US * CLOCK_CYCLES_PER_US);
+}
+
+int main(void)
+{
+	TEST_RUN(test_priorities);
+	TEST_RUN(test_display);
+	TEST_RUN(test_rfid);
+	TEST_RUN(test_radio);
+	TEST_RUN(test_game);
+	TEST_RUN(test_worst);
+
+	TEST_DONE();
+}
@@ -0,0 +1,107 @@
+//
+// These are the tests for a slave's requests which stay on its own board.
+//	The master keeps the request table, so when one of them ends the
+//	slave has to send the master a copy, or the slot stays taken for
+//	the rest of the game. They run as player 1, with the whole game on
+//	the simulated radio.
+//
+
+#include <stddef.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_game.c
+extern issued_req_t my_reqs[MAX_ISSUED_REQS];
+extern unsigned char reqs_completed;
+
+// The board whose request on us is done next, if any
+unsigned char done_board;
+
+// This function stands in for the inputs. Only the one request is done,
+//	and not the one which might be made on the spot to replace it.
+int check_request_completed(spaceteam_request_t * req)
+{
+	if (req->board != done_board)
+	{
+		return 0;
+	}
+
+	done_board = NUM_PLAYERS;
+	return 1;
+}
+
+// This function starts a game against the master. We've no request slots
+//	from it yet, so our first request is one we picked on our own board.
+void start(void)
+{
+	sim_reset();
+	done_board = NUM_PLAYERS;
+	sim_start_game(PLAYER_BIT(MASTER_PLAYER) | PLAYER_BIT(THIS_PLAYER));
+	sim_run_ms(MSG_AGG_DEADLINE_MS);
+
+	TEST_CHECK(my_reqs[0].time == REQ_TIME_MAX);
+	TEST_CHECK(my_reqs[0].req.board == THIS_PLAYER);
+
+	// The master heard about it
+	TEST_CHECK(sim_find(MSG_NEW_REQ, my_reqs[0].req.type, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+}
+
+// A request on our own board which times out is copied to the master
+void test_failed(void)
+{
+	spaceteam_req_t type;
+
+	start();
+	type = my_reqs[0].req.type;
+	sim_clear_log();
+
+	sim_run_ms(REQ_TIME_MAX * SIM_T1_MS);
+	TEST_CHECK(sim_find(MSG_REQ_FAILED, type, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+	TEST_CHECK(!sim_find(MSG_REQ_COMPLETED, type, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+}
+
+// A request on our own board which we complete is copied to the master,
+//	and counts as one of ours being done
+void test_completed(void)
+{
+	spaceteam_req_t type;
+
+	start();
+	type = my_reqs[0].req.type;
+	sim_clear_log();
+
+	done_board = THIS_PLAYER;
+	sim_run_ms(1 + MSG_AGG_DEADLINE_MS);
+	TEST_CHECK(sim_find(MSG_REQ_COMPLETED, type, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+	TEST_CHECK(!sim_find(MSG_REQ_FAILED, type, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+	TEST_CHECK(reqs_completed == 1);
+}
+
+// A request another board gave us is only sent back to its issuer, by
+//	way of the master, with no copy
+void test_other_board(void)
+{
+	start();
+	sim_receive(MSG_NEW_REQ, KNOB_REQ, 2, THIS_PLAYER, 3);
+	sim_clear_log();
+
+	done_board = 2;
+	sim_run_ms(1 + MSG_AGG_DEADLINE_MS);
+	TEST_CHECK(sim_find(MSG_REQ_COMPLETED, KNOB_REQ, THIS_PLAYER, 2, MASTER_PLAYER));
+	TEST_CHECK(!sim_find(MSG_REQ_COMPLETED, KNOB_REQ, THIS_PLAYER, THIS_PLAYER, MASTER_PLAYER));
+}
+
+int main(void)
+{
+	TEST_RUN(test_failed);
+	TEST_RUN(test_completed);
+	TEST_RUN(test_other_board);
+
+	TEST_DONE();
+}
@@ -0,0 +1,322 @@
+//
+// These are the tests for the message wire format: msg_pack and
+//	msg_unpack, and the payloads which msg_queue puts together. The rest
+//	of the game is stubbed out below, and the radio just keeps the last
+//	payload it was asked to send.
+//
+
+#include <stddef.h>
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "test.h"
+
+int test_failures;
+
+// The last payload the radio sent, and how many it has sent
+unsigned char sent_buf[wl_module_PAYLOAD_LEN];
+unsigned char sent_len;
+unsigned char sent_dest;
+int sent_count;
+
+int wl_module_send_payload(const unsigned char * pload, unsigned char len, spaceteam_player_t player)
+{
+	memcpy(sent_buf, pload, len);
+	sent_len = len;
+	sent_dest = player;
+	sent_count++;
+
+	return SUCCESS;
+}
+
+int wl_module_send_broadcast(const unsigned char * pload, unsigned char len)
+{
+	return wl_module_send_payload(pload, len, ALL_PLAYERS);
+}
+
+int wl_module_send_ack(const unsigned char * pload, unsigned char len)
+{
+	return wl_module_send_payload(pload, len, MASTER_PLAYER);
+}
+
+unsigned char wl_module_tx_take_lost(unsigned char * buf)
+{
+	return 0;
+}
+
+// The rest of the game, which the message code calls into
+void alloc_note_message(spaceteam_msg_t msg, spaceteam_req_t req, unsigned char sender, unsigned char recipient, unsigned short val) { }
+void alloc_release_grant(unsigned char player, spaceteam_req_t type, unsigned char board) { }
+void alloc_release_grants(unsigned char player) { }
+void alloc_store_grant(spaceteam_req_t type, unsigned char board) { }
+void clock_boost(void) { }
+void clock_release(void) { }
+void begin_game(void) { }
+void register_request(spaceteam_req_t type, unsigned char board, unsigned short val) { }
+void deregister_request(spaceteam_req_t type, unsigned char board, unsigned short val) { }
+void request_done(spaceteam_req_t type, unsigned char board) { }
+int dec_game_health(void) { return 1; }
+void register_player(unsigned char player, unsigned short inputs) { }
+unsigned char get_active_players(void) { return 0; }
+unsigned char get_game_state(void) { return GAME_WAITING; }
+void poll_note_sent(unsigned char player) { }
+
+// This function packs a packet, checks its length, and unpacks it again
+void round_trip(unsigned char type, unsigned char sender, unsigned char recipient, unsigned char request, unsigned short val)
+{
+	spaceteam_packet_t in;
+	spaceteam_packet_t out;
+	unsigned char buf[WIRE_MAX_LEN + 1];
+	unsigned char len;
+	unsigned char expect;
+	int has_req = ((WIRE_REQ_MSGS & (1 << type)) != 0);
+
+	in.type = type;
+	in.sender = sender;
+	in.recipient = recipient;
+	in.request = request;
+	in.val = val;
+
+	buf[WIRE_MAX_LEN] = 0xA5;
+	len = msg_pack(&in, buf);
+
+	expect = WIRE_HEADER_LEN + has_req + ((val == 0) ? 0 : ((val <= 0xFF) ? 1 : 2));
+	TEST_CHECK(len == expect);
+	TEST_CHECK(len <= WIRE_MAX_LEN);
+	TEST_CHECK(buf[WIRE_MAX_LEN] == 0xA5);
+
+	memset(&out, 0xFF, sizeof(out));
+	TEST_CHECK(msg_unpack(buf, len, &out) == len);
+	TEST_CHECK(out.type == type);
+	TEST_CHECK(out.sender == sender);
+	TEST_CHECK(out.recipient == recipient);
+	TEST_CHECK(out.val == val);
+
+	// The request type only goes with the messages about requests
+	TEST_CHECK(out.request == (has_req ? request : 0));
+
+	// And anything cut short is turned away
+	while (len > 0)
+	{
+		len--;
+		TEST_CHECK(msg_unpack(buf, len, &out) == 0);
+	}
+}
+
+// Every message type, player and request type comes back as it went,
+//	with values of each length
+void test_round_trip(void)
+{
+	static const unsigned short vals[] = { 0, 1, 0x7F, 0xFF, 0x100, 0x1234, 0xFF00, 0xFFFF };
+	unsigned char type;
+	unsigned char sender;
+	unsigned char recipient;
+	unsigned char request;
+	unsigned i;
+
+	for (type = 0; type < NUM_MSGS; type++)
+	{
+		for (sender = 0; sender < NUM_PLAYERS; sender++)
+		{
+			for (recipient = 0; recipient <= ALL_PLAYERS; recipient++)
+			{
+				if ( (recipient >= NUM_PLAYERS) && (recipient != ALL_PLAYERS) )
+				{
+					continue;
+				}
+
+				for (i = 0; i < sizeof(vals) / sizeof(vals[0]); i++)
+				{
+					round_trip(type, sender, recipient, (sender + i) & 0x0F, vals[i]);
+				}
+			}
+		}
+
+		for (request = 0; request < (1 << REQ_TYPE_BITS); request++)
+		{
+			round_trip(type, 1, 2, request, 0x0203);
+		}
+	}
+}
+
+// Packets one after another in a payload are read out in order
+void test_several(void)
+{
+	spaceteam_packet_t in[3];
+	spaceteam_packet_t out;
+	unsigned char buf[3 * WIRE_MAX_LEN];
+	unsigned char len = 0;
+	unsigned char pos = 0;
+	unsigned char used;
+	int i;
+
+	memset(in, 0, sizeof(in));
+	in[0].type = MSG_NEW_REQ;
+	in[0].sender = 1;
+	in[0].recipient = 3;
+	in[0].request = 5;
+	in[0].val = 0x0102;
+	in[1].type = MSG_POLL;
+	in[2].type = MSG_REQ_COMPLETED;
+	in[2].sender = 2;
+	in[2].recipient = MASTER_PLAYER;
+	in[2].request = 9;
+	in[2].val = 0x80;
+
+	for (i = 0; i < 3; i++)
+	{
+		len += msg_pack(&in[i], &buf[len]);
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		used = msg_unpack(&buf[pos], len - pos, &out);
+		TEST_CHECK(used != 0);
+		TEST_CHECK(out.type == in[i].type);
+		TEST_CHECK(out.sender == in[i].sender);
+		TEST_CHECK(out.recipient == in[i].recipient);
+		TEST_CHECK(out.request == in[i].request);
+		TEST_CHECK(out.val == in[i].val);
+		pos += used;
+	}
+	TEST_CHECK(pos == len);
+}
+
+// Headers which can't have come from this version of the game are
+//	turned away
+void test_bad_headers(void)
+{
+	spaceteam_packet_t out;
+	unsigned char buf[WIRE_MAX_LEN];
+	unsigned char good0 = (WIRE_VERSION << WIRE_VERSION_SHIFT) | (MSG_POLL << WIRE_TYPE_SHIFT);
+	unsigned char good1 = (1 << WIRE_SENDER_SHIFT) | 2;
+
+	buf[0] = good0;
+	buf[1] = good1;
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 2);
+
+	// Another version
+	buf[0] = good0 ^ (1 << WIRE_VERSION_SHIFT);
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 0);
+	buf[0] = good0 ^ (2 << WIRE_VERSION_SHIFT);
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 0);
+
+	// A type past the last one
+	buf[0] = (WIRE_VERSION << WIRE_VERSION_SHIFT) | (WIRE_TYPE_MASK << WIRE_TYPE_SHIFT);
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 0);
+
+	// A value longer than a word
+	buf[0] = good0 | 3;
+	TEST_CHECK(msg_unpack(buf, WIRE_MAX_LEN, &out) == 0);
+
+	// Players which don't exist, though all of them is fine
+	buf[0] = good0;
+	buf[1] = (NUM_PLAYERS << WIRE_SENDER_SHIFT) | 2;
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 0);
+	buf[1] = (1 << WIRE_SENDER_SHIFT) | NUM_PLAYERS;
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 0);
+	buf[1] = (1 << WIRE_SENDER_SHIFT) | ALL_PLAYERS;
+	TEST_CHECK(msg_unpack(buf, 2, &out) == 2);
+	TEST_CHECK(out.recipient == ALL_PLAYERS);
+}
+
+#if (THIS_PLAYER == MASTER_PLAYER)
+
+// This function queues a message for a board
+void queue(unsigned char type, unsigned char dest, unsigned short val)
+{
+	spaceteam_packet_t packet;
+
+	packet.type = type;
+	packet.sender = THIS_PLAYER;
+	packet.recipient = dest;
+	packet.request = 3;
+	packet.val = val;
+
+	TEST_CHECK(msg_queue(&packet, dest) == SUCCESS);
+}
+
+// Messages to the same board wait and go out in one payload, which
+//	unpacks to all of them
+void test_aggregate(void)
+{
+	spaceteam_packet_t out;
+	unsigned char pos = 0;
+	unsigned char used;
+	int i;
+
+	init_sched();
+	init_pools();
+	sent_count = 0;
+
+	queue(MSG_NEW_REQ, 2, 0x10);
+	queue(MSG_REQ_FAILED, 2, 0x1234);
+	queue(MSG_HEALTH, 2, 0);
+	TEST_CHECK(sent_count == 0);
+	TEST_CHECK(msg_pending());
+
+	// They go once the first has waited long enough
+	msg_service();
+	TEST_CHECK(sent_count == 0);
+	sched_tick(MSG_AGG_DEADLINE_MS);
+	msg_service();
+	TEST_CHECK(sent_count == 1);
+	TEST_CHECK(sent_dest == 2);
+	TEST_CHECK(!msg_pending());
+
+	for (i = 0; i < 3; i++)
+	{
+		used = msg_unpack(&sent_buf[pos], sent_len - pos, &out);
+		TEST_CHECK(used != 0);
+		TEST_CHECK(out.recipient == 2);
+		pos += used;
+	}
+	TEST_CHECK(pos == sent_len);
+
+	// A message to another board sends the waiting ones first
+	queue(MSG_NEW_REQ, 1, 0x55);
+	queue(MSG_NEW_REQ, 3, 0x66);
+	TEST_CHECK(sent_count == 2);
+	TEST_CHECK(sent_dest == 1);
+	TEST_CHECK(msg_unpack(sent_buf, sent_len, &out) == sent_len);
+	TEST_CHECK(out.val == 0x55);
+
+	// And an urgent one goes straight out, along with what was waiting
+	queue(MSG_POLL, 3, 0);
+	TEST_CHECK(sent_count == 3);
+	TEST_CHECK(sent_dest == 3);
+	used = msg_unpack(sent_buf, sent_len, &out);
+	TEST_CHECK(out.val == 0x66);
+	TEST_CHECK(msg_unpack(&sent_buf[used], sent_len - used, &out) == sent_len - used);
+	TEST_CHECK(out.type == MSG_POLL);
+
+	// A full payload is sent before the one which doesn't fit
+	for (i = 0; i < WL_MSG_PAYLOAD_LEN / WIRE_MAX_LEN; i++)
+	{
+		queue(MSG_NEW_REQ, 4, 0x1234);
+	}
+	TEST_CHECK(sent_count == 3);
+	queue(MSG_NEW_REQ, 4, 0x1234);
+	TEST_CHECK(sent_count == 4);
+	TEST_CHECK(sent_len == (WL_MSG_PAYLOAD_LEN / WIRE_MAX_LEN) * WIRE_MAX_LEN);
+	TEST_CHECK(msg_pending());
+}
+
+#endif
+
+int main(void)
+{
+	TEST_RUN(test_round_trip);
+	TEST_RUN(test_several);
+	TEST_RUN(test_bad_headers);
+	#if (THIS_PLAYER == MASTER_PLAYER)
+		TEST_RUN(test_aggregate);
+	#endif
+
+	TEST_DONE();
+}
@@ -0,0 +1,267 @@
+//
+// This is the simulation of the master's poller, which shows how long a
+//	slave's message waits to get to the master against how many boards
+//	are in the game. It runs as the master, with the whole game on the
+//	simulated radio. A slave's message waits for the next payload the
+//	master sends it, and goes back in the ACK.
+//
+// The radio has the master's TX ring in front of it, and gets through
+//	one payload a ms, which is about what a payload, the turnarounds and
+//	an ACK with a payload in it take at the base rate. So the more slaves
+//	there are, the longer a poll can wait behind the others.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_poll.h"
+#include "spaceteam_wireless.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// How long each game runs for
+#define GAME_MS					(5UL * 60 * 1000)
+
+// The slaves have a message for the master every so often, on average,
+//	in ms. In a busy game it's every few polls, and in a quiet one it's
+//	every few slowest polls. Either way they go quiet for a while now and
+//	then, so that they're polled at every rate.
+#define BUSY_GAP_MS				20
+#define QUIET_GAP_MS			300
+#define PAUSE_GAP_MS			1000
+#define PAUSE_ONE_IN			64
+
+// How often the slaves have a message in the game being played
+unsigned msg_gap;
+
+// The payloads which have gone to the radio and not out yet, oldest
+//	first, and how many bytes of the ring they take
+#define AIR_QUEUE_LEN			(WL_TX_RING_SIZE / WL_TX_ENTRY_HDR)
+
+typedef struct _air_entry_t
+{
+	unsigned char dest;
+	unsigned char len;
+} air_entry_t;
+
+air_entry_t air_queue[AIR_QUEUE_LEN];
+unsigned air_len;
+unsigned air_bytes;
+
+#define MAX(a, b)				(((a) > (b)) ? (a) : (b))
+
+// When each slave's oldest waiting message was ready, or 0 if it has
+//	none, and when it will have its next one
+unsigned long ready_at[NUM_PLAYERS];
+unsigned long next_at[NUM_PLAYERS];
+
+// What the slaves' messages waited, and the most the master thought
+//	any of them could have
+unsigned long waited_max;
+unsigned long waited_total;
+unsigned long waited_count;
+unsigned long measured_max;
+unsigned long under_measured;
+
+// The polls which went out
+unsigned long polls;
+
+// The average wait in the quiet games, by number of players
+unsigned long quiet_avg[NUM_PLAYERS + 1];
+
+// The game goes on however many requests fail
+int dec_game_health(void)
+{
+	return 1;
+}
+
+// This function returns when a slave will next have a message
+unsigned long next_msg(void)
+{
+	if (sim_random_in(PAUSE_ONE_IN) == 0)
+	{
+		return sim_ms + 1 + sim_random_in(2 * PAUSE_GAP_MS);
+	}
+
+	return sim_ms + 1 + sim_random_in(2 * msg_gap);
+}
+
+// This function says whether the radio has room for another payload.
+//	The longest payload has to fit, since the sim can't turn one away
+//	once it's been handed it.
+void air_update(void)
+{
+	if ( (air_len == AIR_QUEUE_LEN) ||
+		 (air_bytes + WL_MSG_PAYLOAD_LEN + WL_TX_ENTRY_HDR > WL_TX_RING_SIZE) )
+	{
+		sim_radio_status = FAILURE;
+	}
+	else
+	{
+		sim_radio_status = SUCCESS;
+	}
+}
+
+// This function is the radio. It puts the payload in the ring behind
+//	the others.
+void air_receive(unsigned char dest, const unsigned char * buf, unsigned char len)
+{
+	spaceteam_packet_t packet;
+
+	if ( (msg_unpack(buf, len, &packet) != 0) && (packet.type == MSG_POLL) )
+	{
+		polls++;
+	}
+
+	air_queue[air_len].dest = dest;
+	air_queue[air_len].len = len;
+	air_len++;
+	air_bytes += len + WL_TX_ENTRY_HDR;
+	air_update();
+}
+
+// This function sends the payload at the front of the ring, if there's
+//	one. The slave it was for sends back its waiting message, if it has
+//	one, in the ACK. Broadcasts aren't ACKed.
+void air_run(void)
+{
+	unsigned char dest;
+	unsigned long waited;
+	unsigned i;
+
+	if (air_len == 0)
+	{
+		return;
+	}
+
+	dest = air_queue[0].dest;
+	air_bytes -= air_queue[0].len + WL_TX_ENTRY_HDR;
+	for (i = 1; i < air_len; i++)
+	{
+		air_queue[i - 1] = air_queue[i];
+	}
+	air_len--;
+
+	air_update();
+
+	if ( (dest < NUM_PLAYERS) && (ready_at[dest] != 0) )
+	{
+		waited = sim_ms - ready_at[dest];
+		ready_at[dest] = 0;
+
+		poll_note_heard(dest);
+
+		waited_max = MAX(waited_max, waited);
+		waited_total += waited;
+		waited_count++;
+		measured_max = MAX(measured_max, poll_get_latency(dest));
+		if (poll_get_latency(dest) < waited)
+		{
+			under_measured++;
+		}
+	}
+}
+
+// This function plays a game with the passed number of players, whose
+//	slaves have a message about every gap ms, and returns the longest one
+//	of them waited
+unsigned long play(int players, unsigned gap)
+{
+	int i;
+
+	sim_reset();
+	msg_gap = gap;
+	sim_radio_hook = air_receive;
+	air_len = 0;
+	air_bytes = 0;
+	waited_max = 0;
+	waited_total = 0;
+	waited_count = 0;
+	measured_max = 0;
+	under_measured = 0;
+	polls = 0;
+
+	for (i = 0; i < NUM_PLAYERS; i++)
+	{
+		ready_at[i] = 0;
+		next_at[i] = next_msg();
+	}
+
+	sim_start_game((1 << players) - 1);
+	sched_start(poll_thread);
+
+	while (sim_ms < GAME_MS)
+	{
+		for (i = 1; i < players; i++)
+		{
+			if (sim_ms >= next_at[i])
+			{
+				if (ready_at[i] == 0)
+				{
+					ready_at[i] = sim_ms;
+				}
+				next_at[i] = next_msg();
+			}
+		}
+
+		air_run();
+		sim_tick();
+	}
+
+	TEST_CHECK(waited_count != 0);
+	TEST_CHECK(under_measured == 0);
+	if (waited_count == 0)
+	{
+		return 0;
+	}
+
+	printf("%s %d players: messages waited %lu ms at worst, %lu ms on average, the master measured %lu ms at worst, %lu polls a second\n",
+		   (gap == BUSY_GAP_MS) ? "busy " : "quiet", players, waited_max, waited_total / waited_count, measured_max, polls / (GAME_MS / 1000));
+
+	return waited_max;
+}
+
+// However many boards there are, every message gets through within a
+//	slowest poll and a trip through the ring behind a poll to each of
+//	the others, and the master's measure of it is never less than it was
+void test_latency_bound(void)
+{
+	unsigned long waited;
+	int players;
+
+	for (players = 2; players <= NUM_PLAYERS; players++)
+	{
+		waited = play(players, QUIET_GAP_MS);
+		TEST_CHECK(waited <= POLL_MAX_MS + players);
+		quiet_avg[players] = (waited_count != 0) ? waited_total / waited_count : 0;
+	}
+}
+
+// Slaves with a lot to say are polled faster, so on average their
+//	messages wait less than quiet ones', but no longer at worst
+void test_busy(void)
+{
+	unsigned long waited;
+	int players;
+
+	for (players = 2; players <= NUM_PLAYERS; players++)
+	{
+		waited = play(players, BUSY_GAP_MS);
+		TEST_CHECK(waited <= POLL_MAX_MS + players);
+		TEST_CHECK(waited_total < quiet_avg[players] * waited_count);
+	}
+}
+
+int main(void)
+{
+	TEST_RUN(test_latency_bound);
+	TEST_RUN(test_busy);
+
+	TEST_DONE();
+}
@@ -0,0 +1,230 @@
+//
+// These are the tests for the random numbers the requests are made from:
+//	the xorshift, the scaling into a range and the weighted pick of a
+//	request type, and the bounded rerolls which use them. The generator
+//	goes through every non-zero state once a period, so the spreads here
+//	are counted over a whole period and are exact, not sampled.
+//
+// How many cycles the multiply takes next to the divide it replaced can
+//	only be counted on the PIC, in the simulator or with the profiling
+//	build, so it isn't checked here.
+//
+
+#include <stddef.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_alloc.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_game.c and spaceteam_alloc.c
+extern unsigned short lfsr;
+extern const unsigned char req_type_weights[NO_REQ];
+extern unsigned short req_reserved[NUM_PLAYERS];
+
+// The number of states in a period of the generator
+#define PERIOD					0xFFFFUL
+
+// How many times the request rerolls asked whether a request was pending
+int pending_calls;
+
+// This function stands in for the pending requests, which are all of them
+int is_request_pending(spaceteam_req_t type, unsigned char board)
+{
+	pending_calls++;
+	return 1;
+}
+
+// This function returns the number of draws it takes the generator to
+//	get from the passed state to the one it's in now
+unsigned long draws_since(unsigned short from)
+{
+	unsigned short to = lfsr;
+	unsigned long draws = 0;
+
+	lfsr = from;
+	while (lfsr != to)
+	{
+		lfsr_get_random();
+		draws++;
+	}
+
+	return draws;
+}
+
+// The generator goes through every non-zero state before it repeats,
+//	and is kicked out of zero
+void test_period(void)
+{
+	static unsigned char seen[0x10000 / 8];
+	unsigned long i;
+	unsigned short val;
+	int repeats = 0;
+
+	lfsr = 0;
+	val = lfsr_get_random();
+	TEST_CHECK(val != 0);
+
+	for (i = 0; i < PERIOD; i++)
+	{
+		val = lfsr_get_random();
+		if (seen[val >> 3] & (1 << (val & 7)))
+		{
+			repeats++;
+		}
+		seen[val >> 3] |= (1 << (val & 7));
+	}
+
+	TEST_CHECK(repeats == 0);
+	TEST_CHECK(!(seen[0] & 1));
+}
+
+// Over a period, every value in a range comes up as often as every
+//	other, give or take one, and nothing outside it ever does
+void test_range_spread(void)
+{
+	static const unsigned short ranges[] = { 1, 2, 3, 5, NUM_PLAYERS - 1, NUM_KNOB_VALS, 13, 100, NUM_KEYPAD_VALS };
+	static unsigned long counts[NUM_KEYPAD_VALS];
+	unsigned long lo, hi;
+	unsigned short val;
+	unsigned long i;
+	unsigned r, j;
+
+	for (r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+	{
+		for (j = 0; j < ranges[r]; j++)
+		{
+			counts[j] = 0;
+		}
+
+		lfsr = RNG_ZERO_SEED;
+		for (i = 0; i < PERIOD; i++)
+		{
+			val = random_in_range(ranges[r]);
+			TEST_CHECK(val < ranges[r]);
+			if (val < ranges[r])
+			{
+				counts[val]++;
+			}
+		}
+
+		lo = PERIOD;
+		hi = 0;
+		for (j = 0; j < ranges[r]; j++)
+		{
+			lo = (counts[j] < lo) ? counts[j] : lo;
+			hi = (counts[j] > hi) ? counts[j] : hi;
+		}
+		TEST_CHECK(hi - lo <= 1);
+	}
+}
+
+// Over a period, each request type comes up in proportion to its weight,
+//	give or take its weight
+void test_type_spread(void)
+{
+	unsigned long counts[NO_REQ];
+	unsigned long expect;
+	unsigned long total = 0;
+	unsigned long i;
+	spaceteam_req_t type;
+
+	sim_reset();
+
+	for (type = 0; type < NO_REQ; type++)
+	{
+		counts[type] = 0;
+		total += req_type_weights[type];
+	}
+
+	lfsr = RNG_ZERO_SEED;
+	for (i = 0; i < PERIOD; i++)
+	{
+		type = random_request_type();
+		TEST_CHECK(type < NO_REQ);
+		if (type < NO_REQ)
+		{
+			counts[type]++;
+		}
+	}
+
+	for (type = 0; type < NO_REQ; type++)
+	{
+		expect = (PERIOD * req_type_weights[type]) / total;
+		TEST_CHECK(counts[type] + req_type_weights[type] >= expect);
+		TEST_CHECK(counts[type] <= expect + req_type_weights[type]);
+	}
+
+	// The weighted ones are picked twice as often as the switches
+	TEST_CHECK(counts[KEYPAD_REQ] > counts[KNOB_REQ + 1] * 19 / 10);
+	TEST_CHECK(counts[KNOB_REQ] > counts[NO_REQ - 1] * 19 / 10);
+}
+
+// A request picked on our own board gives up after REQ_GEN_MAX_TRIES
+//	when everything it picks is already pending, rather than hanging
+void test_pick_gives_up(void)
+{
+	spaceteam_request_t req;
+
+	sim_reset();
+
+	// Every input on the only other board is taken, so the master has
+	//	no slot for us either
+	register_player(1, THIS_BOARD_INPUTS);
+	req_reserved[1] = THIS_BOARD_INPUTS;
+
+	pending_calls = 0;
+	pick_request(&req);
+	TEST_CHECK(pending_calls == REQ_GEN_MAX_TRIES);
+	TEST_CHECK(req.board == THIS_PLAYER);
+	TEST_CHECK(req.type < NO_REQ);
+}
+
+// The master gives up on a board which is full after REQ_GEN_MAX_TRIES
+//	draws, on top of the one picking the board, and takes nothing
+void test_slot_gives_up(void)
+{
+	spaceteam_request_t req;
+	unsigned short before;
+
+	sim_reset();
+	register_player(1, THIS_BOARD_INPUTS);
+	register_player(2, THIS_BOARD_INPUTS);
+	req_reserved[1] = THIS_BOARD_INPUTS;
+	req_reserved[2] = THIS_BOARD_INPUTS;
+
+	before = lfsr = RNG_ZERO_SEED;
+	TEST_CHECK(alloc_request_slot(THIS_PLAYER, &req) == FAILURE);
+	TEST_CHECK(draws_since(before) == 1 + REQ_GEN_MAX_TRIES);
+	TEST_CHECK(req_reserved[1] == THIS_BOARD_INPUTS);
+	TEST_CHECK(req_reserved[2] == THIS_BOARD_INPUTS);
+
+	// With one input free it's found most of the time, and always
+	//	within the tries when it is
+	req_reserved[1] &= ~(1 << KEYPAD_REQ);
+	req_reserved[2] &= ~(1 << KEYPAD_REQ);
+	before = lfsr;
+	if (alloc_request_slot(THIS_PLAYER, &req) == SUCCESS)
+	{
+		TEST_CHECK(req.type == KEYPAD_REQ);
+		TEST_CHECK(draws_since(before) <= 1 + REQ_GEN_MAX_TRIES);
+	}
+	else
+	{
+		TEST_CHECK(draws_since(before) == 1 + REQ_GEN_MAX_TRIES);
+	}
+}
+
+int main(void)
+{
+	TEST_RUN(test_period);
+	TEST_RUN(test_range_spread);
+	TEST_RUN(test_type_spread);
+	TEST_RUN(test_pick_gives_up);
+	TEST_RUN(test_slot_gives_up);
+
+	TEST_DONE();
+}
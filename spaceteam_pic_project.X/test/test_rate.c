@@ -0,0 +1,201 @@
+//
+// These are the tests for the master's side of a link changing rate.
+//	The master only follows a slave to a new rate once the MSG_RATE
+//	which told it was ACKed. If it never was, the slave might have moved
+//	or not, so the master stays at the old rate and gives the slave time
+//	to come back to it. They run as the master, on a stand-in for the
+//	module which only notes what it's given.
+//
+
+#include <stddef.h>
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "nRF24L01.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_wireless.c
+extern const unsigned char wl_rate_setup[WL_NUM_RATES];
+
+// The slave the rate changes are for
+#define SLAVE					1
+
+// The rate the module's set to, and the last payload it was given and
+//	how many it's been given
+unsigned char air_setup;
+unsigned char loaded[wl_module_PAYLOAD_LEN];
+unsigned char loaded_len;
+int loads;
+
+// The module. Every payload it sends goes on the first try, and it's
+//	always done with all of them when it says so.
+void wl_module_send_command(unsigned char command, const unsigned char * datain, unsigned char * dataout, unsigned char data_len)
+{
+	if (command == W_TX_PAYLOAD)
+	{
+		memcpy(loaded, datain, data_len);
+		loaded_len = data_len;
+		loads++;
+	}
+}
+
+void wl_module_write_register_byte(unsigned char reg, unsigned char value)
+{
+	if (reg == RF_SETUP)
+	{
+		air_setup = value;
+	}
+}
+
+unsigned char wl_module_read_register_byte(unsigned char reg)
+{
+	return (reg == FIFO_STATUS) ? (1 << TX_EMPTY) : 0;
+}
+
+// This function starts the radio with nothing to send, and every link
+//	at the base rate
+void reset(void)
+{
+	init_pools();
+	init_events();
+	init_sched();
+	wl_module_tx_reset();
+	wl_module_rate_reset();
+	air_setup = wl_rate_setup[WL_RATE_BASE];
+	loads = 0;
+}
+
+// This function runs timer 2's part of the radio for the passed number
+//	of ms
+void tick(unsigned ms)
+{
+	while (ms-- != 0)
+	{
+		sched_tick(1);
+		wl_module_tx_service();
+	}
+}
+
+// This function returns 1 if the last payload loaded told the slave to
+//	go to the passed rate
+int loaded_rate(unsigned char rate)
+{
+	spaceteam_packet_t packet;
+
+	return ( (msg_unpack(&loaded[WL_LINK_HDR_LEN], loaded_len - WL_LINK_HDR_LEN, &packet) != 0) &&
+			 (packet.type == MSG_RATE) && (packet.val == rate) );
+}
+
+// This function sends the slave a payload, and returns 1 if it went at
+//	the passed rate
+int sent_at(unsigned char rate)
+{
+	unsigned char pload = 0;
+	int before = loads;
+
+	wl_module_send_payload(&pload, 1, SLAVE);
+	return ( (loads == before + 1) && (air_setup == wl_rate_setup[rate]) );
+}
+
+// When the MSG_RATE is ACKed, the master follows, and sends the slave
+//	everything after it at the new rate
+void test_acked(void)
+{
+	reset();
+
+	wl_module_rate_propose(SLAVE, WL_RATE_1M);
+	TEST_CHECK(loads == 1);
+	TEST_CHECK(loaded_rate(WL_RATE_1M));
+	TEST_CHECK(air_setup == wl_rate_setup[WL_RATE_BASE]);
+	TEST_CHECK(wl_module_get_link_rate(SLAVE) == WL_RATE_BASE);
+	TEST_CHECK(wl_module_rates_in_use() == ((1 << WL_RATE_BASE) | (1 << WL_RATE_1M)));
+
+	wl_module_tx_sent();
+	TEST_CHECK(wl_module_get_link_rate(SLAVE) == WL_RATE_1M);
+	TEST_CHECK(sent_at(WL_RATE_1M));
+}
+
+// When it never is, the master tries it again at the old rate, and then
+//	stays there. The slave can't be sent anything until it's had time to
+//	give up on the new rate, and then it's at the old one, not the base.
+void test_never_acked(void)
+{
+	int i;
+
+	reset();
+	wl_module_rate_propose(SLAVE, WL_RATE_1M);
+	wl_module_tx_sent();
+
+	wl_module_rate_propose(SLAVE, WL_RATE_2M);
+	TEST_CHECK(loaded_rate(WL_RATE_2M));
+	for (i = 0; i < WL_TX_SW_RETRIES; i++)
+	{
+		loads = 0;
+		wl_module_tx_failed();
+		tick(WL_TX_BACKOFF_MS << i);
+		TEST_CHECK(loads == 1);
+		TEST_CHECK(loaded_rate(WL_RATE_2M));
+		TEST_CHECK(air_setup == wl_rate_setup[WL_RATE_1M]);
+	}
+	wl_module_tx_failed();
+
+	TEST_CHECK(wl_module_get_link_rate(SLAVE) == WL_RATE_1M);
+	TEST_CHECK(wl_module_rates_in_use() == ((1 << WL_RATE_BASE) | (1 << WL_RATE_1M)));
+
+	loads = 0;
+	wl_module_send_payload(loaded, 1, SLAVE);
+	tick(WL_RATE_TRY_MS - 1);
+	TEST_CHECK(wl_module_tx_is_held(SLAVE));
+	TEST_CHECK(loads == 0);
+	tick(1);
+	TEST_CHECK(!wl_module_tx_is_held(SLAVE));
+	TEST_CHECK(loads == 1);
+	TEST_CHECK(air_setup == wl_rate_setup[WL_RATE_1M]);
+	wl_module_tx_sent();
+
+	// And the next change can go ahead as usual
+	wl_module_rate_propose(SLAVE, WL_RATE_2M);
+	wl_module_tx_sent();
+	TEST_CHECK(wl_module_get_link_rate(SLAVE) == WL_RATE_2M);
+}
+
+// Any other payload which fails means we can't tell where the slave is,
+//	so that still goes back to the base rate
+void test_other_failed(void)
+{
+	int i;
+
+	reset();
+	wl_module_rate_propose(SLAVE, WL_RATE_1M);
+	wl_module_tx_sent();
+
+	for (i = 0; i <= WL_TX_SW_RETRIES; i++)
+	{
+		if (i == 0)
+		{
+			TEST_CHECK(sent_at(WL_RATE_1M));
+		}
+		wl_module_tx_failed();
+		tick(WL_TX_BACKOFF_MS << i);
+	}
+
+	TEST_CHECK(wl_module_get_link_rate(SLAVE) == WL_RATE_BASE);
+	TEST_CHECK(!wl_module_tx_is_held(SLAVE));
+}
+
+int main(void)
+{
+	TEST_RUN(test_acked);
+	TEST_RUN(test_never_acked);
+	TEST_RUN(test_other_failed);
+
+	TEST_DONE();
+}
@@ -0,0 +1,183 @@
+//
+// These are the tests for a slave's side of a link changing rate. The
+//	slave moves when the master tells it to, but only keeps the new rate
+//	once something new from the master comes in at it, which means the
+//	master heard its ACK and followed. Otherwise it goes back to the old
+//	rate. They run as player 1, on a stand-in for the module which hands
+//	over the payloads the test gives it.
+//
+
+#include <stddef.h>
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "nRF24L01.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_wireless.c
+extern const unsigned char wl_rate_setup[WL_NUM_RATES];
+
+// The payload in the module's RX FIFO, if there is one, and the pipe it
+//	came in on
+unsigned char rx_pipe = WL_PIPE_EMPTY;
+unsigned char rx_buf[wl_module_PAYLOAD_LEN];
+unsigned char rx_len;
+
+// The rate the module's set to
+unsigned char air_setup;
+
+// The master's sequence number for our link
+unsigned char seq;
+
+// The module
+unsigned char wl_module_get_status(void)
+{
+	return (rx_pipe << RX_P_NO);
+}
+
+void wl_module_send_command(unsigned char command, const unsigned char * datain, unsigned char * dataout, unsigned char data_len)
+{
+	if (command == R_RX_PL_WID)
+	{
+		dataout[0] = rx_len;
+	}
+	else if (command == R_RX_PAYLOAD)
+	{
+		memcpy(dataout, rx_buf, data_len);
+		rx_pipe = WL_PIPE_EMPTY;
+	}
+}
+
+void wl_module_write_register_byte(unsigned char reg, unsigned char value)
+{
+	if (reg == RF_SETUP)
+	{
+		air_setup = value;
+	}
+}
+
+// This function starts the radio at the base rate
+void reset(void)
+{
+	init_pools();
+	init_events();
+	init_sched();
+	wl_module_tx_reset();
+	wl_module_rate_reset();
+	wl_module_set_rate(WL_RATE_BASE);
+}
+
+// This function runs timer 2's part of the radio for the passed number
+//	of ms
+void tick(unsigned ms)
+{
+	while (ms-- != 0)
+	{
+		sched_tick(1);
+		wl_module_rate_service();
+	}
+}
+
+// This function has a payload with the passed message and sequence
+//	number come in on the passed pipe, and parses it
+void receive(unsigned char pipe, unsigned char number, spaceteam_msg_t type, unsigned char val)
+{
+	spaceteam_packet_t packet;
+
+	packet.type = type;
+	packet.sender = MASTER_PLAYER;
+	packet.recipient = (pipe == WL_PIPE_BCAST) ? ALL_PLAYERS : THIS_PLAYER;
+	packet.request = 0;
+	packet.val = val;
+
+	rx_buf[0] = number;
+	rx_len = WL_LINK_HDR_LEN + msg_pack(&packet, &rx_buf[WL_LINK_HDR_LEN]);
+	rx_pipe = pipe;
+
+	wl_module_rx_drain();
+	wl_module_rx_service();
+}
+
+// This function returns 1 if we're at the passed rate
+int at(unsigned char rate)
+{
+	return ( (wl_module_get_rate() == rate) && (air_setup == wl_rate_setup[rate]) );
+}
+
+// The master heard our ACK and sent the next payload at the new rate,
+//	so we keep it
+void test_followed(void)
+{
+	reset();
+
+	receive(WL_PIPE_MASTER, ++seq, MSG_RATE, WL_RATE_1M);
+	TEST_CHECK(at(WL_RATE_1M));
+	TEST_CHECK(wl_module_rate_trying());
+
+	tick(WL_RATE_TRY_MS / 2);
+	receive(WL_PIPE_MASTER, ++seq, MSG_POLL, 0);
+	TEST_CHECK(!wl_module_rate_trying());
+
+	tick(2 * WL_RATE_TRY_MS);
+	TEST_CHECK(at(WL_RATE_1M));
+}
+
+// The master never heard our ACK, so it's still at the old rate and
+//	nothing comes in at the new one. We go back to the old rate, not the
+//	base, since that's where the master stays.
+void test_not_followed(void)
+{
+	reset();
+	receive(WL_PIPE_MASTER, ++seq, MSG_RATE, WL_RATE_1M);
+	receive(WL_PIPE_MASTER, ++seq, MSG_POLL, 0);
+
+	receive(WL_PIPE_MASTER, ++seq, MSG_RATE, WL_RATE_2M);
+	TEST_CHECK(at(WL_RATE_2M));
+
+	tick(WL_RATE_TRY_MS - 1);
+	TEST_CHECK(at(WL_RATE_2M));
+	tick(1);
+	TEST_CHECK(at(WL_RATE_1M));
+	TEST_CHECK(!wl_module_rate_trying());
+
+	// And the master's next payload at it finds us there
+	receive(WL_PIPE_MASTER, ++seq, MSG_POLL, 0);
+	tick(2 * WL_RATE_TRY_MS);
+	TEST_CHECK(at(WL_RATE_1M));
+}
+
+// The MSG_RATE again doesn't mean the master followed, since it sends
+//	that at the old rate, and neither does a broadcast, which goes out at
+//	every rate a slave might be at
+void test_not_proof(void)
+{
+	unsigned char rate_seq;
+
+	reset();
+
+	rate_seq = ++seq;
+	receive(WL_PIPE_MASTER, rate_seq, MSG_RATE, WL_RATE_1M);
+	receive(WL_PIPE_MASTER, rate_seq, MSG_RATE, WL_RATE_1M);
+	receive(WL_PIPE_BCAST, seq, MSG_POLL, 0);
+	TEST_CHECK(wl_module_rate_trying());
+
+	tick(WL_RATE_TRY_MS);
+	TEST_CHECK(at(WL_RATE_BASE));
+}
+
+int main(void)
+{
+	TEST_RUN(test_followed);
+	TEST_RUN(test_not_followed);
+	TEST_RUN(test_not_proof);
+
+	TEST_DONE();
+}
@@ -0,0 +1,299 @@
+//
+// These are the tests for the protothread macros and the scheduler
+//	which runs them. The threads here just note how far they've got, so
+//	the tests can check where each one stopped.
+//
+
+#include <stddef.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_sched.h"
+#include "test.h"
+
+int test_failures;
+
+// How far the test threads have got, and what they're waiting on
+int step;
+int flag;
+int child_runs;
+
+// This thread waits on the flag, yields, and then finishes
+char wait_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	step = 1;
+	PT_WAIT_UNTIL(pt, flag);
+	step = 2;
+	PT_YIELD(pt);
+	step = 3;
+
+	PT_END(pt);
+}
+
+// This thread waits 100ms twice
+char timed_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	step = 1;
+	PT_WAIT_MS(pt, 100);
+	step = 2;
+	PT_WAIT_MS(pt, 100);
+	step = 3;
+
+	PT_END(pt);
+}
+
+// This thread waits for the main loop to handle a checkpoint
+char event_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	PT_WAIT_EVENT(pt, EVENT_CHECKPOINT);
+	step++;
+
+	PT_END(pt);
+}
+
+// This child takes two runs to finish
+char child_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	child_runs++;
+	PT_YIELD(pt);
+	child_runs++;
+
+	PT_END(pt);
+}
+
+// This thread runs the child, and then stops early if the flag is set
+char parent_thread(pt_t * pt)
+{
+	static pt_t child;
+
+	PT_BEGIN(pt);
+
+	step = 1;
+	PT_SPAWN(pt, &child, child_thread(&child));
+	step = 2;
+	if (flag)
+	{
+		PT_EXIT(pt);
+	}
+	PT_YIELD(pt);
+	step = 3;
+
+	PT_END(pt);
+}
+
+// This thread never finishes
+char forever_thread(pt_t * pt)
+{
+	PT_BEGIN(pt);
+
+	while (1)
+	{
+		PT_YIELD(pt);
+	}
+
+	PT_END(pt);
+}
+
+// This function moves the clock on to just before the passed time
+void clock_to(unsigned short ms)
+{
+	sched_tick(ms - sched_get_ms());
+}
+
+// A wait stays where it is until its condition holds, and a yield gives
+//	up exactly one run
+void test_wait_and_yield(void)
+{
+	pt_t pt;
+
+	step = 0;
+	flag = 0;
+	PT_INIT(&pt);
+
+	TEST_CHECK(wait_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+	TEST_CHECK(wait_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+
+	flag = 1;
+	TEST_CHECK(wait_thread(&pt) == PT_YIELDED);
+	TEST_CHECK(step == 2);
+	TEST_CHECK(wait_thread(&pt) == PT_EXITED);
+	TEST_CHECK(step == 3);
+
+	// And once it's done it starts over from the top
+	flag = 0;
+	TEST_CHECK(wait_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+}
+
+// A timed wait is up once the clock reaches it, even across the clock
+//	wrapping
+void test_wait_ms(void)
+{
+	pt_t pt;
+
+	init_sched();
+	clock_to(0xFFC0);
+	step = 0;
+	PT_INIT(&pt);
+
+	TEST_CHECK(timed_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+
+	sched_tick(99);
+	TEST_CHECK(timed_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+
+	sched_tick(1);
+	TEST_CHECK(sched_get_ms() == 0x0024);
+	TEST_CHECK(timed_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 2);
+
+	sched_tick(150);
+	TEST_CHECK(timed_thread(&pt) == PT_EXITED);
+	TEST_CHECK(step == 3);
+}
+
+// Times are compared by their difference, for up to half a wrap
+void test_ms_passed(void)
+{
+	init_sched();
+	clock_to(0xFFF0);
+
+	TEST_CHECK(sched_ms_passed(0xFFF0));
+	TEST_CHECK(sched_ms_passed(0xFF00));
+	TEST_CHECK(!sched_ms_passed(0xFFF1));
+	TEST_CHECK(!sched_ms_passed(0x0010));
+
+	sched_tick(0x20);
+	TEST_CHECK(sched_ms_passed(0x0010));
+	TEST_CHECK(sched_ms_passed(0xFFF0));
+	TEST_CHECK(!sched_ms_passed(0x0011));
+}
+
+// Threads run in the table until they finish, and the table fills up
+void test_table(void)
+{
+	init_sched();
+	step = 0;
+	flag = 0;
+
+	TEST_CHECK(sched_start(wait_thread) == SUCCESS);
+	TEST_CHECK(sched_start(forever_thread) == SUCCESS);
+	TEST_CHECK(sched_start(forever_thread) == SUCCESS);
+	TEST_CHECK(sched_start(forever_thread) == SUCCESS);
+	TEST_CHECK(sched_start(forever_thread) == FAILURE);
+
+	sched_run();
+	sched_run();
+	TEST_CHECK(step == 1);
+	TEST_CHECK(sched_is_running(wait_thread));
+
+	flag = 1;
+	sched_run();
+	TEST_CHECK(step == 2);
+	TEST_CHECK(sched_is_running(wait_thread));
+	sched_run();
+	TEST_CHECK(step == 3);
+	TEST_CHECK(!sched_is_running(wait_thread));
+
+	// Its slot is free again
+	TEST_CHECK(sched_start(timed_thread) == SUCCESS);
+	TEST_CHECK(sched_is_running(timed_thread));
+	TEST_CHECK(sched_start(timed_thread) == FAILURE);
+}
+
+// An event handled by the main loop is seen on the next pass only
+void test_events(void)
+{
+	init_sched();
+	step = 0;
+
+	TEST_CHECK(sched_start(event_thread) == SUCCESS);
+	sched_run();
+	TEST_CHECK(step == 0);
+
+	// Some other event doesn't wake it
+	sched_post_event(EVENT_ROTATE_DISPLAY);
+	sched_run();
+	TEST_CHECK(step == 0);
+	TEST_CHECK(sched_event_seen(EVENT_ROTATE_DISPLAY));
+	TEST_CHECK(!sched_event_seen(EVENT_CHECKPOINT));
+
+	sched_post_event(EVENT_CHECKPOINT);
+	TEST_CHECK(!sched_event_seen(EVENT_CHECKPOINT));
+	sched_run();
+	TEST_CHECK(step == 1);
+	TEST_CHECK(!sched_is_running(event_thread));
+
+	// It's forgotten after the pass which saw it
+	TEST_CHECK(sched_start(event_thread) == SUCCESS);
+	sched_run();
+	TEST_CHECK(step == 1);
+	TEST_CHECK(!sched_event_seen(EVENT_CHECKPOINT));
+}
+
+// A spawned child runs to the end before the parent goes on, and an
+//	exit stops the parent where it is
+void test_spawn_and_exit(void)
+{
+	pt_t pt;
+
+	step = 0;
+	flag = 0;
+	child_runs = 0;
+	PT_INIT(&pt);
+
+	TEST_CHECK(parent_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+	TEST_CHECK(child_runs == 1);
+	TEST_CHECK(parent_thread(&pt) == PT_YIELDED);
+	TEST_CHECK(step == 2);
+	TEST_CHECK(child_runs == 2);
+	TEST_CHECK(parent_thread(&pt) == PT_EXITED);
+	TEST_CHECK(step == 3);
+
+	// The child starts from the top each time it's spawned
+	flag = 1;
+	TEST_CHECK(parent_thread(&pt) == PT_WAITING);
+	TEST_CHECK(child_runs == 3);
+	TEST_CHECK(parent_thread(&pt) == PT_EXITED);
+	TEST_CHECK(step == 2);
+	TEST_CHECK(child_runs == 4);
+
+	// And the parent starts from the top after its exit
+	TEST_CHECK(parent_thread(&pt) == PT_WAITING);
+	TEST_CHECK(step == 1);
+}
+
+// Running a thread blocking runs it to the end in one go
+void test_run_blocking(void)
+{
+	pt_t pt;
+
+	child_runs = 0;
+	PT_INIT(&pt);
+	PT_RUN_BLOCKING(child_thread(&pt));
+	TEST_CHECK(child_runs == 2);
+}
+
+int main(void)
+{
+	TEST_RUN(test_wait_and_yield);
+	TEST_RUN(test_wait_ms);
+	TEST_RUN(test_ms_passed);
+	TEST_RUN(test_table);
+	TEST_RUN(test_events);
+	TEST_RUN(test_spawn_and_exit);
+	TEST_RUN(test_run_blocking);
+
+	TEST_DONE();
+}
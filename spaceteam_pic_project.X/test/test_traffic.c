@@ -0,0 +1,271 @@
+//
+// This is the benchmark for how many payloads the master sends a game
+//	minute, next to how many messages are in them. Without the messages
+//	being put together in msg_agg_buf, each would be a payload of its own.
+//	It runs as the master, with the whole game on the simulated radio.
+//	The other boards do half the requests they're given, and use the
+//	slots they're granted to make requests on each other, which the
+//	master passes on.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_alloc.h"
+#include "spaceteam_sched.h"
+#include "sim.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_msg.c
+extern unsigned short msg_agg_since;
+
+// How long each game runs for
+#define GAME_MS					(10UL * 60 * 1000)
+
+// The other boards use a grant, and do a request they're going to do,
+//	somewhere in this long
+#define USE_SPREAD_MS			(5000UL)
+#define DONE_SPREAD_MS			(20000UL)
+
+// The most requests the other boards have out on each other at once,
+//	including the ones they've been granted but haven't made yet. Like
+//	the master, a board only has MAX_ISSUED_REQS out at a time.
+#define MAX_SLAVE_REQS			(NUM_PLAYERS * (MAX_ISSUED_REQS + REQ_GRANT_BATCH))
+
+// A request one of the other boards made on another with a grant. It's
+//	made at made_at, and then done at done_at, or failed by whoever made
+//	it once its time is up if done_at is 0. A made_at of 0 means the
+//	entry is free.
+typedef struct _slave_req_t
+{
+	unsigned char issuer;
+	unsigned char board;
+	spaceteam_req_t type;
+	unsigned long made_at;
+	unsigned long done_at;
+	unsigned char made;
+} slave_req_t;
+
+slave_req_t slave_reqs[MAX_SLAVE_REQS];
+
+// The master's requests out on each of the other boards, as in
+//	test_deadlines. An issued time of 0 means there isn't one.
+unsigned long issued_at[NUM_PLAYERS][NO_REQ];
+unsigned long done_at[NUM_PLAYERS][NO_REQ];
+
+// The messages which waited longer than the deadline to go out
+unsigned long late;
+
+// The game goes on however many requests fail
+int dec_game_health(void)
+{
+	return 1;
+}
+
+// This function returns half the time a time in the next passed
+//	number of ms, and 0 the other half
+unsigned long maybe_in(unsigned long spread)
+{
+	if (sim_random_in(2) == 0)
+	{
+		return 0;
+	}
+
+	return sim_ms + 1 + sim_random_in(spread);
+}
+
+// This function is the other boards' radio. They note the requests
+//	they're given and the slots they're granted.
+void boards_receive(unsigned char dest, const unsigned char * buf, unsigned char len)
+{
+	spaceteam_packet_t packet;
+	unsigned char pos = 0;
+	unsigned char used;
+	int i;
+
+	while ( (pos < len) && ((used = msg_unpack(&buf[pos], len - pos, &packet)) != 0) )
+	{
+		pos += used;
+
+		if (dest >= NUM_PLAYERS)
+		{
+			continue;
+		}
+
+		if ( (packet.type == MSG_NEW_REQ) && (packet.sender == MASTER_PLAYER) )
+		{
+			issued_at[dest][packet.request] = sim_ms;
+			done_at[dest][packet.request] = maybe_in(DONE_SPREAD_MS);
+		}
+		else if ( (packet.type == MSG_REQ_FAILED) && (packet.sender == MASTER_PLAYER) )
+		{
+			issued_at[dest][packet.request] = 0;
+		}
+		else if (packet.type == MSG_REQ_GRANT)
+		{
+			for (i = 0; (i < MAX_SLAVE_REQS) && (slave_reqs[i].made_at != 0); i++)
+			{
+			}
+			TEST_CHECK(i < MAX_SLAVE_REQS);
+			if (i < MAX_SLAVE_REQS)
+			{
+				slave_reqs[i].issuer = dest;
+				slave_reqs[i].board = packet.val;
+				slave_reqs[i].type = packet.request;
+				slave_reqs[i].made_at = sim_ms + 1 + sim_random_in(USE_SPREAD_MS);
+				slave_reqs[i].made = 0;
+			}
+		}
+	}
+}
+
+// This function returns the number of requests the passed board has made
+//	which are still out
+int made_by(unsigned char issuer)
+{
+	int made = 0;
+	int i;
+
+	for (i = 0; i < MAX_SLAVE_REQS; i++)
+	{
+		if ( (slave_reqs[i].made_at != 0) && slave_reqs[i].made && (slave_reqs[i].issuer == issuer) )
+		{
+			made++;
+		}
+	}
+
+	return made;
+}
+
+// This function has the other boards send the master what they've done,
+//	and make the requests they've room for
+void boards_run(void)
+{
+	slave_req_t * req;
+	int board;
+	int type;
+	int i;
+
+	for (board = 0; board < NUM_PLAYERS; board++)
+	{
+		for (type = 0; type < NO_REQ; type++)
+		{
+			if ( (issued_at[board][type] != 0) && (done_at[board][type] != 0) && (sim_ms >= done_at[board][type]) )
+			{
+				issued_at[board][type] = 0;
+				sim_receive(MSG_REQ_COMPLETED, type, board, MASTER_PLAYER, 0);
+			}
+		}
+	}
+
+	for (i = 0; i < MAX_SLAVE_REQS; i++)
+	{
+		req = &slave_reqs[i];
+		if ( (req->made_at == 0) || (sim_ms < req->made_at) )
+		{
+			continue;
+		}
+
+		if (!req->made)
+		{
+			if (made_by(req->issuer) >= MAX_ISSUED_REQS)
+			{
+				continue;
+			}
+			req->made_at = sim_ms;
+			req->made = 1;
+			req->done_at = maybe_in(DONE_SPREAD_MS);
+			sim_receive(MSG_NEW_REQ, req->type, req->issuer, req->board, 0);
+		}
+		else if ( (req->done_at != 0) && (sim_ms >= req->done_at) )
+		{
+			req->made_at = 0;
+			sim_receive(MSG_REQ_COMPLETED, req->type, req->board, req->issuer, 0);
+		}
+		else if ( (req->done_at == 0) && (sim_ms >= req->made_at + REQ_TIME_MAX * (unsigned long)SIM_T1_MS) )
+		{
+			req->made_at = 0;
+			sim_receive(MSG_REQ_FAILED, req->type, req->issuer, req->board, 0);
+		}
+	}
+}
+
+// This function plays a game with the passed number of players, and
+//	prints how much went over the radio
+void play(int players)
+{
+	unsigned long payloads;
+	unsigned long packets;
+	int board;
+	int type;
+	int i;
+
+	sim_reset();
+	sim_radio_hook = boards_receive;
+	late = 0;
+
+	for (board = 0; board < NUM_PLAYERS; board++)
+	{
+		for (type = 0; type < NO_REQ; type++)
+		{
+			issued_at[board][type] = 0;
+		}
+	}
+	for (i = 0; i < MAX_SLAVE_REQS; i++)
+	{
+		slave_reqs[i].made_at = 0;
+	}
+
+	sim_start_game((1 << players) - 1);
+
+	while (sim_ms < GAME_MS)
+	{
+		boards_run();
+		sim_tick();
+
+		// Timer 2 sends them on the tick after the deadline
+		if ( msg_pending() && ((unsigned short)(sched_get_ms() - msg_agg_since) > MSG_AGG_DEADLINE_MS + 1) )
+		{
+			late++;
+		}
+	}
+
+	payloads = sim_payloads / (GAME_MS / 60000);
+	packets = sim_packets / (GAME_MS / 60000);
+	TEST_CHECK(payloads != 0);
+	if (payloads == 0)
+	{
+		return;
+	}
+
+	printf("%d players: %lu messages a game minute in %lu payloads, %lu.%02lu to a payload\n",
+		   players, packets, payloads, packets / payloads, (packets * 100 / payloads) % 100);
+
+	TEST_CHECK(late == 0);
+	TEST_CHECK(payloads < packets);
+}
+
+// Only messages to the same board go out together, so the more boards
+//	there are the fewer of them share a payload, but it saves payloads
+//	with any number of them. None of them waits past the deadline.
+void test_traffic(void)
+{
+	int players;
+
+	for (players = 2; players <= NUM_PLAYERS; players++)
+	{
+		play(players);
+	}
+}
+
+int main(void)
+{
+	TEST_RUN(test_traffic);
+
+	TEST_DONE();
+}
@@ -0,0 +1,548 @@
+//
+// These are the tests for the master's TX ring. The payloads stay in it
+//	until the module says they've gone, and wrap round its end, and the
+//	ones to a board we're backing off from go to the back while the rest
+//	go out. They run as the master, on a stand-in for the module with
+//	its three deep TX FIFO, which sends each payload or gives up on it
+//	depending on who it's for. They don't use sim.c, which stands in for
+//	the ring itself.
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "xc.h"
+#include "spaceteam_general.h"
+#include "spaceteam_game.h"
+#include "spaceteam_msg.h"
+#include "spaceteam_pool.h"
+#include "spaceteam_event.h"
+#include "spaceteam_sched.h"
+#include "spaceteam_wireless.h"
+#include "nRF24L01.h"
+#include "test.h"
+
+int test_failures;
+
+// From spaceteam_wireless.c
+extern unsigned char wl_tx_ring[WL_TX_RING_SIZE];
+extern unsigned char wl_tx_head;
+extern unsigned char wl_tx_load;
+extern unsigned char wl_tx_tail;
+extern unsigned char wl_tx_used;
+extern unsigned char wl_tx_queued;
+extern unsigned char wl_tx_loaded;
+extern unsigned char wl_tx_dest;
+extern unsigned char wl_tx_held;
+extern unsigned short wl_tx_retry_at[NUM_PLAYERS];
+
+// How long the long run queues payloads for, in ms, and the most it
+//	takes to empty the ring after
+#define RUN_MS					(20UL * 1000)
+#define DRAIN_MS				(10UL * 1000)
+
+// How many payloads can be told apart. Each one has its number after
+//	the link header, and then bytes made from it.
+#define MAX_PAYLOADS			8192
+#define ID_LEN					2
+#define MIN_LEN					(WL_LINK_HDR_LEN + ID_LEN)
+
+// How often a payload to each board is never ACKed, in percent. Board 3
+//	is off.
+const unsigned char fail_pct[NUM_PLAYERS] = { 0, 0, 30, 100, 5 };
+
+// What happened to each payload
+typedef struct _payload_t
+{
+	unsigned char dest;
+	unsigned char len;
+	unsigned loads;
+	unsigned char delivered;
+	unsigned char failed;
+} payload_t;
+
+payload_t payloads[MAX_PAYLOADS];
+unsigned num_payloads;
+
+// The module's TX FIFO
+typedef struct _fifo_entry_t
+{
+	unsigned char dest;
+	unsigned char len;
+	unsigned char buf[wl_module_PAYLOAD_LEN];
+} fifo_entry_t;
+
+fifo_entry_t fifo[WL_TX_FIFO_DEPTH];
+unsigned fifo_len;
+
+// The time, in ms, and the last payload which went to each board, plus
+//	one
+unsigned long now;
+unsigned last_delivered[ALL_PLAYERS + 1];
+
+// How many payloads in a row to each board the module gave up on
+unsigned char streak[NUM_PLAYERS];
+
+// How many times the end of the ring was skipped, and payloads loaded
+//	which weren't what was queued
+unsigned long wraps;
+unsigned long garbled;
+
+// The test's own random numbers. A 32-bit xorshift.
+unsigned long seed = 0x2545F491;
+
+unsigned long random_in(unsigned long range)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed % range;
+}
+
+// This function returns the number of the passed payload
+unsigned payload_id(const unsigned char * buf)
+{
+	return buf[WL_LINK_HDR_LEN] | (buf[WL_LINK_HDR_LEN + 1] << 8);
+}
+
+// This function returns 1 if the passed payload is the one it says it is
+int payload_ok(const unsigned char * buf, unsigned char len)
+{
+	unsigned id = payload_id(buf);
+	unsigned char i;
+
+	if ( (id >= num_payloads) || (len != payloads[id].len) )
+	{
+		return 0;
+	}
+
+	for (i = MIN_LEN; i < len; i++)
+	{
+		if (buf[i] != (unsigned char)(id + i))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// The module. It's given payloads for whoever its address is set to.
+void wl_module_send_command(unsigned char command, const unsigned char * datain, unsigned char * dataout, unsigned char data_len)
+{
+	fifo_entry_t * entry;
+	unsigned id;
+
+	if (command == FLUSH_TX)
+	{
+		fifo_len = 0;
+	}
+	else if ( (command == W_TX_PAYLOAD) || (command == W_TX_PAYLOAD_NOACK) )
+	{
+		TEST_CHECK(fifo_len < WL_TX_FIFO_DEPTH);
+		if (fifo_len == WL_TX_FIFO_DEPTH)
+		{
+			return;
+		}
+
+		entry = &fifo[fifo_len++];
+		entry->dest = wl_tx_dest & WL_DEST_MASK;
+		entry->len = data_len;
+		memcpy(entry->buf, datain, data_len);
+
+		// Nothing goes to a board we're backing off from
+		TEST_CHECK(!wl_module_tx_is_held(entry->dest));
+		TEST_CHECK((command == W_TX_PAYLOAD_NOACK) == (entry->dest == ALL_PLAYERS));
+
+		if (!payload_ok(datain, data_len))
+		{
+			garbled++;
+			return;
+		}
+
+		id = payload_id(datain);
+		TEST_CHECK(payloads[id].dest == entry->dest);
+		payloads[id].loads++;
+	}
+}
+
+unsigned char wl_module_read_register_byte(unsigned char reg)
+{
+	return ( (reg == FIFO_STATUS) && (fifo_len == 0) ) ? (1 << TX_EMPTY) : 0;
+}
+
+void wl_module_write_register_byte(unsigned char reg, unsigned char value)
+{
+}
+
+// The links all stay at the base rate, so the ring only has what the
+//	test put in it
+void wl_module_rate_note(unsigned char dest, unsigned char arc)
+{
+}
+
+// This function starts the radio with nothing to send
+void reset(void)
+{
+	init_pools();
+	init_events();
+	init_sched();
+	wl_module_tx_reset();
+	wl_module_rate_reset();
+
+	fifo_len = 0;
+	num_payloads = 0;
+	now = 0;
+	wraps = 0;
+	garbled = 0;
+	memset(last_delivered, 0, sizeof(last_delivered));
+	memset(streak, 0, sizeof(streak));
+}
+
+// This function queues a payload of the passed length to the passed
+//	board, and returns its number, or MAX_PAYLOADS if there was no room
+unsigned queue(unsigned char dest, unsigned char len)
+{
+	unsigned char buf[wl_module_PAYLOAD_LEN];
+	unsigned char tail = wl_tx_tail;
+	unsigned char used = wl_tx_used;
+	unsigned id = num_payloads;
+	unsigned char i;
+
+	if (id == MAX_PAYLOADS)
+	{
+		return MAX_PAYLOADS;
+	}
+
+	buf[0] = 0;
+	buf[WL_LINK_HDR_LEN] = id & 0xFF;
+	buf[WL_LINK_HDR_LEN + 1] = id >> 8;
+	for (i = MIN_LEN; i < len; i++)
+	{
+		buf[i] = id + i;
+	}
+
+	payloads[id].dest = dest;
+	payloads[id].len = len;
+	payloads[id].loads = 0;
+	payloads[id].delivered = 0;
+	payloads[id].failed = 0;
+
+	// The module can be given it straight away
+	num_payloads++;
+	if (wl_module_tx_queue(buf, len, dest) != SUCCESS)
+	{
+		num_payloads--;
+		return MAX_PAYLOADS;
+	}
+
+	if ( (used != 0) && (wl_tx_tail < tail) && (wl_tx_ring[tail] == WL_TX_WRAP) )
+	{
+		wraps++;
+	}
+
+	return id;
+}
+
+// This function walks the ring from the head, and returns 1 if its
+//	entries add up to what it says is in use and end at the tail
+int ring_ok(void)
+{
+	unsigned char idx = wl_tx_head;
+	unsigned used = 0;
+	unsigned char i;
+
+	for (i = 0; i < wl_tx_loaded + wl_tx_queued; i++)
+	{
+		if (wl_tx_ring[idx] == WL_TX_WRAP)
+		{
+			used += WL_TX_RING_SIZE - idx;
+			idx = 0;
+		}
+		if ( (wl_tx_ring[idx] == 0) || (wl_tx_ring[idx] > wl_module_PAYLOAD_LEN) )
+		{
+			return 0;
+		}
+		used += wl_tx_ring[idx] + WL_TX_ENTRY_HDR;
+		idx = wl_module_tx_next(idx);
+	}
+
+	return ( (used == wl_tx_used) && ((used == 0) || (idx == wl_tx_tail)) );
+}
+
+// This function notes the payload at the front of the module's FIFO as
+//	sent, and the last one to its board which was
+void delivered(const fifo_entry_t * entry)
+{
+	unsigned id;
+
+	if (!payload_ok(entry->buf, entry->len))
+	{
+		return;
+	}
+
+	id = payload_id(entry->buf);
+	TEST_CHECK(!payloads[id].delivered && !payloads[id].failed);
+	payloads[id].delivered = 1;
+	last_delivered[entry->dest] = id + 1;
+}
+
+// This function has the module try the payload at the front of its
+//	FIFO. If it's given up on for good, the messages in it are kept.
+//	That's after WL_TX_SW_RETRIES more failures in a row to the same
+//	board, which might not all have been that payload.
+void air_step(void)
+{
+	fifo_entry_t entry;
+	unsigned char lost[WL_MSG_PAYLOAD_LEN];
+	unsigned char len;
+	unsigned id;
+
+	if (fifo_len == 0)
+	{
+		return;
+	}
+
+	entry = fifo[0];
+	if ( (entry.dest < NUM_PLAYERS) && (random_in(100) < fail_pct[entry.dest]) )
+	{
+		streak[entry.dest]++;
+		wl_module_tx_failed();
+
+		len = wl_module_tx_take_lost(lost);
+		if (len != 0)
+		{
+			id = lost[0] | (lost[1] << 8);
+			TEST_CHECK(id == payload_id(entry.buf));
+			TEST_CHECK(len == entry.len - WL_LINK_HDR_LEN);
+			TEST_CHECK(streak[entry.dest] == WL_TX_SW_RETRIES + 1);
+			TEST_CHECK(!payloads[id].delivered && !payloads[id].failed);
+			payloads[id].failed = 1;
+			streak[entry.dest] = 0;
+		}
+	}
+	else
+	{
+		if (entry.dest < NUM_PLAYERS)
+		{
+			streak[entry.dest] = 0;
+		}
+		fifo_len--;
+		memmove(&fifo[0], &fifo[1], fifo_len * sizeof(fifo[0]));
+		delivered(&entry);
+		wl_module_tx_sent();
+	}
+}
+
+// This function runs the radio for a ms, which is time for two tries
+void tick(void)
+{
+	air_step();
+	air_step();
+
+	now++;
+	sched_tick(1);
+	wl_module_tx_service();
+}
+
+// A payload which doesn't fit at the end of the ring goes at the start,
+//	and the end is skipped. It comes back once the ones in front have
+//	gone, and the ring starts again at the front once it's empty.
+void test_wrap(void)
+{
+	unsigned char len = wl_module_PAYLOAD_LEN - WL_TX_ENTRY_HDR;
+	unsigned char end = len + 10 + 2 * WL_TX_ENTRY_HDR;
+	unsigned first, second, third;
+
+	reset();
+
+	// Two to a board we're backing off from, so they stay, and there's
+	//	no room for another that long at the end or the start
+	wl_tx_held = PLAYER_BIT(1);
+	first = queue(1, len);
+	second = queue(1, 10);
+	TEST_CHECK(wl_tx_tail == end);
+	TEST_CHECK(queue(1, len) == MAX_PAYLOADS);
+	TEST_CHECK(ring_ok());
+
+	// Once the first has gone, it goes at the start
+	wl_tx_held = 0;
+	wl_module_tx_pump();
+	air_step();
+	third = queue(1, len);
+	TEST_CHECK(third != MAX_PAYLOADS);
+	TEST_CHECK(wraps == 1);
+	TEST_CHECK(wl_tx_ring[end] == WL_TX_WRAP);
+	TEST_CHECK(wl_module_tx_skip_wrap(end) == 0);
+	TEST_CHECK(wl_tx_tail == len + WL_TX_ENTRY_HDR);
+	TEST_CHECK(ring_ok());
+
+	while (wl_module_tx_busy())
+	{
+		air_step();
+	}
+	TEST_CHECK(payloads[first].delivered && payloads[second].delivered && payloads[third].delivered);
+	TEST_CHECK(wl_tx_used == 0);
+
+	// Empty, so it starts at the front
+	queue(1, 5);
+	TEST_CHECK(wl_tx_head == 0);
+	TEST_CHECK(wl_tx_tail == 5 + WL_TX_ENTRY_HDR);
+}
+
+// While a board is being backed off from, its payloads go to the back
+//	in the order they were in, and the rest go past them. Once the board's
+//	time is up, they go in order. If every payload is to boards we're
+//	backing off from, they just wait.
+void test_requeue(void)
+{
+	unsigned ids[4];
+	int i;
+
+	reset();
+	wl_tx_held = PLAYER_BIT(1);
+	wl_tx_retry_at[1] = WL_TX_BACKOFF_MS;
+
+	ids[0] = queue(1, 5);
+	TEST_CHECK(fifo_len == 0);
+	TEST_CHECK(!wl_module_tx_any_ready());
+
+	ids[1] = queue(2, 6);
+	ids[2] = queue(1, 7);
+	ids[3] = queue(2, 8);
+	TEST_CHECK(ring_ok());
+
+	// The ones to 2 go first. The module has one of them, and nothing
+	//	is moved while it does.
+	TEST_CHECK(fifo_len == 1);
+	TEST_CHECK(payload_id(fifo[0].buf) == ids[1]);
+	air_step();
+	TEST_CHECK(fifo_len == 1);
+	TEST_CHECK(payload_id(fifo[0].buf) == ids[3]);
+	air_step();
+	TEST_CHECK(fifo_len == 0);
+	TEST_CHECK(wl_module_tx_busy());
+	TEST_CHECK(ring_ok());
+
+	// Then the ones to 1, once it's let go, in order
+	for (i = 0; (i <= WL_TX_BACKOFF_MS) && wl_module_tx_busy(); i++)
+	{
+		tick();
+	}
+	TEST_CHECK(payloads[ids[0]].delivered);
+	TEST_CHECK(payloads[ids[2]].delivered);
+	TEST_CHECK(last_delivered[1] == ids[2] + 1);
+	TEST_CHECK(!wl_module_tx_busy());
+}
+
+// A payload the module gives up on is tried again after a backoff which
+//	doubles each time, and the ones behind it to the same board wait for
+//	it. Once we give up on it too, its messages are kept for the main
+//	loop, which takes them once (air_step does here).
+void test_retries(void)
+{
+	unsigned char lost[WL_MSG_PAYLOAD_LEN];
+	unsigned dead, behind, other;
+	unsigned long last;
+	int i;
+
+	reset();
+	dead = queue(3, 12);
+	behind = queue(3, 4);
+	other = queue(1, 9);
+
+	for (i = 0; i <= WL_TX_SW_RETRIES; i++)
+	{
+		TEST_CHECK(payloads[dead].loads == i + 1);
+		last = now;
+		air_step();
+		if (i < WL_TX_SW_RETRIES)
+		{
+			TEST_CHECK(wl_module_tx_is_held(3));
+			while (payloads[dead].loads == i + 1)
+			{
+				tick();
+			}
+			TEST_CHECK(now - last >= (WL_TX_BACKOFF_MS << i));
+			TEST_CHECK(!payloads[behind].delivered);
+		}
+		TEST_CHECK(ring_ok());
+	}
+
+	// The one behind it is next, and the one to someone else went
+	//	in the meantime
+	TEST_CHECK(payloads[other].delivered);
+	TEST_CHECK(payloads[dead].failed);
+	TEST_CHECK(wl_module_tx_take_lost(lost) == 0);
+	TEST_CHECK(!wl_module_tx_is_held(3));
+	TEST_CHECK( (fifo_len != 0) && (payload_id(fifo[0].buf) == behind) );
+}
+
+// A long run of payloads of every length to every board, some of which
+//	never get through. Every one which got into the ring is sent or given
+//	up on exactly once, and nothing in it is ever garbled. Payloads to a
+//	board we backed off from can go in a different order to the one they
+//	were queued in, since the ones which go to the back pass any which
+//	were behind them.
+void test_long_run(void)
+{
+	unsigned long sent = 0;
+	unsigned long failed = 0;
+	unsigned long full = 0;
+	unsigned char dest;
+	unsigned i;
+
+	reset();
+
+	while (now < RUN_MS + DRAIN_MS)
+	{
+		if ( (now < RUN_MS) && (random_in(2) == 0) )
+		{
+			dest = random_in(NUM_PLAYERS + 1);
+			dest = (dest == MASTER_PLAYER) ? ALL_PLAYERS : ((dest == NUM_PLAYERS) ? 1 : dest);
+			if (queue(dest, MIN_LEN + random_in(wl_module_PAYLOAD_LEN - MIN_LEN + 1)) == MAX_PAYLOADS)
+			{
+				full++;
+			}
+		}
+
+		tick();
+		TEST_CHECK(wl_tx_used <= WL_TX_RING_SIZE);
+		TEST_CHECK(ring_ok());
+
+		if ( (now >= RUN_MS) && !wl_module_tx_busy() )
+		{
+			break;
+		}
+	}
+
+	TEST_CHECK(!wl_module_tx_busy());
+	TEST_CHECK(wl_tx_queued == 0);
+	TEST_CHECK(wl_tx_loaded == 0);
+	TEST_CHECK(garbled == 0);
+
+	for (i = 0; i < num_payloads; i++)
+	{
+		TEST_CHECK(payloads[i].delivered + payloads[i].failed == 1);
+		sent += payloads[i].delivered;
+		failed += payloads[i].failed;
+	}
+
+	printf("%u payloads: %lu sent, %lu given up on, %lu turned away, the ring wrapped %lu times\n",
+		   num_payloads, sent, failed, full, wraps);
+
+	TEST_CHECK(num_payloads < MAX_PAYLOADS);
+	TEST_CHECK(wraps > num_payloads / 10);
+	TEST_CHECK(full != 0);
+}
+
+int main(void)
+{
+	TEST_RUN(test_wrap);
+	TEST_RUN(test_requeue);
+	TEST_RUN(test_retries);
+	TEST_RUN(test_long_run);
+
+	TEST_DONE();
+}